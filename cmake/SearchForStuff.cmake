@@ -97,6 +97,7 @@ endif()
 
 ## Use CheckLib package to find module
 include(CheckLib)
+check_lib(LZ4 lz4 lz4.h) # optional, ZSO support
 if(Linux)
     check_lib(EGL EGL EGL/egl.h)
     check_lib(X11_XCB X11-xcb X11/Xlib-xcb.h)
@@ -0,0 +1,76 @@
+/*  PCSX2 - PS2 Emulator for PCs
+ *  Copyright (C) 2002-2020  PCSX2 Dev Team
+ *
+ *  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with PCSX2.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// Implement the VEX encoded (AVX/AVX2) forms of a few SIMD instructions.  The vector length
+// comes from the destination: a ymm register gives the 256 bit form, an xmm one the VEX.128
+// form.  The caller checks x86caps.hasAVX/hasAVX2 before using them.
+
+namespace x86Emitter
+{
+
+// --------------------------------------------------------------------------------------
+//  xImplAVX_Move
+// --------------------------------------------------------------------------------------
+// VMOVDQA / VMOVDQU
+//
+struct xImplAVX_Move
+{
+    u8 Prefix;
+
+    void operator()(const xRegisterSSE &to, const xRegisterSSE &from) const;
+    void operator()(const xRegisterSSE &to, const xIndirectVoid &from) const;
+    void operator()(const xIndirectVoid &to, const xRegisterSSE &from) const;
+};
+
+// --------------------------------------------------------------------------------------
+//  xImplAVX_PMove
+// --------------------------------------------------------------------------------------
+// VPMOVSX / VPMOVZX, the memory operand is half (words) or a quarter (bytes) of the
+// destination.
+//
+struct xImplAVX_PMove
+{
+    u8 OpcodeBase;
+
+    void BW(const xRegisterSSE &to, const xRegisterSSE &from) const;
+    void BW(const xRegisterSSE &to, const xIndirectVoid &from) const;
+
+    void BD(const xRegisterSSE &to, const xRegisterSSE &from) const;
+    void BD(const xRegisterSSE &to, const xIndirectVoid &from) const;
+
+    void WD(const xRegisterSSE &to, const xRegisterSSE &from) const;
+    void WD(const xRegisterSSE &to, const xIndirectVoid &from) const;
+
+    void DQ(const xRegisterSSE &to, const xRegisterSSE &from) const;
+    void DQ(const xRegisterSSE &to, const xIndirectVoid &from) const;
+};
+
+// --------------------------------------------------------------------------------------
+//  xImplAVX_ArithRVM
+// --------------------------------------------------------------------------------------
+// Non destructive three operand forms: to = from1 op from2
+//
+struct xImplAVX_ArithRVM
+{
+    u8 Prefix;
+    u8 MbPrefix;
+    u8 Opcode;
+
+    void operator()(const xRegisterSSE &to, const xRegisterSSE &from1, const xRegisterSSE &from2) const;
+    void operator()(const xRegisterSSE &to, const xRegisterSSE &from1, const xIndirectVoid &from2) const;
+};
+}
@@ -44,6 +44,7 @@ struct xImpl_JmpCall
             pxAssertMsg(dest == (s32)dest, "Indirect jump is too far, must use a register!");
             xWrite8(0xe8);
             xWrite32(dest);
+            xLogRelocation((s32 *)xGetPtr() - 1, sizeof(s32));
         }
     }
 };
@@ -124,6 +124,16 @@ extern const xImpl_Set xSETA, xSETAE,
 // BMI extra instruction requires BMI1/BMI2
 extern const xImplBMI_RVM xMULX, xPDEP, xPEXT, xANDN_S; // Warning xANDN is already used by SSE
 
+// ------------------------------------------------------------------------
+// AVX/AVX2 instructions, 256 bit with the ymm registers (see implement/avx.h)
+extern const xImplAVX_Move xVMOVDQA, xVMOVDQU;
+extern const xImplAVX_PMove xVPMOVSX, xVPMOVZX;
+extern const xImplAVX_ArithRVM xVPAND, xVPOR, xVPXOR;
+
+extern void xVINSERTI128(const xRegisterYMM &to, const xRegisterYMM &from1, const xRegisterSSE &from2, u8 imm);
+extern void xVINSERTI128(const xRegisterYMM &to, const xRegisterYMM &from1, const xIndirectVoid &from2, u8 imm);
+extern void xVZEROUPPER();
+
 //////////////////////////////////////////////////////////////////////////////////////////
 // Miscellaneous Instructions
 // These are all defined inline or in ix86.cpp.
@@ -39,6 +39,9 @@ extern void EmitRex(const xRegisterBase &reg1, const xRegisterBase &reg2);
 extern void EmitRex(const xRegisterBase &reg1, const void *src);
 extern void EmitRex(const xRegisterBase &reg1, const xIndirectVoid &sib);
 
+extern void EmitVex(u8 prefix, u8 map, bool w, const xRegisterBase &reg, uint vvvv, const xRegisterBase &rm);
+extern void EmitVex(u8 prefix, u8 map, bool w, const xRegisterBase &reg, uint vvvv, const xIndirectVoid &sib);
+
 extern void _xMovRtoR(const xRegisterInt &to, const xRegisterInt &from);
 
 template <typename T>
@@ -86,6 +86,29 @@ static __fi bool is_s8(T imm)
 template <typename T>
 void xWrite(T val);
 
+// --------------------------------------------------------------------------------------
+//  xRelocation
+// --------------------------------------------------------------------------------------
+// A displacement written for an absolute target: the rel32 of a call or of a jump to a
+// known target, or a rip-relative (or absolute) memory operand.  When xRelocations is set,
+// the emitter appends them to it, so that the code can be copied somewhere else afterwards.
+//
+struct xRelocation
+{
+    s32 *disp;
+    int tail; // bytes from disp to the end of the instruction, 0 for an absolute address
+
+    uptr GetTarget() const { return tail ? (uptr)disp + tail + *disp : (uptr)(sptr)*disp; }
+};
+
+extern __tls_emit std::vector<xRelocation> *xRelocations;
+
+static __fi void xLogRelocation(s32 *disp, int tail)
+{
+    if (xRelocations)
+        xRelocations->push_back({disp, tail});
+}
+
 // --------------------------------------------------------------------------------------
 //  ALWAYS_USE_MOVAPS [define] / AlwaysUseMovaps [const]
 // --------------------------------------------------------------------------------------
@@ -464,6 +487,29 @@ public:
     static const inline xRegisterSSE &GetInstance(uint id);
 };
 
+// --------------------------------------------------------------------------------------
+//  xRegisterYMM  -  The 256 bit form of an xmm register
+// --------------------------------------------------------------------------------------
+// Only the VEX encoded instructions (AVX/AVX2) use the full register, they pick their
+// vector length from it.  The legacy SSE forms still see it as the xmm register.
+
+class xRegisterYMM : public xRegisterSSE
+{
+    typedef xRegisterSSE _parent;
+
+public:
+    xRegisterYMM()
+        : _parent()
+    {
+    }
+    explicit xRegisterYMM(int regId)
+        : _parent(regId)
+    {
+    }
+
+    virtual uint GetOperandSize() const { return 32; }
+};
+
 class xRegisterCL : public xRegister8
 {
 public:
@@ -643,6 +689,12 @@ extern const xRegisterSSE
     xmm8, xmm9, xmm10, xmm11,
     xmm12, xmm13, xmm14, xmm15;
 
+extern const xRegisterYMM
+    ymm0, ymm1, ymm2, ymm3,
+    ymm4, ymm5, ymm6, ymm7,
+    ymm8, ymm9, ymm10, ymm11,
+    ymm12, ymm13, ymm14, ymm15;
+
 extern const xAddressReg
     rax, rbx, rcx, rdx,
     rsi, rdi, rbp, rsp,
@@ -1238,3 +1290,4 @@ static __fi xAddressVoid operator+(sptr addr, const xAddressReg &reg)
 #include "implement/jmpcall.h"
 
 #include "implement/bmi.h"
+#include "implement/avx.h"
@@ -0,0 +1,90 @@
+/*  PCSX2 - PS2 Emulator for PCs
+ *  Copyright (C) 2002-2020  PCSX2 Dev Team
+ *
+ *  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with PCSX2.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PrecompiledHeader.h"
+#include "internal.h"
+#include "tools.h"
+
+namespace x86Emitter
+{
+
+template <typename T>
+static void xOpWriteVex(u8 prefix, u8 map, u8 opcode, const xRegisterSSE &reg, uint vvvv, const T &rm, int extraRIPOffset = 0)
+{
+    EmitVex(prefix, map, false, reg, vvvv, rm);
+    xWrite8(opcode);
+    EmitSibMagic(reg, rm, extraRIPOffset);
+}
+
+const xImplAVX_Move xVMOVDQA = {0x66};
+const xImplAVX_Move xVMOVDQU = {0xF3};
+
+void xImplAVX_Move::operator()(const xRegisterSSE &to, const xRegisterSSE &from) const
+{
+    if (to != from)
+        xOpWriteVex(Prefix, 0x0F, 0x6F, to, 0, from);
+}
+void xImplAVX_Move::operator()(const xRegisterSSE &to, const xIndirectVoid &from) const { xOpWriteVex(Prefix, 0x0F, 0x6F, to, 0, from); }
+void xImplAVX_Move::operator()(const xIndirectVoid &to, const xRegisterSSE &from) const { xOpWriteVex(Prefix, 0x0F, 0x7F, from, 0, to); }
+
+const xImplAVX_PMove xVPMOVSX = {0x20};
+const xImplAVX_PMove xVPMOVZX = {0x30};
+
+void xImplAVX_PMove::BW(const xRegisterSSE &to, const xRegisterSSE &from) const { xOpWriteVex(0x66, 0x38, OpcodeBase, to, 0, from); }
+void xImplAVX_PMove::BW(const xRegisterSSE &to, const xIndirectVoid &from) const { xOpWriteVex(0x66, 0x38, OpcodeBase, to, 0, from); }
+
+void xImplAVX_PMove::BD(const xRegisterSSE &to, const xRegisterSSE &from) const { xOpWriteVex(0x66, 0x38, OpcodeBase + 1, to, 0, from); }
+void xImplAVX_PMove::BD(const xRegisterSSE &to, const xIndirectVoid &from) const { xOpWriteVex(0x66, 0x38, OpcodeBase + 1, to, 0, from); }
+
+void xImplAVX_PMove::WD(const xRegisterSSE &to, const xRegisterSSE &from) const { xOpWriteVex(0x66, 0x38, OpcodeBase + 3, to, 0, from); }
+void xImplAVX_PMove::WD(const xRegisterSSE &to, const xIndirectVoid &from) const { xOpWriteVex(0x66, 0x38, OpcodeBase + 3, to, 0, from); }
+
+void xImplAVX_PMove::DQ(const xRegisterSSE &to, const xRegisterSSE &from) const { xOpWriteVex(0x66, 0x38, OpcodeBase + 5, to, 0, from); }
+void xImplAVX_PMove::DQ(const xRegisterSSE &to, const xIndirectVoid &from) const { xOpWriteVex(0x66, 0x38, OpcodeBase + 5, to, 0, from); }
+
+const xImplAVX_ArithRVM xVPAND = {0x66, 0x0F, 0xDB};
+const xImplAVX_ArithRVM xVPOR = {0x66, 0x0F, 0xEB};
+const xImplAVX_ArithRVM xVPXOR = {0x66, 0x0F, 0xEF};
+
+void xImplAVX_ArithRVM::operator()(const xRegisterSSE &to, const xRegisterSSE &from1, const xRegisterSSE &from2) const
+{
+    xOpWriteVex(Prefix, MbPrefix, Opcode, to, from1.Id, from2);
+}
+void xImplAVX_ArithRVM::operator()(const xRegisterSSE &to, const xRegisterSSE &from1, const xIndirectVoid &from2) const
+{
+    xOpWriteVex(Prefix, MbPrefix, Opcode, to, from1.Id, from2);
+}
+
+// [AVX2] Replaces the low (imm = 0) or the high (imm = 1) half of a ymm register.
+void xVINSERTI128(const xRegisterYMM &to, const xRegisterYMM &from1, const xRegisterSSE &from2, u8 imm)
+{
+    xOpWriteVex(0x66, 0x3A, 0x38, to, from1.Id, from2);
+    xWrite8(imm);
+}
+void xVINSERTI128(const xRegisterYMM &to, const xRegisterYMM &from1, const xIndirectVoid &from2, u8 imm)
+{
+    xOpWriteVex(0x66, 0x3A, 0x38, to, from1.Id, from2, 1);
+    xWrite8(imm);
+}
+
+// Clears the upper half of every ymm register, which avoids the AVX to SSE transition
+// penalty when the code returns to SSE code.
+void xVZEROUPPER()
+{
+    xWrite8(0xC5);
+    xWrite8(0xF8);
+    xWrite8(0x77);
+}
+}
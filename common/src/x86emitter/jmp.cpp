@@ -217,6 +217,7 @@ __emitinline void xJccKnownTarget(JccComparisonType comparison, const void *targ
 #endif
 
         *bah = (s32)distance;
+        xLogRelocation(bah, sizeof(s32));
     }
 }
 
@@ -67,6 +67,8 @@ __tls_emit XMMSSEType g_xmmtypes[iREGCNT_XMM] = {XMMT_INT};
 namespace x86Emitter
 {
 
+__tls_emit std::vector<xRelocation> *xRelocations = NULL;
+
 template void xWrite<u8>(u8 val);
 template void xWrite<u16>(u16 val);
 template void xWrite<u32>(u32 val);
@@ -120,6 +122,16 @@ const xRegisterSSE
     xmm12(12), xmm13(13),
     xmm14(14), xmm15(15);
 
+const xRegisterYMM
+    ymm0(0), ymm1(1),
+    ymm2(2), ymm3(3),
+    ymm4(4), ymm5(5),
+    ymm6(6), ymm7(7),
+    ymm8(8), ymm9(9),
+    ymm10(10), ymm11(11),
+    ymm12(12), ymm13(13),
+    ymm14(14), ymm15(15);
+
 const xAddressReg
     rax(0), rbx(3),
     rcx(1), rdx(2),
@@ -226,6 +238,13 @@ const char *const x86_regnames_sse[] =
         "xmm8", "xmm9", "xmm10", "xmm11",
         "xmm12", "xmm13", "xmm14", "xmm15"};
 
+const char *const x86_regnames_avx[] =
+    {
+        "ymm0", "ymm1", "ymm2", "ymm3",
+        "ymm4", "ymm5", "ymm6", "ymm7",
+        "ymm8", "ymm9", "ymm10", "ymm11",
+        "ymm12", "ymm13", "ymm14", "ymm15"};
+
 const char *xRegisterBase::GetName()
 {
     if (Id == xRegId_Invalid)
@@ -251,6 +270,8 @@ const char *xRegisterBase::GetName()
 #endif
         case 16:
             return x86_regnames_sse[Id];
+        case 32:
+            return x86_regnames_avx[Id];
     }
 
     return "oops?";
@@ -293,6 +314,7 @@ static __fi void SibSB(u32 ss, u32 index, u32 base)
 void EmitSibMagic(uint regfield, const void *address, int extraRIPOffset)
 {
     sptr displacement = (sptr)address;
+    int tail = 0;
 #ifndef __M_X86_64
     ModRM(0, regfield, ModRm_UseDisp32);
 #else
@@ -301,6 +323,7 @@ void EmitSibMagic(uint regfield, const void *address, int extraRIPOffset)
     if (ripRelative == (s32)ripRelative) {
         ModRM(0, regfield, ModRm_UseDisp32);
         displacement = ripRelative;
+        tail = sizeof(s32) + extraRIPOffset;
     } else {
         pxAssertDev(displacement == (s32)displacement, "SIB target is too far away, needs an indirect register");
         ModRM(0, regfield, ModRm_UseSib);
@@ -309,6 +332,7 @@ void EmitSibMagic(uint regfield, const void *address, int extraRIPOffset)
 #endif
 
     xWrite<s32>((s32)displacement);
+    xLogRelocation((s32 *)x86Ptr - 1, tail);
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -514,6 +538,48 @@ void EmitRexImplicitlyWide(const xIndirectVoid &sib)
     EmitRex(w, r, x, b);
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////
+// VEX prefix of the AVX instructions, it takes the place of the REX prefix and of the
+// escape bytes.  The vector length comes from reg, and vvvv is the id of the second source
+// register (0 when the instruction has none).  The short form is used whenever it can be.
+//
+static void EmitVex(u8 prefix, u8 map, bool w, const xRegisterBase &reg, uint vvvv, bool x, bool b)
+{
+    pxAssert(prefix == 0 || prefix == 0x66 || prefix == 0xF3 || prefix == 0xF2);
+    pxAssert(map == 0x0F || map == 0x38 || map == 0x3A);
+
+    const u8 pp = prefix == 0xF2 ? 3 : prefix == 0xF3 ? 2 : prefix == 0x66 ? 1 : 0;
+    const u8 mmmmm = map == 0x3A ? 3 : map == 0x38 ? 2 : 1;
+    const u8 nR = reg.IsExtended() ? 0 : 0x80;
+    const u8 L = reg.IsWideSIMD() ? 4 : 0;
+    const u8 nv = (~vvvv & 0xF) << 3;
+
+    if (map == 0x0F && !w && !x && !b) {
+        xWrite8(0xC5);
+        xWrite8(nR | nv | L | pp);
+    } else {
+        xWrite8(0xC4);
+        xWrite8(nR | (x ? 0 : 0x40) | (b ? 0 : 0x20) | mmmmm);
+        xWrite8((w ? 0x80 : 0) | nv | L | pp);
+    }
+}
+
+void EmitVex(u8 prefix, u8 map, bool w, const xRegisterBase &reg, uint vvvv, const xRegisterBase &rm)
+{
+    EmitVex(prefix, map, w, reg, vvvv, false, rm.IsExtended());
+}
+
+void EmitVex(u8 prefix, u8 map, bool w, const xRegisterBase &reg, uint vvvv, const xIndirectVoid &sib)
+{
+    bool x = sib.Index.IsExtended();
+    bool b = sib.Base.IsExtended();
+    if (!NeedsSibMagic(sib)) {
+        b = x;
+        x = false;
+    }
+    EmitVex(prefix, map, w, reg, vvvv, x, b);
+}
+
 
 // --------------------------------------------------------------------------------------
 //  xSetPtr / xAlignPtr / xGetPtr / xAdvancePtr
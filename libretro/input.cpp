@@ -119,6 +119,13 @@ void setRumbleLevel(int percent)
 	
 }
 
+bool RewindHeld()
+{
+	return input_cb(0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_SELECT) &&
+		   input_cb(0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_L3) &&
+		   input_cb(0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_R3);
+}
+
 
 } // namespace Input
 
@@ -8,4 +8,6 @@ void Update();
 void Shutdown();
 void RumbleEnabled(bool enabled, int percent);
 void setRumbleLevel(int percent);
+// Select + L3 + R3 held on the first pad
+bool RewindHeld();
 }
@@ -288,6 +288,18 @@ struct retro_core_option_definition option_defs[] = {
 	},
 	"2" },
 
+	{ "pcsx2_rewind_seconds",
+	"Emulation: Rewind Buffer",
+	"Keeps snapshots of the last seconds in memory, hold Select + L3 + R3 to rewind. Only the memory pages which changed are stored, but each snapshot still takes time: leave it disabled when using the frontend's rewind.",
+	{
+		{"0", "disabled"},
+		{"10", "10 seconds"},
+		{"30", "30 seconds"},
+		{"60", "60 seconds"},
+		{NULL, NULL},
+	},
+	"0" },
+
 
 	{ "pcsx2_userhack_align_sprite",
 	"Hack: Align Sprite",
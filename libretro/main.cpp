@@ -23,6 +23,7 @@
 #include "retro_messager.h"
 #include "language_injector.h"
 #include "input.h"
+#include "savestate.h"
 #include "svnrev.h"
 #include "disk_control.h"
 #include "SPU2/Global.h"
@@ -405,7 +406,7 @@ void retro_get_system_info(retro_system_info* info)
 #endif
 
 	info->library_name = "pcsx2 (alpha)";
-	info->valid_extensions = "elf|iso|ciso|chd|cso|cue|bin|m3u";
+	info->valid_extensions = "elf|iso|ciso|chd|cso|zso|cue|bin|m3u";
 	info->need_fullpath = true;
 	info->block_extract = true;
 }
@@ -439,6 +440,7 @@ void retro_reset(void)
 	GetMTGS().FinishTaskInThread();
 	GetCoreThread().ResetQuick();
 	DiskControl::eject_state = false;
+	Savestate::Reset();
 }
 
 static void context_reset(void)
@@ -771,6 +773,7 @@ bool retro_load_game(const struct retro_game_info* game)
 		option_value(BOOL_PCSX2_OPT_GAMEPAD_RUMBLE_ENABLE, KeyOptionBool::return_type),
 		option_value(INT_PCSX2_OPT_GAMEPAD_RUMBLE_FORCE, KeyOptionInt::return_type)
 		);
+	Savestate::SetRewind(option_value(INT_PCSX2_OPT_REWIND_SECONDS, KeyOptionInt::return_type));
 
 	retro_hw_context_type context_type = RETRO_HW_CONTEXT_OPENGL;
 	const char* option_renderer = option_value(STRING_PCSX2_OPT_RENDERER, KeyOptionString::return_type);
@@ -796,6 +799,7 @@ bool retro_load_game_special(unsigned game_type, const struct retro_game_info* i
 
 void retro_unload_game(void)
 {
+	Savestate::Reset();
 	//	GetMTGS().FinishTaskInThread();
 	//		GetMTGS().ClosePlugin();
 	GetMTGS().FinishTaskInThread();
@@ -824,9 +828,11 @@ void retro_run(void)
 			option_value(BOOL_PCSX2_OPT_GAMEPAD_RUMBLE_ENABLE, KeyOptionBool::return_type),
 			option_value(INT_PCSX2_OPT_GAMEPAD_RUMBLE_FORCE, KeyOptionInt::return_type)
 		);
+		Savestate::SetRewind(option_value(INT_PCSX2_OPT_REWIND_SECONDS, KeyOptionInt::return_type));
 	}
 
 	Input::Update();
+	Savestate::Update();
 
 	RETRO_PERFORMANCE_INIT(pcsx2_run);
 	RETRO_PERFORMANCE_START(pcsx2_run);
@@ -838,16 +844,16 @@ void retro_run(void)
 
 size_t retro_serialize_size(void)
 {
-	return 0;
+	return Savestate::GetSize();
 }
 
 bool retro_serialize(void* data, size_t size)
 {
-	return false;
+	return Savestate::Save(data, size);
 }
 bool retro_unserialize(const void* data, size_t size)
 {
-	return false;
+	return Savestate::Load(data, size);
 }
 
 unsigned retro_get_region(void)
@@ -862,11 +868,15 @@ unsigned retro_api_version()
 
 size_t retro_get_memory_size(unsigned id)
 {
+	if (id == RETRO_MEMORY_SYSTEM_RAM)
+		return Ps2MemSize::MainRam;
 	return 0;
 }
 
 void* retro_get_memory_data(unsigned id)
 {
+	if (id == RETRO_MEMORY_SYSTEM_RAM && eeMem)
+		return eeMem->Main;
 	return NULL;
 }
 
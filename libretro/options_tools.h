@@ -54,6 +54,7 @@ static const char* INT_PCSX2_OPT_DEINTERLACING_MODE			= "pcsx2_deinterlace_mode"
 static const char* INT_PCSX2_OPT_FXAA						= "pcsx2_fxaa";
 static const char* INT_PCSX2_OPT_TEXTURE_FILTERING			= "pcsx2_texture_filtering";
 static const char* INT_PCSX2_OPT_VSYNC_MTGS_QUEUE = "pcsx2_vsync_mtgs_queue";
+static const char* INT_PCSX2_OPT_REWIND_SECONDS				= "pcsx2_rewind_seconds";
 
 static const char* INT_PCSX2_OPT_USERHACK_TEXTURE_OFFSET_X_HUNDREDS	= "pcsx2_userhack_texture_offset_x_hundreds";
 static const char* INT_PCSX2_OPT_USERHACK_TEXTURE_OFFSET_X_TENS		= "pcsx2_userhack_texture_offset_x_tens";
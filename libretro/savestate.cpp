@@ -0,0 +1,394 @@
+#include "PrecompiledHeader.h"
+
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+#include "savestate.h"
+#include "input.h"
+
+#include "GS.h"
+#include "SaveState.h"
+#include "System/SysThreads.h"
+#include "SPU2/spu2.h"
+
+namespace Savestate
+{
+// The state is the header, SaveStateBase::FreezeAll and the SPU2 (which isn't part of
+// FreezeAll, the standalone savestates keep it in its own file). Nothing is compressed,
+// the frontend does it if it wants to.
+struct StateHeader
+{
+	u32 magic;   // STATE_MAGIC
+	u32 version; // g_SaveVersion
+	u32 size;    // bytes following the header
+	u32 flags;   // StateFlags
+};
+
+enum StateFlags
+{
+	STATE_DELTA = 1 << 0, // FreezeAllDelta instead of FreezeAll, only used by the rewind
+};
+
+static const u32 STATE_MAGIC = 0x52325350; // "PS2R"
+
+// The size reported to the frontend, the first state rounded up with some room for the
+// plugins to grow.
+static const size_t STATE_SIZE_ALIGN = _1mb;
+
+static const size_t REWIND_PAGE_SIZE = 0x1000;
+static const int REWIND_INTERVAL = 30;   // frames between snapshots
+static const int REWIND_STEP_FRAMES = 4; // frames between steps back while rewinding
+
+// Layout of a delta state: the header, the "RamDelta" tag (SaveStateBase::FreezeTag), the
+// count of EE RAM pages, their indices, the pages, then the rest of the state.
+static const u32 RAM_PAGES = Ps2MemSize::MainRam / REWIND_PAGE_SIZE;
+static const size_t DELTA_COUNT_OFFSET = sizeof(StateHeader) + 32;
+static const size_t DELTA_PAGES_OFFSET = DELTA_COUNT_OFFSET + sizeof(u32);
+
+// --------------------------------------------------------------------------------------
+//  RewindRing
+// --------------------------------------------------------------------------------------
+// The snapshots are delta states: EE RAM only has the pages the emulation wrote since the
+// previous snapshot (see mmap_TakeDirtyPages). The newest snapshot is kept as a complete
+// delta state (with all the pages), and for each older one the ring keeps the parts which
+// were different from the snapshot after it: stepping back patches the newest snapshot in
+// place. The rest of the state (IOP RAM, VU memory, GS local memory...) is compared by
+// pages, most of them don't change from one snapshot to the next either.
+//
+class RewindRing
+{
+	static const size_t HEAD_RAM_OFFSET = DELTA_PAGES_OFFSET + RAM_PAGES * sizeof(u32);
+	static const size_t HEAD_REST_OFFSET = HEAD_RAM_OFFSET + Ps2MemSize::MainRam;
+
+	struct Delta
+	{
+		std::vector<u32> offsets; // in m_head
+		std::vector<u8> data;
+	};
+
+	std::vector<u8> m_head;
+	std::deque<Delta> m_deltas;
+	size_t m_capacity = 0;
+
+	void Patch(Delta& delta, size_t offset, const u8* src, size_t len)
+	{
+		if (memcmp(&m_head[offset], src, len) == 0)
+			return;
+
+		delta.offsets.push_back((u32)offset);
+		delta.data.insert(delta.data.end(), m_head.begin() + offset, m_head.begin() + offset + len);
+		memcpy(&m_head[offset], src, len);
+	}
+
+public:
+	void SetCapacity(size_t capacity)
+	{
+		m_capacity = capacity;
+		Clear();
+	}
+
+	size_t GetCapacity() const { return m_capacity; }
+
+	void Clear()
+	{
+		m_head.clear();
+		m_head.shrink_to_fit();
+		m_deltas.clear();
+	}
+
+	bool IsEmpty() const { return m_head.empty(); }
+	const std::vector<u8>& GetHead() const { return m_head; }
+
+	// Returns false when the delta can't be applied, the next one must have all the pages.
+	bool Push(const u8* state, size_t size)
+	{
+		const u32 count = *(const u32*)(state + DELTA_COUNT_OFFSET);
+		const u32* pages = (const u32*)(state + DELTA_PAGES_OFFSET);
+		const u8* ram = (const u8*)(pages + count);
+		const u8* rest = ram + count * REWIND_PAGE_SIZE;
+		const size_t restsize = size - (rest - state);
+
+		const bool layout = m_head.size() == HEAD_REST_OFFSET + restsize;
+
+		// A thaw or a reset of the recompiler marks all the pages dirty: with the same layout
+		// it's stored as a delta like the others, only the pages which changed are kept.
+		if (count == RAM_PAGES && !layout)
+		{
+			m_deltas.clear();
+			m_head.assign(state, state + size);
+			return true;
+		}
+
+		if (!layout)
+		{
+			// No complete snapshot yet, or the plugins changed the layout of the state.
+			Clear();
+			return false;
+		}
+
+		Delta delta;
+		for (u32 i = 0; i < count; i++)
+			Patch(delta, HEAD_RAM_OFFSET + pages[i] * REWIND_PAGE_SIZE, ram + i * REWIND_PAGE_SIZE, REWIND_PAGE_SIZE);
+		for (size_t offset = 0; offset < restsize; offset += REWIND_PAGE_SIZE)
+			Patch(delta, HEAD_REST_OFFSET + offset, rest + offset, std::min(REWIND_PAGE_SIZE, restsize - offset));
+
+		m_deltas.push_back(std::move(delta));
+		while (m_deltas.size() + 1 > m_capacity)
+			m_deltas.pop_front();
+
+		return true;
+	}
+
+	// Turns the head into the snapshot before it, false when it's the oldest one.
+	bool Back()
+	{
+		if (m_deltas.empty())
+			return false;
+
+		const Delta& delta = m_deltas.back();
+		const u8* src = delta.data.data();
+		for (u32 offset : delta.offsets)
+		{
+			const size_t len = std::min(REWIND_PAGE_SIZE, m_head.size() - offset);
+			memcpy(&m_head[offset], src, len);
+			src += len;
+		}
+
+		m_deltas.pop_back();
+		return true;
+	}
+};
+
+static VmStateBuffer s_buffer(L"StateBuffer_Libretro");
+static size_t s_size = 0;
+
+static RewindRing s_rewind;
+static int s_rewind_frames = 0;
+static bool s_rewinding = false;
+static bool s_rewind_full = true; // the next snapshot must have all the EE RAM pages
+
+static bool CanRun()
+{
+	// RunInThread needs the EE core running and this thread to be the MTGS.
+	return GetCoreThread().HasActiveMachine() && !GetCoreThread().IsPaused() &&
+		   GetMTGS().IsPluginOpened() && GetMTGS().IsSelf();
+}
+
+// Run by the EE core.
+static bool FreezeToBuffer(size_t& size, bool delta)
+{
+	try
+	{
+		memSavingState saveme(s_buffer);
+
+		StateHeader header = {STATE_MAGIC, g_SaveVersion, 0, delta ? (u32)STATE_DELTA : 0u};
+		saveme.Freeze(header);
+		if (delta)
+			saveme.FreezeAllDelta();
+		else
+			saveme.FreezeAll();
+
+		freezeData fP = {0, NULL};
+		if (SPU2freeze(FREEZE_SIZE, &fP) != 0)
+			return false;
+		saveme.PrepBlock(fP.size);
+		fP.data = (s8*)saveme.GetBlockPtr();
+		if (SPU2freeze(FREEZE_SAVE, &fP) != 0)
+			return false;
+		saveme.CommitBlock(fP.size);
+
+		size = saveme.GetCurrentPos();
+		((StateHeader*)s_buffer.GetPtr())->size = (u32)(size - sizeof(StateHeader));
+		return true;
+	}
+	catch (BaseException& ex)
+	{
+		Console.Error(ex.FormatDiagnosticMessage());
+		return false;
+	}
+}
+
+// Run by the EE core, the header has been checked.
+static bool ThawFromBuffer()
+{
+	try
+	{
+		memLoadingState loadme(s_buffer);
+
+		StateHeader header;
+		loadme.Freeze(header);
+		// also clears the recompilers
+		if (header.flags & STATE_DELTA)
+			loadme.FreezeAllDelta();
+		else
+			loadme.FreezeAll();
+
+		freezeData fP = {0, NULL};
+		if (SPU2freeze(FREEZE_SIZE, &fP) != 0)
+			return false;
+		fP.data = (s8*)loadme.GetBlockPtr();
+		return SPU2freeze(FREEZE_LOAD, &fP) == 0;
+	}
+	catch (BaseException& ex)
+	{
+		Console.Error(ex.FormatDiagnosticMessage());
+		return false;
+	}
+}
+
+static bool CheckHeader(const void* data, size_t size)
+{
+	if (size < sizeof(StateHeader))
+		return false;
+
+	const StateHeader& header = *(const StateHeader*)data;
+	if (header.magic != STATE_MAGIC || header.flags != 0)
+	{
+		Console.Error("Libretro savestate: unknown format.");
+		return false;
+	}
+	if (header.version != g_SaveVersion)
+	{
+		Console.Error("Libretro savestate: version 0x%08x isn't supported (0x%08x).", header.version, g_SaveVersion);
+		return false;
+	}
+	if (header.size > size - sizeof(StateHeader))
+	{
+		Console.Error("Libretro savestate: the state is truncated.");
+		return false;
+	}
+
+	return true;
+}
+
+static bool Freeze(size_t& size)
+{
+	bool result = false;
+	GetCoreThread().RunInThread([&]() { result = FreezeToBuffer(size, false); });
+	return result;
+}
+
+static bool ThawBuffer(const void* data, size_t size)
+{
+	s_buffer.MakeRoomFor(size);
+	memcpy(s_buffer.GetPtr(), data, size);
+
+	bool result = false;
+	GetCoreThread().RunInThread([&]() { result = ThawFromBuffer(); });
+	return result;
+}
+
+static bool Thaw(const void* data, size_t size)
+{
+	if (!CheckHeader(data, size))
+		return false;
+
+	return ThawBuffer(data, size);
+}
+
+size_t GetSize()
+{
+	// The frontend allocates its buffers once, the size must not change afterwards.
+	if (s_size == 0 && CanRun())
+	{
+		size_t size = 0;
+		if (Freeze(size))
+			s_size = (size + STATE_SIZE_ALIGN + STATE_SIZE_ALIGN - 1) & ~(STATE_SIZE_ALIGN - 1);
+	}
+
+	return s_size;
+}
+
+bool Save(void* data, size_t size)
+{
+	if (!CanRun())
+		return false;
+
+	size_t used = 0;
+	if (!Freeze(used))
+		return false;
+
+	if (used > size)
+	{
+		Console.Error("Libretro savestate: the state (%u bytes) doesn't fit in %u bytes.", (uint)used, (uint)size);
+		return false;
+	}
+
+	memcpy(data, s_buffer.GetPtr(), used);
+	memset((u8*)data + used, 0, size - used);
+	return true;
+}
+
+bool Load(const void* data, size_t size)
+{
+	if (!CanRun())
+		return false;
+
+	return Thaw(data, size);
+}
+
+void SetRewind(int seconds)
+{
+	const size_t capacity = seconds > 0 ? std::max(seconds * 60 / REWIND_INTERVAL, 2) : 0;
+	if (capacity == s_rewind.GetCapacity())
+		return;
+
+	s_rewind.SetCapacity(capacity);
+	s_rewind_full = true;
+
+	if (capacity == 0 && CanRun())
+		GetCoreThread().RunInThread(mmap_StopDirtyTracking);
+}
+
+void Update()
+{
+	if (s_rewind.GetCapacity() == 0 || !CanRun())
+		return;
+
+	if (Input::RewindHeld())
+	{
+		if (s_rewind_frames++ % REWIND_STEP_FRAMES != 0 || s_rewind.IsEmpty())
+			return;
+
+		// The first step goes back to the newest snapshot.
+		if (s_rewinding && !s_rewind.Back())
+			return;
+		s_rewinding = true;
+
+		const std::vector<u8>& head = s_rewind.GetHead();
+		ThawBuffer(head.data(), head.size());
+		return;
+	}
+
+	if (s_rewinding)
+	{
+		s_rewinding = false;
+		s_rewind_frames = 0;
+	}
+
+	if (++s_rewind_frames < REWIND_INTERVAL)
+		return;
+	s_rewind_frames = 0;
+
+	bool result = false;
+	size_t size = 0;
+	const bool full = s_rewind_full;
+	GetCoreThread().RunInThread([&]() {
+		// Restarting the tracking makes the delta have all the pages.
+		if (full)
+			mmap_StopDirtyTracking();
+		result = FreezeToBuffer(size, true);
+	});
+
+	s_rewind_full = !result || !s_rewind.Push(s_buffer.GetPtr(), size);
+}
+
+void Reset()
+{
+	s_rewind.Clear();
+	s_rewind_frames = 0;
+	s_rewinding = false;
+	s_rewind_full = true;
+}
+} // namespace Savestate
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+
+namespace Savestate
+{
+// retro_serialize and retro_unserialize. The state is taken (restored) by the EE core at its
+// next vsync, they fail when the emulation isn't running.
+size_t GetSize();
+bool Save(void* data, size_t size);
+bool Load(const void* data, size_t size);
+
+// Core side rewind, keeps the given seconds of snapshots (0 disables it).
+void SetRewind(int seconds);
+// Called once per retro_run, takes the snapshots or steps back while rewinding.
+void Update();
+void Reset();
+}
@@ -53,6 +53,11 @@ public:
 	virtual void SetBlockSize(uint bytes) {}
 	virtual void SetDataOffset(int bytes) {}
 
+	// Returns a pointer to count sectors which can be read in place, or NULL if the
+	// reader can't provide one (the sectors must then be read with BeginRead/ReadSync).
+	// The pointer stays valid until the reader is closed.
+	virtual const u8* MapSectors(uint sector, uint count) { return NULL; }
+
 	uint GetBlockSize() const { return m_blocksize; }
 
 	const wxString& GetFilename() const
@@ -76,6 +81,13 @@ class FlatFileReader : public AsyncFileReader
 #elif defined(__linux__)
 	int m_fd; // FIXME don't know if overlap as an equivalent on linux
 	io_context_t m_aio_context;
+
+	// Whole file mapping used by MapSectors(), NULL when memory mapping is off
+	u8* m_mapping;
+	u64 m_mapping_size;
+	u64 m_willneed_end; // end of the range last passed to madvise(MADV_WILLNEED)
+
+	void MapFile(void);
 #elif defined(__POSIX__)
 	int m_fd; // TODO OSX don't know if overlap as an equivalent on OSX
 	struct aiocb m_aiocb;
@@ -83,9 +95,10 @@ class FlatFileReader : public AsyncFileReader
 #endif
 
 	bool shareWrite;
+	bool memoryMapped;
 
 public:
-	FlatFileReader(bool shareWrite = false);
+	FlatFileReader(bool shareWrite = false, bool memoryMapped = false);
 	virtual ~FlatFileReader(void);
 
 	virtual bool Open(const wxString& fileName);
@@ -102,6 +115,10 @@ public:
 
 	virtual void SetBlockSize(uint bytes) { m_blocksize = bytes; }
 	virtual void SetDataOffset(int bytes) { m_dataoffset = bytes; }
+
+#if defined(__linux__)
+	virtual const u8* MapSectors(uint sector, uint count);
+#endif
 };
 
 class MultipartFileReader : public AsyncFileReader
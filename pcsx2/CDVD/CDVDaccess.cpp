@@ -32,6 +32,7 @@
 #include "IsoFS/IsoFS.h"
 #include "IsoFS/IsoFSCDVD.h"
 #include "CDVDisoReader.h"
+#include "CDVDtrace.h"
 
 #include "DebugTools/SymbolMap.h"
 #include "AppConfig.h"
@@ -64,6 +65,76 @@ u32 lastLSN; // needed for block dumping
 
 static OutputIsoFile blockDumpFile;
 
+// ----------------------------------------------------------------------------
+// Read tracing (EmuConfig.CdvdTraceReads), see CDVDtrace.h
+//
+static const uint CDVD_TRACE_RECORDS = 256 * 1024;
+
+static std::unique_ptr<CdvdTraceRing> traceRing;
+static wxString traceName;
+static u64 traceStart;
+static CdvdTraceRecord tracePending; // track read between readTrack and the end of getBuffer
+static bool tracePendingValid = false;
+
+static u64 traceMicroseconds(u64 ticks)
+{
+	const u64 freq = GetTickFrequency();
+	return (ticks / freq) * 1000000 + (ticks % freq) * 1000000 / freq;
+}
+
+static void cdvdTraceOpen(const wxString& name)
+{
+	tracePendingValid = false;
+
+	if (!EmuConfig.CdvdTraceReads)
+	{
+		traceRing = nullptr;
+		return;
+	}
+
+	// The CDVD is closed and reopened whenever the emulation is suspended, keep adding
+	// to the same trace until the disc changes.
+	if (traceRing && traceName == name)
+		return;
+
+	if (!traceRing)
+		traceRing = std::make_unique<CdvdTraceRing>(CDVD_TRACE_RECORDS);
+
+	traceRing->Clear();
+	traceName = name;
+	traceStart = GetCPUTicks();
+}
+
+// Saves the trace so far, the last close (at shutdown) leaves the complete trace.
+static void cdvdTraceClose()
+{
+	if (!traceRing || !traceRing->GetRecorded())
+		return;
+
+	g_Conf->Folders.Logs.Mkdir();
+	wxString filename(Path::Combine(g_Conf->Folders.Logs, traceName + L".cdvdtrace"));
+
+	if (traceRing->Save(filename))
+		Console.WriteLn(Color_StrongBlue, L"CDVD trace: %u reads saved to %s", traceRing->GetCount(), WX_STR(filename));
+	else
+		Console.Error(L"CDVD trace: unable to write %s", WX_STR(filename));
+
+	tracePendingValid = false;
+}
+
+static CdvdTraceRecord cdvdTraceRecord(u64 issued, u32 lsn, int mode, u64 elapsed, u8 flags)
+{
+	CdvdTraceRecord record;
+	record.time = traceMicroseconds(issued - traceStart);
+	record.cycle = psxRegs.cycle;
+	record.lsn = lsn;
+	record.latency = (u32)traceMicroseconds(elapsed);
+	record.count = 1;
+	record.mode = mode;
+	record.flags = flags;
+	return record;
+}
+
 // Assertion check for CDVD != NULL (in devel and debug builds), because its handier than
 // relying on DEP exceptions -- and a little more reliable too.
 static void CheckNullCDVD()
@@ -377,6 +448,10 @@ bool DoCDVDopen()
 
 	int cdtype = DoCDVDdetectDiskType();
 
+	cdvdTraceOpen(!m_SourceFilename[CurrentSourceType].IsEmpty() ?
+					  Path::GetFilenameWithoutExt(m_SourceFilename[CurrentSourceType]) :
+					  wxString(L"Disc"));
+
 	if (!EmuConfig.CdvdDumpBlocks || (cdtype == CDVD_TYPE_NODISC))
 	{
 		blockDumpFile.Close();
@@ -441,6 +516,8 @@ void DoCDVDclose()
 	CheckNullCDVD();
 	//blockDumpFile.Close();
 
+	cdvdTraceClose();
+
 	if (CDVD->close != NULL)
 		CDVD->close();
 
@@ -450,8 +527,13 @@ void DoCDVDclose()
 s32 DoCDVDreadSector(u8* buffer, u32 lsn, int mode)
 {
 	CheckNullCDVD();
+
+	const u64 issued = traceRing ? GetCPUTicks() : 0;
 	int ret = CDVD->readSector(buffer, lsn, mode);
 
+	if (traceRing)
+		traceRing->Push(cdvdTraceRecord(issued, lsn, mode, GetCPUTicks() - issued, CdvdTrace_Sync | (ret != 0 ? CdvdTrace_Error : 0)));
+
 	if (ret == 0 && blockDumpFile.IsOpened())
 	{
 		if (blockDumpFile.GetBlockSize() == CD_FRAMESIZE_RAW && mode != CDVD_MODE_2352)
@@ -494,14 +576,44 @@ s32 DoCDVDreadTrack(u32 lsn, int mode)
 
 	//DevCon.Warning("CDVD readTrack(lsn=%d,mode=%d)",params lsn, lastReadSize);
 	lastLSN = lsn;
-	return CDVD->readTrack(lsn, mode);
+
+	if (!traceRing)
+		return CDVD->readTrack(lsn, mode);
+
+	// The record is completed by DoCDVDgetBuffer, its latency covers both calls.
+	if (tracePendingValid)
+		traceRing->Push(tracePending); // never collected
+
+	const u64 issued = GetCPUTicks();
+	const s32 ret = CDVD->readTrack(lsn, mode);
+	tracePending = cdvdTraceRecord(issued, lsn, mode, GetCPUTicks() - issued, ret != 0 ? CdvdTrace_Error : 0);
+	tracePendingValid = ret == 0;
+	if (!tracePendingValid)
+		traceRing->Push(tracePending);
+
+	return ret;
 }
 
 s32 DoCDVDgetBuffer(u8* buffer)
 {
 	CheckNullCDVD();
+
+	const u64 issued = tracePendingValid ? GetCPUTicks() : 0;
 	const int ret = CDVD->getBuffer(buffer);
 
+	if (tracePendingValid)
+	{
+		// The CDVD polls until the read completes, add up the time of all the calls.
+		tracePending.latency += (u32)traceMicroseconds(GetCPUTicks() - issued);
+		if (ret != -2)
+		{
+			if (ret != 0)
+				tracePending.flags |= CdvdTrace_Error;
+			traceRing->Push(tracePending);
+			tracePendingValid = false;
+		}
+	}
+
 	if (ret == 0 && blockDumpFile.IsOpened())
 	{
 		cdvdTD td;
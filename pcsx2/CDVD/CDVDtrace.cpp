@@ -0,0 +1,173 @@
+/*  PCSX2 - PS2 Emulator for PCs
+ *  Copyright (C) 2002-2020  PCSX2 Dev Team
+ *
+ *  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with PCSX2.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PrecompiledHeader.h"
+#include "CDVDtrace.h"
+#include "AsyncFileReader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <wx/ffile.h>
+
+static const uint CDVD_TRACE_MAX_SECTORS = 128;
+static const uint CDVD_TRACE_MAX_SECTOR_SIZE = 2448;
+// Longer pauses between reads (the emulation was suspended) are shortened to this when pacing.
+static const u64 CDVD_TRACE_MAX_PAUSE_US = 1000000;
+
+CdvdTraceRing::CdvdTraceRing(uint capacity)
+	: m_records(new CdvdTraceRecord[capacity])
+	, m_capacity(capacity)
+	, m_recorded(0)
+{
+}
+
+void CdvdTraceRing::Push(const CdvdTraceRecord& record)
+{
+	m_records[m_recorded++ % m_capacity] = record;
+}
+
+void CdvdTraceRing::Clear()
+{
+	m_recorded = 0;
+}
+
+bool CdvdTraceRing::Save(const wxString& filename) const
+{
+	wxFFile file(filename, L"wb");
+	if (!file.IsOpened())
+		return false;
+
+	CdvdTraceHeader header = {};
+	header.magic = CDVD_TRACE_MAGIC;
+	header.version = CDVD_TRACE_VERSION;
+	header.recordSize = sizeof(CdvdTraceRecord);
+	header.recorded = m_recorded;
+	header.count = GetCount();
+
+	bool ok = file.Write(&header, sizeof(header)) == sizeof(header);
+
+	// Once the ring wrapped, the oldest record is the one which will be overwritten next.
+	const uint first = m_recorded > m_capacity ? (uint)(m_recorded % m_capacity) : 0;
+	const uint tail = header.count - first;
+	ok = ok && file.Write(&m_records[first], tail * sizeof(CdvdTraceRecord)) == tail * sizeof(CdvdTraceRecord);
+	ok = ok && file.Write(&m_records[0], first * sizeof(CdvdTraceRecord)) == first * sizeof(CdvdTraceRecord);
+
+	return ok;
+}
+
+bool CdvdTraceLoad(const wxString& filename, std::vector<CdvdTraceRecord>& records)
+{
+	records.clear();
+
+	wxFFile file(filename, L"rb");
+	if (!file.IsOpened())
+		return false;
+
+	CdvdTraceHeader header;
+	if (file.Read(&header, sizeof(header)) != sizeof(header) || header.magic != CDVD_TRACE_MAGIC)
+	{
+		Console.Error(L"%s is not a CDVD trace.", WX_STR(filename));
+		return false;
+	}
+	if (header.version != CDVD_TRACE_VERSION || header.recordSize != sizeof(CdvdTraceRecord))
+	{
+		Console.Error(L"%s: unsupported CDVD trace version %u.", WX_STR(filename), header.version);
+		return false;
+	}
+
+	records.resize(header.count);
+	if (file.Read(records.data(), header.count * sizeof(CdvdTraceRecord)) != header.count * sizeof(CdvdTraceRecord))
+	{
+		Console.Error(L"%s: the CDVD trace is truncated.", WX_STR(filename));
+		records.clear();
+		return false;
+	}
+
+	return true;
+}
+
+static u32 Percentile(const std::vector<u32>& sorted, double p)
+{
+	if (sorted.empty())
+		return 0;
+	return sorted[std::min<size_t>(sorted.size() - 1, (size_t)(sorted.size() * p))];
+}
+
+void CdvdTraceReplay(AsyncFileReader* reader, const std::vector<CdvdTraceRecord>& records,
+					 bool paced, CdvdReplayStats& stats)
+{
+	memzero(stats);
+
+	ScopedAlloc<u8> buffer(CDVD_TRACE_MAX_SECTORS * CDVD_TRACE_MAX_SECTOR_SIZE);
+	std::vector<u32> latencies;
+	latencies.reserve(records.size());
+
+	const uint blocks = reader->GetBlockCount();
+	const u64 freq = GetTickFrequency();
+	const u64 start = GetCPUTicks();
+	u64 due = 0; // microseconds since start
+	u64 prevTime = records.empty() ? 0 : records.front().time;
+
+	for (const CdvdTraceRecord& record : records)
+	{
+		const uint count = std::min<uint>(std::max<uint>(record.count, 1), CDVD_TRACE_MAX_SECTORS);
+		if (record.lsn >= blocks)
+		{
+			stats.skipped++;
+			continue;
+		}
+
+		if (paced)
+		{
+			due += std::min(record.time - std::min(record.time, prevTime), CDVD_TRACE_MAX_PAUSE_US);
+			prevTime = record.time;
+
+			const u64 now = (GetCPUTicks() - start) * 1000000 / freq;
+			if (due > now)
+				std::this_thread::sleep_for(std::chrono::microseconds(due - now));
+		}
+
+		const uint sectors = std::min(count, blocks - record.lsn);
+		const u64 issued = GetCPUTicks();
+
+		// Same as InputIsoFile, mapped sectors are copied, the others read.
+		int ret = 0;
+		if (const u8* mapped = reader->MapSectors(record.lsn, sectors))
+		{
+			memcpy(buffer.GetPtr(), mapped, sectors * reader->GetBlockSize());
+		}
+		else
+		{
+			reader->BeginRead(buffer.GetPtr(), record.lsn, sectors);
+			ret = reader->FinishRead();
+		}
+		latencies.push_back((u32)((GetCPUTicks() - issued) * 1000000 / freq));
+
+		stats.reads++;
+		if (ret < 0)
+			stats.errors++;
+		else
+			stats.bytes += sectors * (u64)reader->GetBlockSize();
+	}
+
+	stats.seconds = (double)(GetCPUTicks() - start) / freq;
+
+	std::sort(latencies.begin(), latencies.end());
+	stats.latency_p50 = Percentile(latencies, 0.50);
+	stats.latency_p99 = Percentile(latencies, 0.99);
+	stats.latency_p999 = Percentile(latencies, 0.999);
+	stats.latency_max = latencies.empty() ? 0 : latencies.back();
+}
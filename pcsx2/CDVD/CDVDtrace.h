@@ -0,0 +1,115 @@
+/*  PCSX2 - PS2 Emulator for PCs
+ *  Copyright (C) 2002-2020  PCSX2 Dev Team
+ *
+ *  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with PCSX2.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+class AsyncFileReader;
+
+// --------------------------------------------------------------------------------------
+//  CDVD read traces
+// --------------------------------------------------------------------------------------
+// When EmuConfig.CdvdTraceReads is set, every sector read by the emulated drive is
+// recorded into a CdvdTraceRing, which is saved next to the logs when the disc is closed.
+// The trace can then be replayed against any AsyncFileReader with the cdvd_trace_bench
+// tool, to tune the caches and the read ahead of the readers with real access patterns.
+//
+// The file is a CdvdTraceHeader followed by the records, oldest first, in little endian.
+//
+enum CdvdTraceFlags
+{
+	CdvdTrace_Sync = 1 << 0,  // read with DoCDVDreadSector (file system accesses, detection)
+	CdvdTrace_Error = 1 << 1, // the read failed
+};
+
+struct CdvdTraceRecord
+{
+	u64 time;    // host time of the request, in microseconds since the trace started
+	u32 cycle;   // IOP cycle of the request
+	u32 lsn;
+	u32 latency; // host time spent in the read by the emulator, in microseconds
+	u16 count;   // sectors
+	u8 mode;     // CDVD_MODE_*
+	u8 flags;    // CdvdTraceFlags
+};
+
+struct CdvdTraceHeader
+{
+	u32 magic;      // CDVD_TRACE_MAGIC
+	u16 version;    // CDVD_TRACE_VERSION
+	u16 recordSize; // sizeof(CdvdTraceRecord)
+	u64 recorded;   // total reads recorded, more than count when the ring wrapped
+	u32 count;      // records in the file
+	u32 reserved;
+};
+
+static const u32 CDVD_TRACE_MAGIC = 0x52544443; // "CDTR"
+static const u16 CDVD_TRACE_VERSION = 1;
+
+// --------------------------------------------------------------------------------------
+//  CdvdTraceRing
+// --------------------------------------------------------------------------------------
+// Keeps the last capacity records. Recording doesn't allocate, the ring is allocated
+// once when it's created.
+//
+class CdvdTraceRing
+{
+	DeclareNoncopyableObject(CdvdTraceRing);
+
+public:
+	CdvdTraceRing(uint capacity);
+
+	void Push(const CdvdTraceRecord& record);
+	void Clear();
+
+	uint GetCount() const { return (uint)std::min<u64>(m_recorded, m_capacity); }
+	u64 GetRecorded() const { return m_recorded; }
+
+	bool Save(const wxString& filename) const;
+
+private:
+	std::unique_ptr<CdvdTraceRecord[]> m_records;
+	const uint m_capacity;
+	u64 m_recorded;
+};
+
+extern bool CdvdTraceLoad(const wxString& filename, std::vector<CdvdTraceRecord>& records);
+
+// --------------------------------------------------------------------------------------
+//  CdvdTraceReplay
+// --------------------------------------------------------------------------------------
+struct CdvdReplayStats
+{
+	u64 reads;
+	u64 skipped; // past the end of the image
+	u64 errors;
+	u64 bytes;
+	double seconds;
+
+	// Latencies of the individual reads, in microseconds
+	u32 latency_p50;
+	u32 latency_p99;
+	u32 latency_p999;
+	u32 latency_max;
+};
+
+// Issues the reads of a trace the way InputIsoFile does (MapSectors, or BeginRead and
+// FinishRead). The reader must be opened and configured. With paced set, the reads
+// are issued at the same pace as when they were recorded, which gives read ahead the
+// same time to work as the emulator did, otherwise they're issued back to back.
+extern void CdvdTraceReplay(AsyncFileReader* reader, const std::vector<CdvdTraceRecord>& records,
+							bool paced, CdvdReplayStats& stats);
@@ -16,43 +16,127 @@
 #include "PrecompiledHeader.h"
 #include "ChunksCache.h"
 
+// Slabs are allocated in ~4MB pieces, so the memory use grows with the actual use
+// of the cache instead of committing the whole limit on the first read.
+static const uint SLAB_BYTES = 4 * 1024 * 1024;
+
+ChunksCache::ChunksCache(uint initialLimitMb, uint chunkSize)
+	: m_chunkSize(chunkSize)
+	, m_slabChunks(std::max(1u, SLAB_BYTES / chunkSize))
+	, m_used(0)
+{
+	m_lru.prev = m_lru.next = &m_lru;
+	memzero(m_stats);
+	Configure(initialLimitMb);
+}
+
 void ChunksCache::SetLimit(uint megabytes)
 {
-	m_limit = (PX_off_t)megabytes * 1024 * 1024;
-	MatchLimit();
+	Clear();
+	Configure(megabytes);
+}
+
+void ChunksCache::Configure(uint megabytes)
+{
+	uint count = (uint)(((u64)megabytes * 1024 * 1024) / m_chunkSize);
+	m_entries.assign(std::max(1u, count), CacheEntry());
+	m_index.reserve(m_entries.size());
+}
+
+void ChunksCache::Clear()
+{
+	m_index.clear();
+	m_slabs.clear();
+	for (CacheEntry& e : m_entries)
+		e.data = NULL;
+
+	m_used = 0;
+	m_lru.prev = m_lru.next = &m_lru;
+}
+
+void ChunksCache::Unlink(CacheEntry* e)
+{
+	e->prev->next = e->next;
+	e->next->prev = e->prev;
+}
+
+void ChunksCache::PushFront(CacheEntry* e)
+{
+	e->prev = &m_lru;
+	e->next = m_lru.next;
+	m_lru.next->prev = e;
+	m_lru.next = e;
 }
 
-void ChunksCache::MatchLimit(bool removeAll)
+ChunksCache::CacheEntry* ChunksCache::AllocEntry()
 {
-	std::list<CacheEntry*>::reverse_iterator rit;
-	while (!m_entries.empty() && (removeAll || m_size > m_limit))
+	if (m_used < m_entries.size())
 	{
-		rit = m_entries.rbegin();
-		m_size -= (*rit)->size;
-		delete (*rit);
-		m_entries.pop_back();
+		if (m_used % m_slabChunks == 0)
+		{
+			// Carve a new slab and hand its buffers to the entries it backs.
+			uint chunks = std::min<uint>(m_slabChunks, m_entries.size() - m_used);
+			m_slabs.emplace_back(new u8[(size_t)chunks * m_chunkSize]);
+			for (uint i = 0; i < chunks; i++)
+				m_entries[m_used + i].data = m_slabs.back().get() + (size_t)i * m_chunkSize;
+		}
+		return &m_entries[m_used++];
 	}
+
+	// Full, recycle the least recently used entry.
+	CacheEntry* e = m_lru.prev;
+	Unlink(e);
+	m_index.erase(e->offset / m_chunkSize);
+	m_stats.evictions++;
+	return e;
 }
 
-void ChunksCache::Take(void* pMallocedSrc, PX_off_t offset, int length, int coverage)
+void ChunksCache::Take(const void* pSrc, PX_off_t offset, int length, int coverage)
 {
-	m_entries.push_front(new CacheEntry(pMallocedSrc, offset, length, coverage));
-	m_size += length;
-	MatchLimit();
+	// Only chunk aligned entries can be indexed. Anything else is simply not cached.
+	if (offset % m_chunkSize || length > (int)m_chunkSize || coverage > (int)m_chunkSize)
+		return;
+
+	CacheEntry*& slot = m_index[offset / m_chunkSize];
+	CacheEntry* e = slot;
+	if (e)
+		Unlink(e); // replace the existing entry for this chunk in place
+	else
+		e = slot = AllocEntry();
+
+	if (length > 0)
+		memcpy(e->data, pSrc, length);
+	e->offset = offset;
+	e->size = length;
+	e->coverage = coverage;
+	PushFront(e);
+}
+
+bool ChunksCache::Contains(PX_off_t offset, int length) const
+{
+	auto it = m_index.find(offset / m_chunkSize);
+	return it != m_index.end() && (offset + length) <= (it->second->offset + it->second->coverage);
 }
 
 // By design, succeed only if the entire request is in a single cached chunk
 int ChunksCache::Read(void* pDest, PX_off_t offset, int length)
 {
-	for (auto it = m_entries.begin(); it != m_entries.end(); it++)
+	auto it = m_index.find(offset / m_chunkSize);
+	if (it != m_index.end())
 	{
-		CacheEntry* e = *it;
-		if (e && offset >= e->offset && (offset + length) <= (e->offset + e->coverage))
+		CacheEntry* e = it->second;
+		if ((offset + length) <= (e->offset + e->coverage))
 		{
-			if (it != m_entries.begin())
-				m_entries.splice(m_entries.begin(), m_entries, it); // Move to top (MRU)
+			if (m_lru.next != e)
+			{
+				Unlink(e);
+				PushFront(e); // Move to top (MRU)
+			}
+			m_stats.hits++;
 			return CopyAvailable(e->data, e->offset, e->size, pDest, offset, length);
 		}
 	}
+
+	m_stats.misses++;
 	return -1;
 }
@@ -16,57 +16,85 @@
 #pragma once
 
 #include "zlib_indexed.h"
+#include <memory>
+#include <unordered_map>
 
 #define CLAMP(val, minval, maxval) (std::min(maxval, std::max(minval, val)))
 
+// --------------------------------------------------------------------------------------
+//  ChunksCache
+// --------------------------------------------------------------------------------------
+// LRU cache of extracted data, made of fixed size chunks.
+//
+// Entries must start at chunk boundaries (offset % chunkSize == 0) and may cover at most
+// one chunk, which lets lookups go straight to the entry through an index keyed by chunk
+// number. The data lives in slabs of chunk sized buffers which are allocated on demand
+// (until the limit is reached) and recycled afterwards, so reads don't allocate and inserts
+// don't allocate chunk buffers. The index is reserved for the whole pool, which avoids
+// rehashing, but it still allocates a node per insert and frees one per eviction.
+//
 class ChunksCache
 {
 public:
-	ChunksCache(uint initialLimitMb)
-		: m_entries(0)
-		, m_size(0)
-		, m_limit(initialLimitMb * 1024 * 1024){};
+	struct Stats
+	{
+		u64 hits;
+		u64 misses;
+		u64 evictions;
+	};
+
+	ChunksCache(uint initialLimitMb, uint chunkSize);
 	~ChunksCache() { Clear(); };
 	void SetLimit(uint megabytes);
-	void Clear() { MatchLimit(true); };
+	void Clear();
 
-	void Take(void* pMallocedSrc, PX_off_t offset, int length, int coverage);
+	// Copies length bytes from pSrc into the cache. coverage is the size of the range
+	// [offset, offset + coverage) which this entry answers for, and may be bigger than
+	// length when the chunk is at EOF.
+	void Take(const void* pSrc, PX_off_t offset, int length, int coverage);
 	int Read(void* pDest, PX_off_t offset, int length);
+	// Whether a read of [offset, offset + length) would hit, without touching the LRU order or the stats.
+	bool Contains(PX_off_t offset, int length) const;
 
-	static int CopyAvailable(void* pSrc, PX_off_t srcOffset, int srcSize,
+	const Stats& GetStats() const { return m_stats; }
+	void ResetStats() { memzero(m_stats); }
+
+	static int CopyAvailable(const void* pSrc, PX_off_t srcOffset, int srcSize,
 							 void* pDst, PX_off_t dstOffset, int maxCopySize)
 	{
-		int available = CLAMP(maxCopySize, 0, (int)(srcOffset + srcSize - dstOffset));
-		memcpy(pDst, (char*)pSrc + (dstOffset - srcOffset), available);
+		int available = CLAMP((int)(srcOffset + srcSize - dstOffset), 0, maxCopySize);
+		memcpy(pDst, (const char*)pSrc + (dstOffset - srcOffset), available);
 		return available;
 	};
 
 private:
-	class CacheEntry
+	struct CacheEntry
 	{
-	public:
-		CacheEntry(void* pMallocedSrc, PX_off_t offset, int length, int coverage)
-			: data(pMallocedSrc)
-			, offset(offset)
-			, coverage(coverage)
-			, size(length){};
-
-		~CacheEntry()
-		{
-			if (data)
-				free(data);
-		};
-
-		void* data;
+		u8* data;
 		PX_off_t offset;
 		int coverage;
 		int size;
+
+		// Intrusive LRU list
+		CacheEntry* prev;
+		CacheEntry* next;
 	};
 
-	std::list<CacheEntry*> m_entries;
-	void MatchLimit(bool removeAll = false);
-	PX_off_t m_size;
-	PX_off_t m_limit;
+	void Configure(uint megabytes);
+	CacheEntry* AllocEntry();
+	void Unlink(CacheEntry* e);
+	void PushFront(CacheEntry* e);
+
+	const uint m_chunkSize;
+	uint m_slabChunks;
+
+	std::vector<CacheEntry> m_entries; // fixed size pool, never reallocated while in use
+	std::vector<std::unique_ptr<u8[]>> m_slabs;
+	std::unordered_map<PX_off_t, CacheEntry*> m_index; // chunk number -> entry
+	uint m_used;                                       // entries handed out from the pool so far
+
+	CacheEntry m_lru; // sentinel, m_lru.next is the most recently used entry
+	Stats m_stats;
 };
 
 #undef CLAMP
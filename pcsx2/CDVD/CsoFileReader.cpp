@@ -23,9 +23,21 @@
 #else
 #include <zlib/zlib.h>
 #endif
+#ifdef PCSX2_LZ4
+#include <lz4.h>
+#endif
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 // Implementation of CSO compressed ISO reading, based on:
 // https://github.com/unknownbrackets/maxcso/blob/master/README_CSO.md
+//
+// ZSO files share the same header and index, with the frames compressed as raw LZ4
+// blocks. They are only supported when PCSX2 is built with LZ4 (PCSX2_LZ4).
 struct CsoHeader
 {
 	u8 magic[4];
@@ -38,11 +50,199 @@ struct CsoHeader
 };
 
 static const u32 CSO_READ_BUFFER_SIZE = 256 * 1024;
+// Threads decompressing a batch of frames, including the one asking for it.
+static const uint CSO_MAX_DECODE_THREADS = 4;
+
+static bool InitInflate(z_stream* z)
+{
+	z->zalloc = Z_NULL;
+	z->zfree = Z_NULL;
+	z->opaque = Z_NULL;
+	return inflateInit2(z, -15) == Z_OK;
+}
+
+// Decompresses one frame of frameSize bytes. z is only used for deflate frames.
+static bool DecodeFrame(z_stream* z, bool lz4, const u8* src, u32 srcSize, u8* dest, u32 frameSize)
+{
+	if (lz4)
+	{
+#ifdef PCSX2_LZ4
+		// srcSize may include the index alignment padding, so stop once the frame is complete.
+		return LZ4_decompress_safe_partial((const char*)src, (char*)dest, srcSize, frameSize, frameSize) == (int)frameSize;
+#else
+		return false;
+#endif
+	}
+
+	z->next_in = const_cast<u8*>(src);
+	z->avail_in = srcSize;
+	z->next_out = dest;
+	z->avail_out = frameSize;
+
+	int status = inflate(z, Z_FINISH);
+	bool success = status == Z_STREAM_END && z->total_out == frameSize;
+
+	inflateReset(z);
+	return success;
+}
+
+// --------------------------------------------------------------------------------------
+//  CsoBatchDecoder
+// --------------------------------------------------------------------------------------
+// Decompresses a batch of frames on a few worker threads. The thread calling Run()
+// takes part in the work, and frames are handed out one at a time, so a batch
+// with a mix of compressed and stored frames still spreads evenly.
+//
+struct CsoFrameJob
+{
+	const u8* src;
+	u32 srcSize;
+	u8* dest;
+	bool compressed;
+};
+
+class CsoBatchDecoder
+{
+	DeclareNoncopyableObject(CsoBatchDecoder);
+
+public:
+	CsoBatchDecoder(u32 frameSize, bool lz4);
+	~CsoBatchDecoder();
+
+	void Clear() { m_jobs.clear(); }
+	void Add(const CsoFrameJob& job) { m_jobs.push_back(job); }
+
+	// Decodes every job added since Clear(). z is the calling thread's stream.
+	bool Run(z_stream* z);
+
+private:
+	void WorkerThread();
+	uint DecodeJobs(z_stream* z);
+
+	const u32 m_frameSize;
+	const bool m_lz4;
+
+	std::vector<CsoFrameJob> m_jobs;
+	std::atomic<size_t> m_next;
+	std::atomic<bool> m_failed;
+
+	std::vector<std::thread> m_threads;
+	std::mutex m_lock; // protects everything below
+	std::condition_variable m_work_cv;
+	std::condition_variable m_done_cv;
+	u64 m_generation;
+	size_t m_finished;
+	uint m_active; // workers between picking up a batch and reporting back
+	bool m_running; // a batch is being decoded, the jobs must not change
+	bool m_quit;
+};
+
+CsoBatchDecoder::CsoBatchDecoder(u32 frameSize, bool lz4)
+	: m_frameSize(frameSize)
+	, m_lz4(lz4)
+	, m_next(0)
+	, m_failed(false)
+	, m_generation(0)
+	, m_finished(0)
+	, m_active(0)
+	, m_running(false)
+	, m_quit(false)
+{
+	uint threads = std::min(std::thread::hardware_concurrency(), CSO_MAX_DECODE_THREADS);
+	for (uint i = 1; i < threads; i++)
+		m_threads.emplace_back(&CsoBatchDecoder::WorkerThread, this);
+}
+
+CsoBatchDecoder::~CsoBatchDecoder()
+{
+	{
+		std::lock_guard<std::mutex> guard(m_lock);
+		m_quit = true;
+	}
+	m_work_cv.notify_all();
+
+	for (std::thread& t : m_threads)
+		t.join();
+}
+
+uint CsoBatchDecoder::DecodeJobs(z_stream* z)
+{
+	uint done = 0;
+	for (size_t i = m_next++; i < m_jobs.size(); i = m_next++)
+	{
+		const CsoFrameJob& job = m_jobs[i];
+		if (job.compressed)
+		{
+			if (!DecodeFrame(z, m_lz4, job.src, job.srcSize, job.dest, m_frameSize))
+				m_failed = true;
+		}
+		else
+		{
+			memcpy(job.dest, job.src, std::min(job.srcSize, m_frameSize));
+		}
+		done++;
+	}
+	return done;
+}
+
+void CsoBatchDecoder::WorkerThread()
+{
+	z_stream z;
+	const bool ready = m_lz4 || InitInflate(&z);
+
+	std::unique_lock<std::mutex> lock(m_lock);
+	u64 seen = m_generation;
+
+	while (true)
+	{
+		m_work_cv.wait(lock, [&] { return m_quit || (m_running && m_generation != seen); });
+		if (m_quit)
+			break;
+
+		seen = m_generation;
+		m_active++;
+		lock.unlock();
+
+		// Without a stream, leave the batch to the other threads.
+		uint done = ready ? DecodeJobs(&z) : 0;
+
+		lock.lock();
+		m_finished += done;
+		m_active--;
+		m_done_cv.notify_one();
+	}
+
+	if (ready && !m_lz4)
+		inflateEnd(&z);
+}
+
+bool CsoBatchDecoder::Run(z_stream* z)
+{
+	std::unique_lock<std::mutex> lock(m_lock);
+	m_next = 0;
+	m_failed = false;
+	m_finished = 0;
+	m_generation++;
+	m_running = true;
+	lock.unlock();
+	m_work_cv.notify_all();
+
+	uint done = DecodeJobs(z);
+
+	// Wait for the workers which picked up the batch to be done with it, the jobs
+	// must not change under them.
+	lock.lock();
+	m_finished += done;
+	m_done_cv.wait(lock, [&] { return m_finished == m_jobs.size() && m_active == 0; });
+	m_running = false;
+
+	return !m_failed;
+}
 
 bool CsoFileReader::CanHandle(const wxString& fileName)
 {
 	bool supported = false;
-	if (wxFileName::FileExists(fileName) && fileName.Lower().EndsWith(L".cso"))
+	if (wxFileName::FileExists(fileName) && (fileName.Lower().EndsWith(L".cso") || fileName.Lower().EndsWith(L".zso")))
 	{
 		FILE* fp = PX_fopen_rb(fileName);
 		CsoHeader hdr;
@@ -60,14 +260,22 @@ bool CsoFileReader::CanHandle(const wxString& fileName)
 
 bool CsoFileReader::ValidateHeader(const CsoHeader& hdr)
 {
-	if (hdr.magic[0] != 'C' || hdr.magic[1] != 'I' || hdr.magic[2] != 'S' || hdr.magic[3] != 'O')
+	const bool zso = hdr.magic[0] == 'Z';
+	if ((hdr.magic[0] != 'C' && !zso) || hdr.magic[1] != 'I' || hdr.magic[2] != 'S' || hdr.magic[3] != 'O')
 	{
 		// Invalid magic, definitely a bad file.
 		return false;
 	}
+#ifndef PCSX2_LZ4
+	if (zso)
+	{
+		Console.Error(L"ZSO files are not supported by this build (no LZ4 support).");
+		return false;
+	}
+#endif
 	if (hdr.ver > 1)
 	{
-		Console.Error(L"Only CSOv1 files are supported.");
+		Console.Error(L"Only CSOv1 and ZSOv1 files are supported.");
 		return false;
 	}
 	if ((hdr.frame_size & (hdr.frame_size - 1)) != 0)
@@ -133,6 +341,7 @@ bool CsoFileReader::ReadFileHeader()
 	// This is the index alignment (index values need shifting by this amount.)
 	m_indexShift = hdr.align;
 	m_totalSize = hdr.total_bytes;
+	m_lz4 = hdr.magic[0] == 'Z';
 
 	return true;
 }
@@ -165,10 +374,7 @@ bool CsoFileReader::InitializeBuffers()
 	}
 
 	m_z_stream = new z_stream;
-	m_z_stream->zalloc = Z_NULL;
-	m_z_stream->zfree = Z_NULL;
-	m_z_stream->opaque = Z_NULL;
-	if (inflateInit2(m_z_stream, -15) != Z_OK)
+	if (!InitInflate(m_z_stream))
 	{
 		Console.Error("Unable to initialize zlib for CSO decompression.");
 		return false;
@@ -189,9 +395,18 @@ void CsoFileReader::Close()
 		fclose(m_src);
 		m_src = NULL;
 	}
+	if (m_batch)
+	{
+		delete m_batch;
+		m_batch = NULL;
+	}
+	m_batchRaw.Free();
+	m_batchFrames.Free();
+
 	if (m_z_stream)
 	{
 		inflateEnd(m_z_stream);
+		delete m_z_stream;
 		m_z_stream = NULL;
 	}
 
@@ -219,8 +434,9 @@ int CsoFileReader::ReadSync(void* pBuffer, uint sector, uint count)
 		return 0;
 	}
 
-	// Note that, in practice, count will always be 1.  It seems one sector is read
-	// per interrupt, even if multiple are requested by the application.
+	// Note that, in practice, count will always be 1 for reads coming from the CDVD.
+	// It seems one sector is read per interrupt, even if multiple are requested by
+	// the application. ReadAheadFileReader asks for whole chunks though.
 
 	u8* dest = (u8*)pBuffer;
 	// We do it this way in case m_blocksize is not well aligned to our frame size.
@@ -228,6 +444,15 @@ int CsoFileReader::ReadSync(void* pBuffer, uint sector, uint count)
 	int remaining = count * m_blocksize;
 	int bytes = 0;
 
+#if !CSO_USE_CHUNKSCACHE
+	if (count > 1)
+	{
+		int batchBytes = ReadFrames(dest, pos, remaining);
+		if (batchBytes >= 0)
+			return batchBytes;
+	}
+#endif
+
 	while (remaining > 0)
 	{
 		int readBytes;
@@ -248,10 +473,8 @@ int CsoFileReader::ReadSync(void* pBuffer, uint sector, uint count)
 			}
 
 #if CSO_USE_CHUNKSCACHE
-			// Add the bytes into the cache.  We need to allocate a buffer for it.
-			void* cached = malloc(readBytes);
-			memcpy(cached, dest + bytes, readBytes);
-			m_cache.Take(cached, pos + bytes, readBytes, readBytes);
+			// Add the bytes into the cache.
+			m_cache.Take(dest + bytes, pos + bytes, readBytes, readBytes);
 #endif
 		}
 
@@ -320,15 +543,69 @@ int CsoFileReader::ReadFromFrame(u8* dest, u64 pos, int maxBytes)
 	return bytes;
 }
 
-bool CsoFileReader::DecompressFrame(u32 frame, u32 readBufferSize)
+// Reads all the frames covered by [pos, pos + maxBytes) with one fread, and decompresses
+// them at once. Returns -1 when the request doesn't span several frames, or when the
+// batch couldn't be read, so that the caller goes through ReadFromFrame instead.
+int CsoFileReader::ReadFrames(u8* dest, u64 pos, int maxBytes)
 {
-	m_z_stream->next_in = m_readBuffer;
-	m_z_stream->avail_in = readBufferSize;
-	m_z_stream->next_out = m_zlibBuffer;
-	m_z_stream->avail_out = m_frameSize;
+	if (pos >= m_totalSize)
+		return 0;
+
+	const u64 end = std::min<u64>(pos + maxBytes, m_totalSize);
+	const u32 first = (u32)(pos >> m_frameShift);
+	const u32 last = (u32)((end - 1) >> m_frameShift);
+	if (first == last)
+		return -1;
+
+	const u64 rawStart = (u64)(m_index[first] & 0x7FFFFFFF) << m_indexShift;
+	const u64 rawEnd = (u64)(m_index[last + 1] & 0x7FFFFFFF) << m_indexShift;
+	if (rawEnd < rawStart)
+		return -1;
+
+	m_batchRaw.MakeRoomFor(rawEnd - rawStart);
+	m_batchFrames.MakeRoomFor((last - first + 1) << m_frameShift);
 
-	int status = inflate(m_z_stream, Z_FINISH);
-	bool success = status == Z_STREAM_END && m_z_stream->total_out == m_frameSize;
+	if (PX_fseeko(m_src, m_dataoffset + rawStart, SEEK_SET) != 0)
+	{
+		Console.Error("Unable to seek to CSO data.");
+		return -1;
+	}
+	// As with single frames, the last frame may be short of its alignment padding.
+	const u64 rawRead = fread(m_batchRaw.GetPtr(), 1, rawEnd - rawStart, m_src);
+
+	if (!m_batch)
+		m_batch = new CsoBatchDecoder(m_frameSize, m_lz4);
+
+	m_batch->Clear();
+	for (u32 frame = first; frame <= last; frame++)
+	{
+		const u64 frameRawPos = ((u64)(m_index[frame + 0] & 0x7FFFFFFF) << m_indexShift) - rawStart;
+		const u64 frameRawEnd = std::min(((u64)(m_index[frame + 1] & 0x7FFFFFFF) << m_indexShift) - rawStart, rawRead);
+		if (frameRawEnd < frameRawPos)
+			return -1;
+
+		CsoFrameJob job;
+		job.src = m_batchRaw.GetPtr() + frameRawPos;
+		job.srcSize = (u32)(frameRawEnd - frameRawPos);
+		job.dest = m_batchFrames.GetPtr() + ((frame - first) << m_frameShift);
+		job.compressed = (m_index[frame + 0] & 0x80000000) == 0;
+		m_batch->Add(job);
+	}
+
+	if (!m_batch->Run(m_z_stream))
+	{
+		Console.Error("Unable to decompress CSO frames.");
+		return -1;
+	}
+
+	const int bytes = (int)(end - pos);
+	memcpy(dest, m_batchFrames.GetPtr() + (pos - ((u64)first << m_frameShift)), bytes);
+	return bytes;
+}
+
+bool CsoFileReader::DecompressFrame(u32 frame, u32 readBufferSize)
+{
+	bool success = DecodeFrame(m_z_stream, m_lz4, m_readBuffer, readBufferSize, m_zlibBuffer, m_frameSize);
 	if (success)
 	{
 		// Our buffer now contains this frame.
@@ -336,11 +613,10 @@ bool CsoFileReader::DecompressFrame(u32 frame, u32 readBufferSize)
 	}
 	else
 	{
-		Console.Error("Unable to decompress CSO frame using zlib.");
+		Console.Error(m_lz4 ? "Unable to decompress ZSO frame using LZ4." : "Unable to decompress CSO frame using zlib.");
 		m_zlibBufferFrame = (u32)-1;
 	}
 
-	inflateReset(m_z_stream);
 	return success;
 }
 
@@ -28,9 +28,12 @@
 #include "ChunksCache.h"
 
 struct CsoHeader;
+class CsoBatchDecoder;
 typedef struct z_stream_s z_stream;
 
 static const uint CSO_CHUNKCACHE_SIZE_MB = 200;
+// Each cached read covers at most one sector, so index the cache by sector.
+static const uint CSO_CHUNKCACHE_CHUNK_SIZE = 2048;
 
 class CsoFileReader : public AsyncFileReader
 {
@@ -41,6 +44,7 @@ public:
 		: m_frameSize(0)
 		, m_frameShift(0)
 		, m_indexShift(0)
+		, m_lz4(false)
 		, m_readBuffer(0)
 		, m_zlibBuffer(0)
 		, m_zlibBufferFrame(0)
@@ -48,9 +52,10 @@ public:
 		, m_totalSize(0)
 		, m_src(0)
 		, m_z_stream(0)
+		, m_batch(0)
 		,
 #if CSO_USE_CHUNKSCACHE
-		m_cache(CSO_CHUNKCACHE_SIZE_MB)
+		m_cache(CSO_CHUNKCACHE_SIZE_MB, CSO_CHUNKCACHE_CHUNK_SIZE)
 		,
 #endif
 		m_bytesRead(0)
@@ -84,11 +89,14 @@ private:
 	bool ReadFileHeader();
 	bool InitializeBuffers();
 	int ReadFromFrame(u8* dest, u64 pos, int maxBytes);
+	int ReadFrames(u8* dest, u64 pos, int maxBytes);
 	bool DecompressFrame(u32 frame, u32 readBufferSize);
 
 	u32 m_frameSize;
 	u8 m_frameShift;
 	u8 m_indexShift;
+	// ZSO files use the CSO layout with LZ4 compressed frames instead of deflate.
+	bool m_lz4;
 	u8* m_readBuffer;
 	u8* m_zlibBuffer;
 	u32 m_zlibBufferFrame;
@@ -98,6 +106,12 @@ private:
 	FILE* m_src;
 	z_stream* m_z_stream;
 
+	// Reads covering several frames fetch them with a single fread and decompress
+	// them in parallel.
+	CsoBatchDecoder* m_batch;
+	ScopedAlloc<u8> m_batchRaw;
+	ScopedAlloc<u8> m_batchFrames;
+
 #if CSO_USE_CHUNKSCACHE
 	ChunksCache m_cache;
 #endif
@@ -14,7 +14,11 @@
 */
 
 #include "PrecompiledHeader.h"
+#include <algorithm>
+#include <condition_variable>
 #include <fstream>
+#include <mutex>
+#include <thread>
 #include <wx/stdpaths.h>
 #include "AppConfig.h"
 #include "ChunksCache.h"
@@ -185,20 +189,170 @@ static wxString iso2indexname(const wxString& isoname)
 	wxDirName appRoot = // TODO: have only one of this in PCSX2. Right now have few...
 		(wxDirName)(wxFileName(wxStandardPaths::Get().GetExecutablePath()).GetPath());
 	//TestTemplate(appRoot, isoname, false);
-	return ApplyTemplate(L"gzip index", appRoot, g_Conf->GzipIsoIndexTemplate, isoname, false);
+	// Tools which don't load the configuration (cdvd_trace_bench) get the default template.
+	const wxString indexTemplate(g_Conf ? g_Conf->GzipIsoIndexTemplate : wxString(L"$(f).pindex.tmp"));
+	return ApplyTemplate(L"gzip index", appRoot, indexTemplate, isoname, false);
+}
+
+// --------------------------------------------------------------------------------------
+//  GzippedFileReader::IndexBuilder
+// --------------------------------------------------------------------------------------
+// Runs build_index() on its own thread, and publishes every access point as soon as it's
+// known. Reads which are already covered by those points don't have to wait until the
+// whole file was scanned, which takes a while for a DVD image.
+class GzippedFileReader::IndexBuilder
+{
+public:
+	IndexBuilder(const wxString& filename, const wxString& indexfile);
+	~IndexBuilder();
+
+	// Waits until the access point to start extracting offset from is known, that is, until
+	// there's a point after offset. Returns that point, which stays valid for the lifetime of
+	// the builder, or NULL once the build has ended (use TakeIndex() then).
+	const Point* WaitForPoint(PX_off_t offset);
+
+	void Wait();
+	bool IsDone();
+
+	// Returns the complete index, which is then owned by the caller, or NULL if the build failed.
+	Access* TakeIndex();
+
+private:
+	static int OnPoint(void* ctx, const Point* point);
+	void Run();
+
+	wxString m_filename;
+	wxString m_indexfile;
+
+	std::thread m_thread;
+	std::mutex m_lock;
+	std::condition_variable m_cv;
+	std::vector<std::unique_ptr<Point>> m_points;
+	bool m_done;
+	bool m_cancel;
+	Access* m_index;
+};
+
+GzippedFileReader::IndexBuilder::IndexBuilder(const wxString& filename, const wxString& indexfile)
+	: m_filename(filename)
+	, m_indexfile(indexfile)
+	, m_done(false)
+	, m_cancel(false)
+	, m_index(NULL)
+{
+	m_thread = std::thread(&IndexBuilder::Run, this);
+}
+
+GzippedFileReader::IndexBuilder::~IndexBuilder()
+{
+	{
+		std::lock_guard<std::mutex> guard(m_lock);
+		m_cancel = true;
+	}
+	m_thread.join();
+
+	free_index(m_index);
+}
+
+void GzippedFileReader::IndexBuilder::Run()
+{
+	Access* index = NULL;
+	int len = Z_ERRNO;
+
+	FILE* infile = PX_fopen_rb(m_filename);
+	if (infile)
+	{
+		len = build_index(infile, GZFILE_SPAN_DEFAULT, &index, OnPoint, this);
+		fclose(infile);
+	}
+
+	if (len > 0)
+	{
+		WriteIndexToFile(index, m_indexfile);
+	}
+	else if (len != Z_STREAM_ERROR) // not canceled
+	{
+		Console.Error(L"ERROR (%d): index could not be generated for file '%s'", len, WX_STR(m_filename));
+	}
+
+	std::lock_guard<std::mutex> guard(m_lock);
+	m_index = len > 0 ? index : NULL;
+	m_done = true;
+	m_cv.notify_all();
+}
+
+int GzippedFileReader::IndexBuilder::OnPoint(void* ctx, const Point* point)
+{
+	IndexBuilder* builder = (IndexBuilder*)ctx;
+	std::lock_guard<std::mutex> guard(builder->m_lock);
+	if (builder->m_cancel)
+		return 1;
+
+	builder->m_points.emplace_back(new Point(*point));
+	builder->m_cv.notify_all();
+	return 0;
+}
+
+const Point* GzippedFileReader::IndexBuilder::WaitForPoint(PX_off_t offset)
+{
+	std::unique_lock<std::mutex> lock(m_lock);
+	m_cv.wait(lock, [&] { return m_done || (!m_points.empty() && m_points.back()->out > offset); });
+	if (m_done)
+		return NULL;
+
+	// The first point is at offset 0, so there's always one at or before offset.
+	auto next = std::upper_bound(m_points.begin(), m_points.end(), offset,
+								 [](PX_off_t o, const std::unique_ptr<Point>& p) { return o < p->out; });
+	return (next - 1)->get();
+}
+
+void GzippedFileReader::IndexBuilder::Wait()
+{
+	std::unique_lock<std::mutex> lock(m_lock);
+	m_cv.wait(lock, [&] { return m_done; });
+}
+
+bool GzippedFileReader::IndexBuilder::IsDone()
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	return m_done;
+}
+
+Access* GzippedFileReader::IndexBuilder::TakeIndex()
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	Access* index = m_index;
+	m_index = NULL;
+	return index;
 }
 
 GzippedFileReader::GzippedFileReader(void)
 	: mBytesRead(0)
 	, m_pIndex(0)
+	, m_estimatedSize(0)
 	, m_zstates(0)
 	, m_src(0)
-	, m_cache(GZFILE_CACHE_SIZE_MB)
+	, m_cache(GZFILE_CACHE_SIZE_MB, GZFILE_READ_CHUNK_SIZE)
 {
 	m_blocksize = 2048;
 	AsyncPrefetchReset();
 };
 
+GzippedFileReader::~GzippedFileReader(void)
+{
+	Close();
+}
+
+PX_off_t GzippedFileReader::GetUncompressedSize() const
+{
+	return m_pIndex ? m_pIndex->uncompressed_size : m_estimatedSize;
+}
+
+int GzippedFileReader::GetSpan() const
+{
+	return m_pIndex ? m_pIndex->span : GZFILE_SPAN_DEFAULT;
+}
+
 void GzippedFileReader::InitZstates()
 {
 	if (m_zstates)
@@ -206,11 +360,11 @@ void GzippedFileReader::InitZstates()
 		delete[] m_zstates;
 		m_zstates = 0;
 	}
-	if (!m_pIndex)
+	if (!m_pIndex && !m_builder)
 		return;
 
 	// having another extra element helps avoiding logic for last (so 2+ instead of 1+)
-	int size = 2 + m_pIndex->uncompressed_size / m_pIndex->span;
+	int size = 2 + GetUncompressedSize() / GetSpan();
 	m_zstates = new Czstate[size]();
 }
 
@@ -306,6 +460,20 @@ bool GzippedFileReader::OkIndex()
 	if (m_pIndex)
 		return true;
 
+	if (m_builder)
+	{
+		if (!m_builder->IsDone())
+			return true; // Reads use the access points which are known so far
+
+		// A failed builder is kept around, so that it isn't restarted on every read.
+		if (!(m_pIndex = m_builder->TakeIndex()))
+			return false;
+
+		m_builder.reset();
+		InitZstates();
+		return true;
+	}
+
 	// Try to read index from disk
 	wxString indexfile = iso2indexname(m_filename);
 	if (indexfile.length() == 0)
@@ -326,31 +494,75 @@ bool GzippedFileReader::OkIndex()
 	}
 
 	// No valid index file. Generate an index
-	Console.Warning(L"This may take a while (but only once). Scanning compressed file to generate a quick access index...");
+	return StartIndexBuild(indexfile);
+}
 
-	Access* index;
-	FILE* infile = PX_fopen_rb(m_filename);
-	int len = build_index(infile, GZFILE_SPAN_DEFAULT, &index);
-	printf("\n"); // build_index prints progress without \n's
-	fclose(infile);
+// The index is built in the background. Reads can start as soon as the access points
+// before them are known, but the size of the data has to be known right away.
+bool GzippedFileReader::StartIndexBuild(const wxString& indexfile)
+{
+	Console.WriteLn(Color_Gray, L"Scanning compressed file in the background to generate a quick access index...");
 
-	if (len >= 0)
-	{
-		m_pIndex = index;
-		WriteIndexToFile((Access*)m_pIndex, indexfile);
-	}
-	else
+	m_builder.reset(new IndexBuilder(m_filename, indexfile));
+	m_estimatedSize = 0;
+	InitZstates(); // Enough for the reads done by the estimation
+
+	PX_off_t size = EstimateUncompressedSize();
+	if (!m_builder)
+		return OkIndex(); // Done already
+
+	if (size <= 0)
 	{
-		Console.Error(L"ERROR (%d): index could not be generated for file '%s'", len, WX_STR(m_filename));
-		free_index(index);
-		InitZstates();
-		return false;
+		Console.Warning(L"This may take a while (but only once). Scanning compressed file to generate a quick access index...");
+		m_builder->Wait();
+		return OkIndex();
 	}
 
+	m_estimatedSize = size;
 	InitZstates();
 	return true;
 }
 
+// The gzip trailer only has the size modulo 4GB. The ISO9660 primary volume descriptor
+// has the size of the volume, which is close enough to pick the right multiple of 4GB.
+PX_off_t GzippedFileReader::EstimateUncompressedSize()
+{
+	u8 trailer[4];
+	if (PX_fseeko(m_src, -4, SEEK_END) != 0 || fread(trailer, 1, sizeof(trailer), m_src) != sizeof(trailer))
+		return -1;
+
+	const PX_off_t sizeMod = trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) | ((u32)trailer[3] << 24);
+
+	static const struct
+	{
+		int blocksize;
+		int dataoffset;
+	} layouts[] = {
+		{2048, 0},  // ISO
+		{2352, 16}, // RAW, mode 1
+		{2352, 24}, // RAW, mode 2
+		{2448, 16}, // RAWQ, mode 1
+		{2448, 24}, // RAWQ, mode 2
+	};
+
+	for (const auto& layout : layouts)
+	{
+		u8 pvd[88];
+		if (_ReadSync(pvd, 16 * layout.blocksize + layout.dataoffset, sizeof(pvd)) != sizeof(pvd))
+			continue;
+		if (pvd[0] != 1 || memcmp(pvd + 1, "CD001", 5))
+			continue;
+
+		// Volume space size, both-endian, little-endian half first
+		u32 blocks = pvd[80] | (pvd[81] << 8) | (pvd[82] << 16) | ((u32)pvd[83] << 24);
+		PX_off_t volume = (PX_off_t)blocks * layout.blocksize;
+		PX_off_t wraps = std::max<PX_off_t>(0, (volume - sizeMod + (1LL << 31)) >> 32);
+		return sizeMod + (wraps << 32);
+	}
+
+	return -1;
+}
+
 bool GzippedFileReader::Open(const wxString& fileName)
 {
 	Close();
@@ -395,7 +607,7 @@ int GzippedFileReader::ReadSync(void* pBuffer, uint sector, uint count)
 // If we have a valid and adequate zstate for this span, use it, else, use the index
 PX_off_t GzippedFileReader::GetOptimalExtractionStart(PX_off_t offset)
 {
-	int span = m_pIndex->span;
+	int span = GetSpan();
 	Czstate& cstate = m_zstates[offset / span];
 	PX_off_t stateOffset = cstate.state.isValid ? cstate.state.out_offset : 0;
 	if (stateOffset && stateOffset <= offset)
@@ -445,10 +657,36 @@ int GzippedFileReader::_ReadSync(void* pBuffer, PX_off_t offset, uint bytesToRea
 	int size = offset + maxInChunk - extractOffset;
 	unsigned char* extracted = (unsigned char*)malloc(size);
 
-	int span = m_pIndex->span;
+	int span = GetSpan();
 	int spanix = extractOffset / span;
+
+	Access* index = m_pIndex;
+	Access partial;
+	if (!index)
+	{
+		// The index is still being built. Start from the known point before extractOffset.
+		const Point* here = m_builder->WaitForPoint(extractOffset);
+		if (here)
+		{
+			partial.have = partial.size = 1;
+			partial.list = (Point*)here;
+			partial.span = span;
+			partial.uncompressed_size = m_estimatedSize;
+			index = &partial;
+		}
+		else if (OkIndex())
+		{
+			index = m_pIndex; // Completed meanwhile, which also reset the zstates
+		}
+		else
+		{
+			free(extracted);
+			return -1;
+		}
+	}
+
 	AsyncPrefetchCancel();
-	res = extract(m_src, m_pIndex, extractOffset, extracted, size, &(m_zstates[spanix].state));
+	res = extract(m_src, index, extractOffset, extracted, size, &(m_zstates[spanix].state));
 	if (res < 0)
 	{
 		free(extracted);
@@ -473,20 +711,13 @@ int GzippedFileReader::_ReadSync(void* pBuffer, PX_off_t offset, uint bytesToRea
 		m_zstates[spanix].Kill();
 	}
 
-	if (size <= GZFILE_READ_CHUNK_SIZE)
-		m_cache.Take(extracted, extractOffset, res, size);
-	else
-	{ // split into cacheable chunks
-		for (int i = 0; i < size; i += GZFILE_READ_CHUNK_SIZE)
-		{
-			int available = CLAMP(res - i, 0, GZFILE_READ_CHUNK_SIZE);
-			void* chunk = available ? malloc(available) : 0;
-			if (available)
-				memcpy(chunk, extracted + i, available);
-			m_cache.Take(chunk, extractOffset + i, available, std::min(size - i, GZFILE_READ_CHUNK_SIZE));
-		}
-		free(extracted);
+	// split into cacheable chunks
+	for (int i = 0; i < size; i += GZFILE_READ_CHUNK_SIZE)
+	{
+		int available = CLAMP(res - i, 0, GZFILE_READ_CHUNK_SIZE);
+		m_cache.Take(extracted + i, extractOffset + i, available, std::min(size - i, GZFILE_READ_CHUNK_SIZE));
 	}
+	free(extracted);
 
 	int duration = NOW() - s;
 	if (duration > 10)
@@ -502,6 +733,8 @@ int GzippedFileReader::_ReadSync(void* pBuffer, PX_off_t offset, uint bytesToRea
 void GzippedFileReader::Close()
 {
 	m_filename.Empty();
+	m_builder.reset();
+	m_estimatedSize = 0;
 	if (m_pIndex)
 	{
 		free_index((Access*)m_pIndex);
@@ -509,7 +742,13 @@ void GzippedFileReader::Close()
 	}
 
 	InitZstates(); // results in delete because no index
+
+	const ChunksCache::Stats& stats = m_cache.GetStats();
+	if (stats.hits + stats.misses)
+		Console.WriteLn(Color_Gray, L"gunzip: cache hits: %llu, misses: %llu, evictions: %llu",
+						stats.hits, stats.misses, stats.evictions);
 	m_cache.Clear();
+	m_cache.ResetStats();
 
 	if (m_src)
 	{
@@ -21,6 +21,8 @@ typedef struct zstate Zstate;
 #include "ChunksCache.h"
 #include "zlib_indexed.h"
 
+#include <memory>
+
 #define GZFILE_SPAN_DEFAULT (1048576L * 4)  /* distance between direct access points when creating a new index */
 #define GZFILE_READ_CHUNK_SIZE (256 * 1024) /* zlib extraction chunks size (at 0-based boundaries) */
 #define GZFILE_CACHE_SIZE_MB 200            /* cache size for extracted data. must be at least GZFILE_READ_CHUNK_SIZE (in MB)*/
@@ -32,7 +34,7 @@ class GzippedFileReader : public AsyncFileReader
 public:
 	GzippedFileReader(void);
 
-	virtual ~GzippedFileReader(void) { Close(); };
+	virtual ~GzippedFileReader(void);
 
 	static bool CanHandle(const wxString& fileName);
 	virtual bool Open(const wxString& fileName);
@@ -49,7 +51,7 @@ public:
 	{
 		// type and formula copied from FlatFileReader
 		// FIXME? : Shouldn't it be uint and (size - m_dataoffset) / m_blocksize ?
-		return (int)((m_pIndex ? m_pIndex->uncompressed_size : 0) / m_blocksize);
+		return (int)(GetUncompressedSize() / m_blocksize);
 	};
 
 	virtual void SetBlockSize(uint bytes) { m_blocksize = bytes; }
@@ -70,13 +72,24 @@ private:
 		Zstate state;
 	};
 
+	class IndexBuilder;
+
 	bool OkIndex(); // Verifies that we have an index, or try to create one
+	bool StartIndexBuild(const wxString& indexfile);
+	PX_off_t EstimateUncompressedSize();
+	PX_off_t GetUncompressedSize() const;
+	int GetSpan() const;
 	PX_off_t GetOptimalExtractionStart(PX_off_t offset);
 	int _ReadSync(void* pBuffer, PX_off_t offset, uint bytesToRead);
 	void InitZstates();
 
 	int mBytesRead;   // Temp sync read result when simulating async read
 	Access* m_pIndex; // Quick access index
+
+	// While there's no index on disk, it's built in the background and reads use
+	// the access points which are already known, see OkIndex().
+	std::unique_ptr<IndexBuilder> m_builder;
+	PX_off_t m_estimatedSize;
 	Czstate* m_zstates;
 	FILE* m_src;
 
@@ -17,6 +17,7 @@
 #include "PrecompiledHeader.h"
 #include "IopCommon.h"
 #include "IsoFileFormats.h"
+#include "ReadAheadFileReader.h"
 
 #include <errno.h>
 
@@ -82,6 +83,13 @@ void InputIsoFile::BeginRead2(uint lsn)
 		m_read_count = std::min(ReadUnit, m_blocks - m_read_lsn);
 	}
 
+	// Memory mapped readers hand out the sectors directly, which saves the trip
+	// through m_readbuffer.
+	m_read_ptr = m_reader->MapSectors(m_read_lsn, m_read_count);
+	if (m_read_ptr)
+		return;
+
+	m_read_ptr = m_readbuffer;
 	m_reader->BeginRead(m_readbuffer, m_read_lsn, m_read_count);
 	m_read_inprogress = true;
 }
@@ -148,7 +156,7 @@ int InputIsoFile::FinishRead3(u8* dst, uint mode)
 	length = end - _offset;
 
 	uint read_offset = (m_current_lsn - m_read_lsn) * m_blocksize;
-	memcpy(dst + diff, m_readbuffer + ndiff + read_offset, length);
+	memcpy(dst + diff, m_read_ptr + ndiff + read_offset, length);
 
 	if (m_type == ISOTYPE_CD && diff >= 12)
 	{
@@ -181,6 +189,7 @@ void InputIsoFile::_init()
 
 	m_read_inprogress = false;
 	m_read_count = 0;
+	m_read_ptr = m_readbuffer;
 	ReadUnit = 0;
 	m_current_lsn = -1;
 	m_read_lsn = -1;
@@ -221,7 +230,7 @@ bool InputIsoFile::Open(const wxString& srcfile, bool testOnly)
 		// Allow write sharing of the iso based on the ini settings.
 		// Mostly useful for romhacking, where the disc is frequently
 		// changed and the emulator would block modifications
-		m_reader = new FlatFileReader(EmuConfig.CdvdShareWrite);
+		m_reader = new FlatFileReader(EmuConfig.CdvdShareWrite, EmuConfig.CdvdMemoryMapped);
 	}
 
 	m_reader->Open(m_filename);
@@ -268,6 +277,12 @@ bool InputIsoFile::Open(const wxString& srcfile, bool testOnly)
 			delete m_reader_old;
 	}
 
+	if (isCompressed)
+	{
+		// Move the decompression off the reading thread and read ahead of sequential reads.
+		m_reader = new ReadAheadFileReader(m_reader);
+	}
+
 	m_blocks = m_reader->GetBlockCount();
 
 	Console.WriteLn(Color_StrongBlue, L"isoFile open ok: %s", WX_STR(m_filename));
@@ -63,6 +63,7 @@ protected:
 	bool m_read_inprogress;
 	uint m_read_lsn;
 	uint m_read_count;
+	const u8* m_read_ptr; // the buffered sectors, either m_readbuffer or mapped by the reader
 	u8 m_readbuffer[MaxReadUnit * CD_FRAMESIZE_RAW];
 
 public:
@@ -0,0 +1,309 @@
+/*  PCSX2 - PS2 Emulator for PCs
+*  Copyright (C) 2002-2020  PCSX2 Dev Team
+*
+*  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+*  of the GNU Lesser General Public License as published by the Free Software Found-
+*  ation, either version 3 of the License, or (at your option) any later version.
+*
+*  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+*  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+*  PURPOSE.  See the GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License along with PCSX2.
+*  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "PrecompiledHeader.h"
+#include "ReadAheadFileReader.h"
+
+#include <algorithm>
+
+ReadAheadFileReader::ReadAheadFileReader(AsyncFileReader* source)
+	: m_source(source)
+	, m_inflight(NoChunk)
+	, m_quit(false)
+	, m_last_chunk(NoChunk)
+	, m_read_buffer(NULL)
+	, m_read_sector(0)
+	, m_read_count(0)
+{
+	m_filename = source->GetFilename();
+	m_blocksize = source->GetBlockSize();
+
+	ResetCache();
+	StartThread();
+}
+
+ReadAheadFileReader::~ReadAheadFileReader(void)
+{
+	Close();
+	delete m_source;
+}
+
+bool ReadAheadFileReader::Open(const wxString& fileName)
+{
+	Close();
+
+	if (!m_source->Open(fileName))
+		return false;
+
+	m_filename = fileName;
+	m_blocksize = m_source->GetBlockSize();
+
+	ResetCache();
+	StartThread();
+	return true;
+}
+
+void ReadAheadFileReader::Close(void)
+{
+	StopThread();
+
+	m_queue.clear();
+	m_last_chunk = NoChunk;
+	m_read_buffer = NULL;
+
+	m_source->Close();
+}
+
+void ReadAheadFileReader::StartThread()
+{
+	if (m_thread.joinable())
+		return;
+
+	m_quit = false;
+	m_inflight = NoChunk;
+	m_thread = std::thread(&ReadAheadFileReader::WorkerThread, this);
+}
+
+void ReadAheadFileReader::StopThread()
+{
+	{
+		std::lock_guard<std::mutex> guard(m_lock);
+		m_quit = true;
+	}
+	m_work_cv.notify_one();
+
+	if (m_thread.joinable())
+		m_thread.join();
+}
+
+void ReadAheadFileReader::WorkerThread()
+{
+	std::unique_lock<std::mutex> lock(m_lock);
+
+	while (!m_quit)
+	{
+		if (m_queue.empty())
+		{
+			m_work_cv.wait(lock);
+			continue;
+		}
+
+		u32 chunk = m_queue.front();
+		m_queue.pop_front();
+
+		if (m_cache->Contains(ChunkOffset(chunk), ChunkBytes()))
+			continue;
+
+		m_inflight = chunk;
+		lock.unlock();
+
+		int bytes;
+		{
+			std::lock_guard<std::mutex> guard(m_source_lock);
+			bytes = ReadChunkFromSource(chunk, m_worker_buffer.GetPtr());
+		}
+
+		lock.lock();
+		if (bytes >= 0)
+			m_cache->Take(m_worker_buffer.GetPtr(), ChunkOffset(chunk), bytes, ChunkBytes());
+		else
+			m_queue.clear(); // If the read fails, further reads are likely to fail too.
+
+		m_inflight = NoChunk;
+		m_done_cv.notify_all();
+	}
+}
+
+void ReadAheadFileReader::Invalidate(std::unique_lock<std::mutex>& lock)
+{
+	m_queue.clear();
+	m_last_chunk = NoChunk;
+
+	while (m_inflight != NoChunk)
+		m_done_cv.wait(lock);
+}
+
+void ReadAheadFileReader::ResetCache()
+{
+	pxAssertDev(m_blocksize, "ReadAheadFileReader: the source must have a block size");
+
+	m_cache.reset(new ChunksCache(RA_CACHE_SIZE_MB, ChunkBytes()));
+	m_worker_buffer.Alloc(ChunkBytes());
+	m_sync_buffer.Alloc(ChunkBytes());
+}
+
+void ReadAheadFileReader::SetBlockSize(uint bytes)
+{
+	std::unique_lock<std::mutex> lock(m_lock);
+	Invalidate(lock);
+
+	m_source->SetBlockSize(bytes);
+	m_blocksize = m_source->GetBlockSize();
+	ResetCache();
+}
+
+void ReadAheadFileReader::SetDataOffset(int bytes)
+{
+	std::unique_lock<std::mutex> lock(m_lock);
+	Invalidate(lock);
+
+	m_source->SetDataOffset(bytes);
+	m_dataoffset = bytes;
+	ResetCache();
+}
+
+uint ReadAheadFileReader::GetBlockCount(void) const
+{
+	return m_source->GetBlockCount();
+}
+
+int ReadAheadFileReader::ReadChunkFromSource(u32 chunk, u8* dest)
+{
+	uint blocks = m_source->GetBlockCount();
+	uint sector = chunk * RA_CHUNK_SECTORS;
+	if (sector >= blocks)
+		return 0;
+
+	return m_source->ReadSync(dest, sector, std::min(RA_CHUNK_SECTORS, blocks - sector));
+}
+
+void ReadAheadFileReader::QueueChunk(u32 chunk, bool front)
+{
+	if (chunk == m_inflight || m_cache->Contains(ChunkOffset(chunk), ChunkBytes()))
+		return;
+
+	auto it = std::find(m_queue.begin(), m_queue.end(), chunk);
+	if (it != m_queue.end())
+	{
+		if (!front)
+			return;
+		m_queue.erase(it);
+	}
+
+	if (front)
+		m_queue.push_front(chunk);
+	else
+		m_queue.push_back(chunk);
+}
+
+int ReadAheadFileReader::ReadChunks(void* pBuffer, uint sector, uint count)
+{
+	u8* dest = (u8*)pBuffer;
+	int total = 0;
+
+	while (count > 0)
+	{
+		const u32 chunk = sector / RA_CHUNK_SECTORS;
+		const uint sectors = std::min(count, RA_CHUNK_SECTORS - sector % RA_CHUNK_SECTORS);
+		const PX_off_t offset = (PX_off_t)sector * m_blocksize;
+		const int bytes = sectors * m_blocksize;
+
+		std::unique_lock<std::mutex> lock(m_lock);
+
+		int res;
+		while ((res = m_cache->Read(dest, offset, bytes)) < 0 && m_inflight == chunk)
+			m_done_cv.wait(lock);
+
+		if (res < 0)
+		{
+			// Neither cached nor being read, read it here. Make sure the worker won't
+			// read it a second time.
+			auto it = std::find(m_queue.begin(), m_queue.end(), chunk);
+			if (it != m_queue.end())
+				m_queue.erase(it);
+			lock.unlock();
+
+			int chunkBytes;
+			{
+				std::lock_guard<std::mutex> guard(m_source_lock);
+				chunkBytes = ReadChunkFromSource(chunk, m_sync_buffer.GetPtr());
+			}
+			if (chunkBytes < 0)
+				return chunkBytes;
+
+			lock.lock();
+			m_cache->Take(m_sync_buffer.GetPtr(), ChunkOffset(chunk), chunkBytes, ChunkBytes());
+			res = ChunksCache::CopyAvailable(m_sync_buffer.GetPtr(), ChunkOffset(chunk), chunkBytes, dest, offset, bytes);
+		}
+
+		total += res;
+		if (res < bytes)
+			break; // EOF
+
+		dest += res;
+		sector += sectors;
+		count -= sectors;
+	}
+
+	return total;
+}
+
+int ReadAheadFileReader::ReadSync(void* pBuffer, uint sector, uint count)
+{
+	return ReadChunks(pBuffer, sector, count);
+}
+
+void ReadAheadFileReader::BeginRead(void* pBuffer, uint sector, uint count)
+{
+	m_read_buffer = pBuffer;
+	m_read_sector = sector;
+	m_read_count = count;
+
+	if (!count)
+		return;
+
+	const u32 first = sector / RA_CHUNK_SECTORS;
+	const u32 last = (sector + count - 1) / RA_CHUNK_SECTORS;
+	const u32 chunks = (GetBlockCount() + RA_CHUNK_SECTORS - 1) / RA_CHUNK_SECTORS;
+
+	{
+		std::lock_guard<std::mutex> guard(m_lock);
+
+		// Only prefetch while the reads look sequential, a seek makes the queued
+		// prefetches useless.
+		bool sequential = m_last_chunk != NoChunk && first >= m_last_chunk && first <= m_last_chunk + 1;
+		if (!sequential)
+			m_queue.clear();
+
+		// The requested chunks go in front of any prefetch, in order.
+		for (u32 chunk = last + 1; chunk-- > first;)
+			QueueChunk(chunk, true);
+
+		if (sequential)
+		{
+			for (u32 chunk = last + 1; chunk <= last + RA_MAX_PREFETCH_CHUNKS && chunk < chunks; chunk++)
+				QueueChunk(chunk, false);
+		}
+
+		m_last_chunk = last;
+	}
+
+	m_work_cv.notify_one();
+}
+
+int ReadAheadFileReader::FinishRead(void)
+{
+	if (!m_read_buffer)
+		return -1;
+
+	int res = ReadChunks(m_read_buffer, m_read_sector, m_read_count);
+	m_read_buffer = NULL;
+	return res;
+}
+
+void ReadAheadFileReader::CancelRead(void)
+{
+	m_read_buffer = NULL;
+}
@@ -0,0 +1,106 @@
+/*  PCSX2 - PS2 Emulator for PCs
+*  Copyright (C) 2002-2020  PCSX2 Dev Team
+*
+*  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+*  of the GNU Lesser General Public License as published by the Free Software Found-
+*  ation, either version 3 of the License, or (at your option) any later version.
+*
+*  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+*  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+*  PURPOSE.  See the GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License along with PCSX2.
+*  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "AsyncFileReader.h"
+#include "ChunksCache.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+// --------------------------------------------------------------------------------------
+//  ReadAheadFileReader
+// --------------------------------------------------------------------------------------
+// Wraps a reader whose reads are expensive (the compressed readers decompress inside
+// ReadSync/BeginRead) and moves that work to a worker thread.
+//
+// Reads are done in chunks of RA_CHUNK_SECTORS sectors. BeginRead() queues the chunks
+// of the request to the worker, and when the requests are sequential, the chunks which
+// follow them as well, the same way CDVDdiscThread prefetches physical discs. FinishRead()
+// then usually only has to copy the data out of the cache.
+//
+static const uint RA_CHUNK_SECTORS = 32;
+static const uint RA_MAX_PREFETCH_CHUNKS = 16;
+static const uint RA_CACHE_SIZE_MB = 32;
+
+class ReadAheadFileReader : public AsyncFileReader
+{
+	DeclareNoncopyableObject(ReadAheadFileReader);
+
+public:
+	// Takes ownership of source, which must already be opened.
+	ReadAheadFileReader(AsyncFileReader* source);
+	virtual ~ReadAheadFileReader(void);
+
+	virtual bool Open(const wxString& fileName);
+
+	virtual int ReadSync(void* pBuffer, uint sector, uint count);
+
+	virtual void BeginRead(void* pBuffer, uint sector, uint count);
+	virtual int FinishRead(void);
+	virtual void CancelRead(void);
+
+	virtual void Close(void);
+
+	virtual uint GetBlockCount(void) const;
+
+	virtual void SetBlockSize(uint bytes);
+	virtual void SetDataOffset(int bytes);
+
+private:
+	static const u32 NoChunk = 0xffffffff;
+
+	void StartThread();
+	void StopThread();
+	void WorkerThread();
+
+	// Must be called with m_lock held. Drops the queue and waits for the worker to go
+	// idle, so that the source can be reconfigured.
+	void Invalidate(std::unique_lock<std::mutex>& lock);
+
+	void ResetCache();
+	void QueueChunk(u32 chunk, bool front);
+
+	int ReadChunkFromSource(u32 chunk, u8* dest);
+	int ReadChunks(void* pBuffer, uint sector, uint count);
+
+	uint ChunkBytes() const { return RA_CHUNK_SECTORS * m_blocksize; }
+	PX_off_t ChunkOffset(u32 chunk) const { return (PX_off_t)chunk * ChunkBytes(); }
+
+	AsyncFileReader* m_source;
+
+	std::thread m_thread;
+	std::mutex m_lock; // protects everything below, except the buffers
+	std::condition_variable m_work_cv;
+	std::condition_variable m_done_cv;
+	std::deque<u32> m_queue;
+	u32 m_inflight; // chunk being read by the worker, or NoChunk
+	bool m_quit;
+
+	std::unique_ptr<ChunksCache> m_cache;
+	u32 m_last_chunk;
+
+	// m_source is only accessed by one thread at a time.
+	std::mutex m_source_lock;
+	ScopedAlloc<u8> m_worker_buffer;
+	ScopedAlloc<u8> m_sync_buffer;
+
+	void* m_read_buffer;
+	uint m_read_sector;
+	uint m_read_count;
+};
@@ -0,0 +1,161 @@
+/*  PCSX2 - PS2 Emulator for PCs
+ *  Copyright (C) 2002-2020  PCSX2 Dev Team
+ *
+ *  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with PCSX2.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Replays a CDVD read trace (see CDVDtrace.h) against disc images, and reports the
+// throughput and the latencies of the readers which PCSX2 would use for them.
+//
+//   cdvd_trace_bench [options] <trace> <image> [<image>...]
+//
+// The images are opened the same way InputIsoFile opens them: compressed readers
+// (gz, cso, zso, chd) behind ReadAheadFileReader, or a FlatFileReader, which is turned
+// into a MultipartFileReader for split images.
+
+#include "PrecompiledHeader.h"
+#include "AsyncFileReader.h"
+#include "AppConfig.h"
+#include "CDVD/CDVDtrace.h"
+#include "CDVD/CompressedFileReader.h"
+#include "CDVD/ReadAheadFileReader.h"
+
+#include <memory>
+#include <wx/init.h>
+
+// GzippedFileReader looks up the index template in the configuration, which the bench
+// doesn't load: the default template is used.
+std::unique_ptr<AppConfig> g_Conf;
+
+struct BenchOptions
+{
+	bool paced = false;
+	bool readAhead = true;
+	bool memoryMapped = false;
+	uint blockSize = 2048;
+	int dataOffset = 0;
+};
+
+static AsyncFileReader* OpenImage(const wxString& filename, const BenchOptions& options)
+{
+	AsyncFileReader* reader = CompressedFileReader::GetNewReader(filename);
+	const bool isCompressed = reader != NULL;
+	if (!isCompressed)
+		reader = new FlatFileReader(false, options.memoryMapped);
+
+	if (!reader->Open(filename))
+	{
+		delete reader;
+		return NULL;
+	}
+
+	reader->SetDataOffset(options.dataOffset);
+	reader->SetBlockSize(options.blockSize);
+
+	if (!isCompressed)
+	{
+		AsyncFileReader* multipart = MultipartFileReader::DetectMultipart(reader);
+		if (multipart != reader)
+			delete reader;
+		reader = multipart;
+	}
+	else if (options.readAhead)
+	{
+		reader = new ReadAheadFileReader(reader);
+	}
+
+	return reader;
+}
+
+static void Usage()
+{
+	fprintf(stderr,
+			"Usage: cdvd_trace_bench [options] <trace> <image> [<image>...]\n"
+			"  --paced         issue the reads at the recorded pace instead of back to back\n"
+			"  --no-readahead  read compressed images directly, without ReadAheadFileReader\n"
+			"  --mmap          memory map uncompressed images (Linux)\n"
+			"  --blocksize N   sector size of the images (2048, 2352 or 2448, default 2048)\n"
+			"  --offset N      data offset of the images, in bytes (default 0)\n");
+}
+
+int main(int argc, char* argv[])
+{
+	BenchOptions options;
+	int arg = 1;
+
+	for (; arg < argc && argv[arg][0] == '-'; arg++)
+	{
+		const wxString opt(fromUTF8(argv[arg]));
+		if (opt == L"--paced")
+			options.paced = true;
+		else if (opt == L"--no-readahead")
+			options.readAhead = false;
+		else if (opt == L"--mmap")
+			options.memoryMapped = true;
+		else if (opt == L"--blocksize" && arg + 1 < argc)
+			options.blockSize = atoi(argv[++arg]);
+		else if (opt == L"--offset" && arg + 1 < argc)
+			options.dataOffset = atoi(argv[++arg]);
+		else
+		{
+			Usage();
+			return 1;
+		}
+	}
+
+	if (argc - arg < 2)
+	{
+		Usage();
+		return 1;
+	}
+
+	wxInitializer initializer(argc, argv);
+	if (!initializer.IsOk())
+	{
+		fprintf(stderr, "Unable to initialize wxWidgets\n");
+		return 1;
+	}
+
+	InitCPUTicks();
+
+	std::vector<CdvdTraceRecord> records;
+	const wxString traceName(fromUTF8(argv[arg++]));
+	if (!CdvdTraceLoad(traceName, records))
+	{
+		fprintf(stderr, "Unable to load the trace %s\n", argv[arg - 1]);
+		return 1;
+	}
+	printf("%s: %u reads\n", argv[arg - 1], (uint)records.size());
+
+	int failed = 0;
+	for (; arg < argc; arg++)
+	{
+		std::unique_ptr<AsyncFileReader> reader(OpenImage(fromUTF8(argv[arg]), options));
+		if (!reader)
+		{
+			fprintf(stderr, "%s: unable to open\n", argv[arg]);
+			failed++;
+			continue;
+		}
+
+		CdvdReplayStats stats;
+		CdvdTraceReplay(reader.get(), records, options.paced, stats);
+
+		printf("%s: %llu reads (%llu skipped, %llu errors) in %.3fs, %.1f MB/s, latency p50 %uus p99 %uus p99.9 %uus max %uus\n",
+			   argv[arg], (unsigned long long)stats.reads, (unsigned long long)stats.skipped,
+			   (unsigned long long)stats.errors, stats.seconds,
+			   stats.seconds > 0 ? stats.bytes / stats.seconds / (1024 * 1024) : 0.0,
+			   stats.latency_p50, stats.latency_p99, stats.latency_p999, stats.latency_max);
+	}
+
+	return failed ? 1 : 0;
+}
@@ -49,6 +49,7 @@ Comments) 1950 to 1952 in the files http://tools.ietf.org/html/rfc1950
       (Thanks to Mark Adler for suggesting the approach)
   - build_index(...) - added progress prints
   - CHUNK changed from 16k to 512k
+  - build_index(...) - optional per access point callback, which can also abort the build
  */
 
 /* Illustrate the use of Z_BLOCK, inflatePrime(), and inflateSetDictionary()
@@ -216,6 +217,11 @@ local struct access* addpoint(struct access* index, int bits,
 	return index;
 }
 
+/* Optional build_index() callback, invoked with every new access point as soon as
+   it's added. The point is only valid during the call. Returning non zero aborts
+   the build, in which case build_index() returns Z_STREAM_ERROR. */
+typedef int (*point_callback)(void* ctx, const struct point* point);
+
 /* Make one entire pass through the compressed stream and build an index, with
    access points about every span bytes of uncompressed output -- span is
    chosen to balance the speed of random access against the memory requirements
@@ -224,7 +230,8 @@ local struct access* addpoint(struct access* index, int bits,
    returns the number of access points on success (>= 1), Z_MEM_ERROR for out
    of memory, Z_DATA_ERROR for an error in the input file, or Z_ERRNO for a
    file read error.  On success, *built points to the resulting index. */
-local int build_index(FILE* in, PX_off_t span, struct access** built)
+local int build_index(FILE* in, PX_off_t span, struct access** built,
+					   point_callback on_point = NULL, void* ctx = NULL)
 {
 	int ret;
 	PX_off_t totin, totout, totPrinted; /* our own total counters to avoid 4GB limit */
@@ -310,9 +317,14 @@ local int build_index(FILE* in, PX_off_t span, struct access** built)
 					goto build_index_error;
 				}
 				last = totout;
+				if (on_point && on_point(ctx, index->list + index->have - 1))
+				{
+					ret = Z_STREAM_ERROR;
+					goto build_index_error;
+				}
 			}
 		} while (strm.avail_in != 0);
-		if (totin / (50 * 1024 * 1024) != totPrinted / (50 * 1024 * 1024))
+		if (!on_point && totin / (50 * 1024 * 1024) != totPrinted / (50 * 1024 * 1024))
 		{
 			printf("%dMB ", (int)(totin / (1024 * 1024)));
 			totPrinted = totin;
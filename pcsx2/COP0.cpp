@@ -465,6 +465,12 @@ void MTC0()
 		case 9:
 			s_iLastCOP0Cycle = cpuRegs.cycle;
 			cpuRegs.CP0.r[9] = cpuRegs.GPR.r[_Rt_].UL[0];
+			cpuScheduleTIMR();
+		break;
+
+		case 11:
+			cpuRegs.CP0.r[11] = cpuRegs.GPR.r[_Rt_].UL[0];
+			cpuScheduleTIMR();
 		break;
 
 		case 12:
@@ -256,7 +256,10 @@ struct Pcsx2Config
 				PreBlockCheckEE	:1,
 				PreBlockCheckIOP:1;
 			bool
-				EnableEECache   :1;
+				EnableEECache   :1,
+				EnableEEBlockCache:1,	// keeps the recompiled EE blocks across runs
+				EnableEETiering	:1,		// recompiles the hot EE blocks as superblocks
+				EnableVUProgramCache:1;	// keeps the microVU programs across runs
 		BITFIELD_END
 
 		RecompilerOptions();
@@ -465,6 +468,9 @@ struct Pcsx2Config
 			CdvdVerboseReads	:1,		// enables cdvd read activity verbosely dumped to the console
 			CdvdDumpBlocks		:1,		// enables cdvd block dumping
 			CdvdShareWrite		:1,		// allows the iso to be modified while it's loaded
+			CdvdMemoryMapped	:1,		// reads uncompressed isos through a memory mapping (Linux only, ignored with CdvdShareWrite)
+			CdvdTraceReads		:1,		// records the sectors read by the drive to a trace file in the logs folder
+			RecTraceLinks		:1,		// records the EE recompiler block links to a trace file in the logs folder
 			EnablePatches		:1,		// enables patch detection and application
 			EnableCheats		:1,		// enables cheat detection and application
 			EnableIPC		    :1,		// enables inter-process communication 
@@ -103,7 +103,7 @@ static __fi void _rcntSet( int cntidx )
 	if (c < nextCounter)
 	{
 		nextCounter = c;
-		cpuSetNextEvent( nextsCounter, nextCounter );	//Need to update on counter resets/target changes
+		cpuScheduleEvent( EE_EVENT_COUNTERS, nextsCounter, nextCounter );	//Need to update on counter resets/target changes
 	}
 
 	// Ignore target diff if target is currently disabled.
@@ -121,7 +121,7 @@ static __fi void _rcntSet( int cntidx )
 		if (c < nextCounter)
 		{
 			nextCounter = c;
-			cpuSetNextEvent( nextsCounter, nextCounter );	//Need to update on counter resets/target changes
+			cpuScheduleEvent( EE_EVENT_COUNTERS, nextsCounter, nextCounter );	//Need to update on counter resets/target changes
 		}
 	}
 }
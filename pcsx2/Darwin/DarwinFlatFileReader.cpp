@@ -28,7 +28,9 @@
 #warning AIO has been disabled.
 #endif
 
-FlatFileReader::FlatFileReader(bool shareWrite) : shareWrite(shareWrite)
+FlatFileReader::FlatFileReader(bool shareWrite, bool memoryMapped)
+	: shareWrite(shareWrite)
+	, memoryMapped(memoryMapped)
 {
 	m_blocksize = 2048;
 	m_fd = -1;
@@ -0,0 +1,142 @@
+/*  PCSX2 - PS2 Emulator for PCs
+ *  Copyright (C) 2002-2020  PCSX2 Dev Team
+ *
+ *  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with PCSX2.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// --------------------------------------------------------------------------------------
+//  EventQueue
+// --------------------------------------------------------------------------------------
+// The timed events of a cpu ordered by cycle, in a binary heap indexed by event id so that
+// an event can be scheduled again or cancelled in O(log n).  The cpu only has to compare its
+// cycle with the first event to know whether anything is due.
+//
+// The cycles wrap around like the cpu's, they are compared by their signed difference.  The
+// queue isn't saved: the owners rebuild it from their own registers after loading a state.
+//
+template <uint Count>
+class EventQueue
+{
+protected:
+	static const u8 NotQueued = 0xff;
+
+	u32 m_cycle[Count]; // by event id
+	u8 m_pos[Count];    // of the event in the heap, or NotQueued
+	u8 m_heap[Count];
+	uint m_size;
+
+	bool Before(uint a, uint b) const { return (s32)(m_cycle[a] - m_cycle[b]) < 0; }
+
+	void Place(uint pos, uint id)
+	{
+		m_heap[pos] = id;
+		m_pos[id] = pos;
+	}
+
+	void SiftUp(uint pos)
+	{
+		const uint id = m_heap[pos];
+		while (pos > 0)
+		{
+			const uint parent = (pos - 1) / 2;
+			if (!Before(id, m_heap[parent]))
+				break;
+			Place(pos, m_heap[parent]);
+			pos = parent;
+		}
+		Place(pos, id);
+	}
+
+	void SiftDown(uint pos)
+	{
+		const uint id = m_heap[pos];
+		for (;;)
+		{
+			uint child = pos * 2 + 1;
+			if (child >= m_size)
+				break;
+			if (child + 1 < m_size && Before(m_heap[child + 1], m_heap[child]))
+				child++;
+			if (!Before(m_heap[child], id))
+				break;
+			Place(pos, m_heap[child]);
+			pos = child;
+		}
+		Place(pos, id);
+	}
+
+public:
+	EventQueue() { Reset(); }
+
+	void Reset()
+	{
+		memset(m_pos, NotQueued, sizeof(m_pos));
+		m_size = 0;
+	}
+
+	// Queues the event at the given cycle, or moves it there if it is already queued.
+	void Schedule(uint id, u32 cycle)
+	{
+		pxAssume(id < Count);
+
+		if (m_pos[id] == NotQueued)
+		{
+			m_cycle[id] = cycle;
+			Place(m_size, id);
+			SiftUp(m_size++);
+			return;
+		}
+
+		const bool earlier = (s32)(cycle - m_cycle[id]) < 0;
+		m_cycle[id] = cycle;
+		if (earlier)
+			SiftUp(m_pos[id]);
+		else
+			SiftDown(m_pos[id]);
+	}
+
+	void Cancel(uint id)
+	{
+		pxAssume(id < Count);
+
+		const uint pos = m_pos[id];
+		if (pos == NotQueued)
+			return;
+
+		m_pos[id] = NotQueued;
+		if (pos == --m_size)
+			return;
+
+		// The last event takes its place, and goes up or down from there.
+		const uint last = m_heap[m_size];
+		Place(pos, last);
+		if (pos > 0 && Before(last, m_heap[(pos - 1) / 2]))
+			SiftUp(pos);
+		else
+			SiftDown(pos);
+	}
+
+	bool IsEmpty() const { return m_size == 0; }
+	bool IsQueued(uint id) const { return m_pos[id] != NotQueued; }
+
+	// The first event, the queue must not be empty.
+	uint GetTop() const { return m_heap[0]; }
+	u32 GetTopCycle() const { return m_cycle[m_heap[0]]; }
+
+	// True when the first event is at or before the given cycle.
+	bool IsDue(u32 cycle) const { return m_size && (s32)(cycle - m_cycle[m_heap[0]]) >= 0; }
+
+	// True when the event is queued at or before the given cycle.
+	bool IsDue(uint id, u32 cycle) const { return IsQueued(id) && (s32)(cycle - m_cycle[id]) >= 0; }
+};
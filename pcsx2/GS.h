@@ -347,6 +347,12 @@ public:
 	Semaphore			m_sem_OpenDone;
 	std::atomic<bool>	m_PluginOpened;
 
+#ifdef __LIBRETRO__
+	// Set by the EE core to make ExecuteTaskInThread return without waiting for a vsync
+	// (see SysCoreThread::RunInThread).
+	std::atomic<bool>	m_ReturnRequested;
+#endif
+
 	// These vars maintain instance data for sending Data Packets.
 	// Only one data packet can be constructed and uploaded at a time.
 
@@ -385,6 +391,10 @@ public:
 
 	void ExecuteTaskInThread();
 	void FinishTaskInThread();
+#ifdef __LIBRETRO__
+	void RequestReturn();
+	bool TakeReturnRequest() { return m_ReturnRequested.exchange(false); }
+#endif
 	void OpenPlugin();
 	void ClosePlugin();
 
@@ -325,6 +325,8 @@ extern void PSX_INT( IopEventId n, s32 ecycle);
 
 extern void psxSetNextBranch( u32 startCycle, s32 delta );
 extern void psxSetNextBranchDelta( s32 delta );
+extern void psxScheduleEvent( uint n, u32 startCycle, s32 delta );
+extern void psxResetEvents();
 extern int iopTestCycle( u32 startCycle, s32 delta );
 extern void _iopTestInterrupts();
 
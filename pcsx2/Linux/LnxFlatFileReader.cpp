@@ -16,11 +16,22 @@
 #include "PrecompiledHeader.h"
 #include "AsyncFileReader.h"
 
-FlatFileReader::FlatFileReader(bool shareWrite) : shareWrite(shareWrite)
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// How far ahead of a read the kernel is asked to page in a memory mapped file.
+static const u64 MAP_WILLNEED_BYTES = 4 * 1024 * 1024;
+
+FlatFileReader::FlatFileReader(bool shareWrite, bool memoryMapped)
+	: shareWrite(shareWrite)
+	, memoryMapped(memoryMapped)
 {
 	m_blocksize = 2048;
 	m_fd = -1;
 	m_aio_context = 0;
+	m_mapping = NULL;
+	m_mapping_size = 0;
+	m_willneed_end = 0;
 }
 
 FlatFileReader::~FlatFileReader(void)
@@ -36,8 +47,63 @@ bool FlatFileReader::Open(const wxString& fileName)
 	if (err) return false;
 
     m_fd = wxOpen(fileName, O_RDONLY, 0);
+	if (m_fd == -1)
+		return false;
+
+	// A file which may be truncated while it's loaded can't be mapped, accessing
+	// the pages past the new end would raise SIGBUS.
+	if (memoryMapped && !shareWrite)
+		MapFile();
+
+	return true;
+}
+
+void FlatFileReader::MapFile(void)
+{
+	struct stat st;
+	if (fstat(m_fd, &st) != 0 || st.st_size <= 0 || (u64)st.st_size > SIZE_MAX)
+		return;
+
+	void* mapping = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, m_fd, 0);
+	if (mapping == MAP_FAILED)
+	{
+		// Not fatal (32 bits address space, special files...), the aio path still works.
+		Console.Warning(L"FlatFileReader: can't map %s (errno %d), falling back to regular reads", WX_STR(m_filename), errno);
+		return;
+	}
+
+	m_mapping = (u8*)mapping;
+	m_mapping_size = st.st_size;
+	m_willneed_end = 0;
+}
+
+const u8* FlatFileReader::MapSectors(uint sector, uint count)
+{
+	if (!m_mapping)
+		return NULL;
+
+	u64 offset = sector * (u64)m_blocksize + m_dataoffset;
+	u64 bytes = count * (u64)m_blocksize;
+
+	// The last sectors of a truncated image are short, let the regular path deal with them.
+	if (offset + bytes > m_mapping_size)
+		return NULL;
+
+	// BeginRead2 maps the sectors when the drive starts seeking, so this is the time
+	// to have the kernel start paging them in. Sequential reads refill the window
+	// once they're halfway through it, seeks restart it at the new position.
+	const bool seek = offset > m_willneed_end || offset + 2 * MAP_WILLNEED_BYTES < m_willneed_end;
+	if (seek || offset + bytes + MAP_WILLNEED_BYTES / 2 > m_willneed_end)
+	{
+		const u64 page_mask = ~(u64)(sysconf(_SC_PAGESIZE) - 1);
+		u64 start = (seek ? offset : m_willneed_end) & page_mask;
+		u64 end = std::min(std::max(offset + bytes, start) + MAP_WILLNEED_BYTES, m_mapping_size);
+		if (end > start)
+			madvise(m_mapping + start, end - start, MADV_WILLNEED);
+		m_willneed_end = end;
+	}
 
-	return (m_fd != -1);
+	return m_mapping + offset;
 }
 
 int FlatFileReader::ReadSync(void* pBuffer, uint sector, uint count)
@@ -84,6 +150,8 @@ void FlatFileReader::CancelRead(void)
 
 void FlatFileReader::Close(void)
 {
+	if (m_mapping)
+		munmap(m_mapping, m_mapping_size);
 
 	if (m_fd != -1) close(m_fd);
 
@@ -91,6 +159,8 @@ void FlatFileReader::Close(void)
 
 	m_fd = -1;
 	m_aio_context = 0;
+	m_mapping = NULL;
+	m_mapping_size = 0;
 }
 
 uint FlatFileReader::GetBlockCount(void) const
@@ -60,6 +60,9 @@ SysMtgsThread::SysMtgsThread() :
 #endif
 {
 	m_name = L"MTGS";
+#ifdef __LIBRETRO__
+	m_ReturnRequested = false;
+#endif
 
 	// All other state vars are initialized by OnStart().
 }
@@ -621,10 +624,24 @@ void SysMtgsThread::ExecuteTaskInThread()
 		if (m_VsyncSignalListener.exchange(false))
 			m_sem_Vsync.Post();
 
+#ifdef __LIBRETRO__
+		if (m_ReturnRequested.load(std::memory_order_acquire))
+			return;
+#endif
+
 		//Console.Warning( "(MTGS Thread) Nothing to do!  ringpos=0x%06x", m_ReadPos );
 	}
 }
 
+#ifdef __LIBRETRO__
+// Called by the EE core, ExecuteTaskInThread returns once it emptied the ring.
+void SysMtgsThread::RequestReturn()
+{
+	m_ReturnRequested.store(true, std::memory_order_release);
+	m_sem_event.Post();
+}
+#endif
+
 void SysMtgsThread::FinishTaskInThread()
 {
 	if( m_SignalRingEnable.exchange(false) )
@@ -853,6 +853,7 @@ void eeMemoryReserve::Reset()
 
 void eeMemoryReserve::Decommit()
 {
+	mmap_StopDirtyTracking();
 	_parent::Decommit();
 	eeMem = NULL;
 }
@@ -904,6 +905,13 @@ struct vtlb_PageProtectionInfo
 
 static __aligned16 vtlb_PageProtectionInfo m_PageProtectInfo[Ps2MemSize::MainRam >> 12];
 
+// Dirty page tracking shares the write protection with the block tracking: while it's
+// enabled, the pages which weren't written since mmap_TakeDirtyPages are write protected,
+// and the first write to one of them marks it dirty. The pages the recompiler protected
+// are dirty once their blocks are cleared.
+static bool m_DirtyTracking = false;
+static u8 m_PageDirty[Ps2MemSize::MainRam >> 12];
+
 
 // returns:
 //  ProtMode_NotRequired - unchecked block (resides in ROM, thus is integrity is constant)
@@ -980,6 +988,21 @@ void mmap_PageFaultHandler::OnPageFaultEvent( const PageFaultInfo& info, bool& h
 	uptr offset = info.addr - (uptr)eeMem->Main;
 	if( offset >= Ps2MemSize::MainRam ) return;
 
+	int rampage = offset >> 12;
+
+	if( m_DirtyTracking && !m_PageDirty[rampage] )
+	{
+		m_PageDirty[rampage] = 1;
+
+		// Not protected for the recompiler, only for the dirty tracking.
+		if( m_PageProtectInfo[rampage].Mode != ProtMode_Write )
+		{
+			HostSys::MemProtect( &eeMem->Main[rampage<<12], __pagesize, PageAccess_ReadWrite() );
+			handled = true;
+			return;
+		}
+	}
+
 	mmap_ClearCpuBlock( offset );
 	handled = true;
 }
@@ -993,4 +1016,61 @@ void mmap_ResetBlockTracking()
 	//DbgCon.WriteLn( "vtlb/mmap: Block Tracking reset..." );
 	memzero( m_PageProtectInfo );
 	if (eeMem) HostSys::MemProtect( eeMem->Main, Ps2MemSize::MainRam, PageAccess_ReadWrite() );
+
+	// Nothing is write protected anymore, the next delta has all the pages.
+	if (m_DirtyTracking) memset( m_PageDirty, 1, sizeof(m_PageDirty) );
+}
+
+// Fills pages (Ps2MemSize::MainRam >> 12 entries) with the EE RAM pages written since the
+// previous call, and returns their count. The first call (or the first one after the
+// tracking was stopped) returns all the pages, and starts the tracking.
+// Called from the EE thread only.
+uint mmap_TakeDirtyPages( u32* pages )
+{
+	pxAssert( eeMem );
+
+	const uint pagecount = Ps2MemSize::MainRam >> 12;
+	uint count = 0;
+
+	if( !m_DirtyTracking )
+	{
+		for( uint i = 0; i < pagecount; ++i )
+			pages[count++] = i;
+
+		m_DirtyTracking = true;
+		HostSys::MemProtect( eeMem->Main, Ps2MemSize::MainRam, PageAccess_ReadOnly() );
+	}
+	else
+	{
+		// Protect the dirty pages again, in runs of contiguous pages.
+		for( uint i = 0; i < pagecount; )
+		{
+			if( !m_PageDirty[i] ) { ++i; continue; }
+
+			uint end = i;
+			while( end < pagecount && m_PageDirty[end] )
+				pages[count++] = end++;
+
+			HostSys::MemProtect( &eeMem->Main[i<<12], (end - i) << 12, PageAccess_ReadOnly() );
+			i = end;
+		}
+	}
+
+	memzero( m_PageDirty );
+	return count;
+}
+
+// Removes the write protection which only the dirty tracking needed.
+void mmap_StopDirtyTracking()
+{
+	if( !m_DirtyTracking ) return;
+	m_DirtyTracking = false;
+
+	if( !eeMem ) return;
+
+	for( uint i = 0; i < (Ps2MemSize::MainRam >> 12); ++i )
+	{
+		if( !m_PageDirty[i] && m_PageProtectInfo[i].Mode != ProtMode_Write )
+			HostSys::MemProtect( &eeMem->Main[i<<12], __pagesize, PageAccess_ReadWrite() );
+	}
 }
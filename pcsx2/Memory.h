@@ -128,6 +128,10 @@ extern vtlb_ProtectionMode mmap_GetRamPageInfo( u32 paddr );
 extern void mmap_MarkCountedRamPage( u32 paddr );
 extern void mmap_ResetBlockTracking();
 
+// Dirty page tracking of EE RAM, for incremental savestates (see SaveStateBase::FreezeAllDelta).
+extern uint mmap_TakeDirtyPages( u32* pages );
+extern void mmap_StopDirtyTracking();
+
 #define memRead8 vtlb_memRead<mem8_t>
 #define memRead16 vtlb_memRead<mem16_t>
 #define memRead32 vtlb_memRead<mem32_t>
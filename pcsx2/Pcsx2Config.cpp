@@ -117,6 +117,9 @@ Pcsx2Config::RecompilerOptions::RecompilerOptions()
 
 	EnableEE	= true;
 	EnableEECache = false;
+	EnableEEBlockCache = false; // only hits when the core is loaded at the same address, see RecBlockCache
+	EnableEETiering = true;
+	EnableVUProgramCache = true;
 	EnableIOP	= true;
 	EnableVU0	= true;
 	EnableVU1	= true;
@@ -175,6 +178,9 @@ void Pcsx2Config::RecompilerOptions::LoadSave( IniInterface& ini )
 	IniBitBool( EnableEE );
 	IniBitBool( EnableIOP );
 	IniBitBool( EnableEECache );
+	IniBitBool( EnableEEBlockCache );
+	IniBitBool( EnableEETiering );
+	IniBitBool( EnableVUProgramCache );
 	IniBitBool( EnableVU0 );
 	IniBitBool( EnableVU1 );
 
@@ -461,6 +467,7 @@ Pcsx2Config::Pcsx2Config()
 	McdFolderAutoManage = true;
 	EnablePatches = true;
 	BackupSavestate = true;
+	CdvdMemoryMapped = true;
 }
 
 void Pcsx2Config::LoadSave( IniInterface& ini )
@@ -470,6 +477,9 @@ void Pcsx2Config::LoadSave( IniInterface& ini )
 	IniBitBool( CdvdVerboseReads );
 	IniBitBool( CdvdDumpBlocks );
 	IniBitBool( CdvdShareWrite );
+	IniBitBool( CdvdMemoryMapped );
+	IniBitBool( CdvdTraceReads );
+	IniBitBool( RecTraceLinks );
 	IniBitBool( EnablePatches );
 	IniBitBool( EnableCheats );
 	IniBitBool( EnableIPC );
@@ -19,6 +19,7 @@
 
 #include "Sio.h"
 #include "Sif.h"
+#include "EventQueue.h"
 
 using namespace R3000A;
 
@@ -48,6 +49,9 @@ bool iopEventAction = false;
 
 bool iopEventTestIsActive = false;
 
+// The pending PSX_INT interrupts, by psxRegs.sCycle + eCycle.
+static EventQueue<32> iopEvents;
+
 __aligned16 psxRegisters psxRegs;
 
 void psxReset()
@@ -61,6 +65,7 @@ void psxReset()
 	iopBreak = 0;
 	iopCycleEE = -1;
 	g_iopNextEventCycle = psxRegs.cycle + 4;
+	iopEvents.Reset();
 
 	psxHwReset();
 	PSXCLK = 36864000;
@@ -131,6 +136,25 @@ __fi int psxTestCycle( u32 startCycle, s32 delta )
 	return (int)(psxRegs.cycle - startCycle) >= delta;
 }
 
+// Queues the event n, sets a branch test at its cycle.
+__fi void psxScheduleEvent( uint n, u32 startCycle, s32 delta )
+{
+	iopEvents.Schedule( n, startCycle + delta );
+	psxSetNextBranch( startCycle, delta );
+}
+
+// Queues the pending interrupts again (after loading a state).
+void psxResetEvents()
+{
+	iopEvents.Reset();
+
+	for( uint n = 0; n < 32; n++ )
+	{
+		if( psxRegs.interrupt & (1 << n) )
+			iopEvents.Schedule( n, psxRegs.sCycle[n] + psxRegs.eCycle[n] );
+	}
+}
+
 __fi void PSX_INT( IopEventId n, s32 ecycle )
 {
 	// 19 is CDVD read int, it's supposed to be high.
@@ -142,7 +166,7 @@ __fi void PSX_INT( IopEventId n, s32 ecycle )
 	psxRegs.sCycle[n] = psxRegs.cycle;
 	psxRegs.eCycle[n] = ecycle;
 
-	psxSetNextBranchDelta( ecycle );
+	psxScheduleEvent( n, psxRegs.cycle, ecycle );
 
 	if( iopCycleEE < 0 )
 	{
@@ -161,10 +185,11 @@ static __fi void IopTestEvent( IopEventId n, void (*callback)() )
 	if( psxTestCycle( psxRegs.sCycle[n], psxRegs.eCycle[n] ) )
 	{
 		psxRegs.interrupt &= ~(1 << n);
+		iopEvents.Cancel( n );
 		callback();
 	}
-	else
-		psxSetNextBranch( psxRegs.sCycle[n], psxRegs.eCycle[n] );
+	else // the cycles may have been changed without PSX_INT
+		iopEvents.Schedule( n, psxRegs.sCycle[n] + psxRegs.eCycle[n] );
 }
 
 static __fi void _psxTestInterrupts()
@@ -173,7 +198,9 @@ static __fi void _psxTestInterrupts()
 	IopTestEvent(IopEvt_SIF1,		sif1Interrupt);	// SIF1
 	IopTestEvent(IopEvt_SIF2,		sif2Interrupt);	// SIF2
 	// Originally controlled by a preprocessor define, now PSX dependent.
+	// Out of the queue until then (see iopEventTest), it would be due at every test.
 	if (psxHu32(HW_ICFG) & (1 << 3)) IopTestEvent(IopEvt_SIO, sioInterruptR);
+	else iopEvents.Cancel(IopEvt_SIO);
 	IopTestEvent(IopEvt_CdvdRead,	cdvdReadInterrupt);
 
 	// Profile-guided Optimization (sorta)
@@ -191,6 +218,10 @@ static __fi void _psxTestInterrupts()
 		IopTestEvent(IopEvt_DEV9,		dev9Interrupt);
 		IopTestEvent(IopEvt_USB,		usbInterrupt);
 	}
+
+	// Drop the interrupts which were cleared without going through IopTestEvent.
+	while( iopEvents.IsDue(psxRegs.cycle) && !(psxRegs.interrupt & (1 << iopEvents.GetTop())) )
+		iopEvents.Cancel( iopEvents.GetTop() );
 }
 
 __ri void iopEventTest()
@@ -208,13 +239,20 @@ __ri void iopEventTest()
 	}
 
 
-	if (psxRegs.interrupt)
+	if( (psxRegs.interrupt & (1 << IopEvt_SIO)) && !iopEvents.IsQueued(IopEvt_SIO) && (psxHu32(HW_ICFG) & (1 << 3)) )
+		iopEvents.Schedule( IopEvt_SIO, psxRegs.sCycle[IopEvt_SIO] + psxRegs.eCycle[IopEvt_SIO] );
+
+	// A single comparison unless an interrupt is due.
+	if (iopEvents.IsDue(psxRegs.cycle))
 	{
 		iopEventTestIsActive = true;
 		_psxTestInterrupts();
 		iopEventTestIsActive = false;
 	}
 
+	if (!iopEvents.IsEmpty())
+		psxSetNextBranch( psxRegs.cycle, iopEvents.GetTopCycle() - psxRegs.cycle );
+
 	if( (psxHu32(0x1078) != 0) && ((psxHu32(0x1070) & psxHu32(0x1074)) != 0) )
 	{
 		if( (psxRegs.CP0.n.Status & 0xFE01) >= 0x401 )
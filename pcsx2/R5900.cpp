@@ -37,6 +37,7 @@
 
 #include "../DebugTools/Breakpoints.h"
 #include "R5900OpcodeTables.h"
+#include "EventQueue.h"
 
 using namespace R5900;	// for R5900 disasm tools
 
@@ -95,6 +96,7 @@ void cpuReset()
 	pgifInit();
 	hwReset();
 	rcntInit();
+	cpuResetEvents();
 	psxReset();
 
 	extern void Deci2Reset();		// lazy, no good header for it yet.
@@ -259,10 +261,51 @@ __fi void cpuSetEvent()
 	g_nextEventCycle = cpuRegs.cycle;
 }
 
+// The pending CPU_INT interrupts (by cpuRegs.sCycle + eCycle) and the counters.
+static EventQueue<EE_EVENT_COUNT> eeEvents;
+
+// The interrupts which were due while the DMAC was disabled, out of the queue until it
+// is enabled again.
+static u32 eeParkedEvents = 0;
+
+// The interrupts _cpuTestInterrupts services.  The others (SIF2) only raise their bit in
+// cpuRegs.interrupt: a due event nobody cancels would stay at the top of the queue and run
+// the branch test after every block.
+static const u32 eeServicedInts =
+	(1 << DMAC_VIF0) | (1 << DMAC_VIF1) | (1 << DMAC_GIF) | (1 << DMAC_FROM_IPU) | (1 << DMAC_TO_IPU)
+	| (1 << DMAC_SIF0) | (1 << DMAC_SIF1) | (1 << DMAC_FROM_SPR) | (1 << DMAC_TO_SPR)
+	| (1 << DMAC_MFIFO_VIF) | (1 << DMAC_MFIFO_GIF) | (1 << VIF_VU0_FINISH) | (1 << VIF_VU1_FINISH);
+
+// Queues the event n, sets a branch test at its cycle.
+__fi void cpuScheduleEvent( uint n, u32 startCycle, s32 delta )
+{
+	pxAssertDev( n >= 32 || (eeServicedInts & (1 << n)), "EE event queued that _cpuTestInterrupts does not service" );
+	eeEvents.Schedule( n, startCycle + delta );
+	cpuSetNextEvent( startCycle, delta );
+}
+
+// Queues the pending interrupts and the counters again (after a reset or loading a state).
+void cpuResetEvents()
+{
+	eeEvents.Reset();
+	eeParkedEvents = 0;
+
+	for( uint n = 0; n < 32; n++ )
+	{
+		if( cpuRegs.interrupt & eeServicedInts & (1 << n) )
+			eeEvents.Schedule( n, cpuRegs.sCycle[n] + cpuRegs.eCycle[n] );
+	}
+
+	eeEvents.Schedule( EE_EVENT_COUNTERS, nextsCounter + nextCounter );
+	eeEvents.Schedule( EE_EVENT_HSYNC, hsyncCounter.sCycle + hsyncCounter.CycleT );
+	cpuScheduleTIMR();
+}
+
 __fi void cpuClearInt( uint i )
 {
 	pxAssume( i < 32 );
 	cpuRegs.interrupt &= ~(1 << i);
+	eeEvents.Cancel( i );
 }
 
 static __fi void TESTINT( u8 n, void (*callback)() )
@@ -274,8 +317,8 @@ static __fi void TESTINT( u8 n, void (*callback)() )
 		cpuClearInt( n );
 		callback();
 	}
-	else
-		cpuSetNextEvent( cpuRegs.sCycle[n], cpuRegs.eCycle[n] );
+	else // the cycles may have been changed without CPU_INT
+		eeEvents.Schedule( n, cpuRegs.sCycle[n] + cpuRegs.eCycle[n] );
 }
 
 // [TODO] move this function to LegacyDmac.cpp, and remove most of the DMAC-related headers from
@@ -285,8 +328,28 @@ static __fi void _cpuTestInterrupts()
 	if (!dmacRegs.ctrl.DMAE || (psHu8(DMAC_ENABLER+2) & 1))
 	{
 		//Console.Write("DMAC Disabled or suspended");
+		// The due interrupts would keep the next event on the current cycle.
+		while (eeEvents.IsDue(cpuRegs.cycle) && eeEvents.GetTop() < 32)
+		{
+			eeParkedEvents |= 1 << eeEvents.GetTop();
+			eeEvents.Cancel(eeEvents.GetTop());
+		}
 		return;
 	}
+
+	if (eeParkedEvents)
+	{
+		for (uint n = 0; n < 32; n++)
+		{
+			if (eeParkedEvents & cpuRegs.interrupt & (1 << n))
+				eeEvents.Schedule(n, cpuRegs.sCycle[n] + cpuRegs.eCycle[n]);
+		}
+		eeParkedEvents = 0;
+	}
+
+	// A single comparison unless an interrupt is due.
+	if (!eeEvents.IsDue(cpuRegs.cycle)) return;
+
 	/* These are 'pcsx2 interrupts', they handle asynchronous stuff
 	   that depends on the cycle timings */
 
@@ -317,6 +380,28 @@ static __fi void _cpuTestInterrupts()
 		TESTINT(VIF_VU0_FINISH, vif0VUFinish);
 		TESTINT(VIF_VU1_FINISH, vif1VUFinish);
 	}
+
+	// Drop the interrupts which were cleared without cpuClearInt.
+	while (eeEvents.IsDue(cpuRegs.cycle) && eeEvents.GetTop() < 32 && !(cpuRegs.interrupt & (1 << eeEvents.GetTop())))
+		eeEvents.Cancel(eeEvents.GetTop());
+}
+
+// The cycle at which Count reaches Compare, and again every 2^32 cycles.
+static u32 s_iTIMRCycle = 0;
+
+// The furthest the TIMR event is queued, the queue compares the cycles by their signed
+// difference.  A later match is queued again on the way.
+static const u32 TIMR_MaxDelta = 0x40000000;
+
+// Called when Count or Compare is written: queues the TIMR event at the cycle Count reaches
+// Compare.  Count is CP0.n.Count plus the cycles since s_iLastCOP0Cycle.
+void cpuScheduleTIMR()
+{
+	const u32 count = cpuRegs.CP0.n.Count + (cpuRegs.cycle - s_iLastCOP0Cycle);
+	const u32 delta = cpuRegs.CP0.n.Compare - count;
+
+	s_iTIMRCycle = cpuRegs.cycle + delta;
+	cpuScheduleEvent( EE_EVENT_TIMR, cpuRegs.cycle, std::min(delta, TIMR_MaxDelta) );
 }
 
 static __fi void _cpuTestTIMR()
@@ -324,11 +409,6 @@ static __fi void _cpuTestTIMR()
 	cpuRegs.CP0.n.Count += cpuRegs.cycle-s_iLastCOP0Cycle;
 	s_iLastCOP0Cycle = cpuRegs.cycle;
 
-	// fixme: this looks like a hack to make up for the fact that the TIMR
-	// doesn't yet have a proper mechanism for setting itself up on a nextEventCycle.
-	// A proper fix would schedule the TIMR to trigger at a specific cycle anytime
-	// the Count or Compare registers are modified.
-
 	if ( (cpuRegs.CP0.n.Status.val & 0x8000) &&
 		cpuRegs.CP0.n.Count >= cpuRegs.CP0.n.Compare && cpuRegs.CP0.n.Count < cpuRegs.CP0.n.Compare+1000 )
 	{
@@ -392,7 +472,22 @@ __fi void _cpuEventTest_Shared()
 
 	rcntUpdate_hScanline();
 
-	_cpuTestTIMR();
+	eeEvents.Schedule( EE_EVENT_COUNTERS, nextsCounter + nextCounter );
+	eeEvents.Schedule( EE_EVENT_HSYNC, hsyncCounter.sCycle + hsyncCounter.CycleT );
+
+	// ---- COP0 Timer -------------
+	// The interrupt is raised while Count is less than 1000 past Compare, the queued TIMR
+	// event makes sure that there is a test at the match.  No COP0 work otherwise.
+
+	if( (u32)(cpuRegs.cycle - s_iTIMRCycle) < 1000 )
+		_cpuTestTIMR();
+
+	if( eeEvents.IsDue( EE_EVENT_TIMR, cpuRegs.cycle ) )
+	{
+		// On the way to the match, or at/past it: the next one is 2^32 cycles later.
+		const u32 delta = s_iTIMRCycle - cpuRegs.cycle;
+		eeEvents.Schedule( EE_EVENT_TIMR, cpuRegs.cycle + ((delta && delta < TIMR_MaxDelta) ? delta : TIMR_MaxDelta) );
+	}
 
 	// ---- Interrupts -------------
 	// These are basically just DMAC-related events, which also piggy-back the same bits as
@@ -451,11 +546,10 @@ __fi void _cpuEventTest_Shared()
 	// relative position to the EE (via EEsCycle)
 	cpuSetNextEventDelta( ((g_iopNextEventCycle-psxRegs.cycle)*8) - EEsCycle );
 
-	// Apply the hsync counter's nextCycle
-	cpuSetNextEvent( hsyncCounter.sCycle, hsyncCounter.CycleT );
-
-	// Apply vsync and other counter nextCycles
-	cpuSetNextEvent( nextsCounter, nextCounter );
+	// Apply the first of the queued events: the interrupts, the hsync counter's nextCycle,
+	// vsync and other counter nextCycles
+	if( !eeEvents.IsEmpty() )
+		cpuSetNextEvent( cpuRegs.cycle, eeEvents.GetTopCycle() - cpuRegs.cycle );
 }
 
 __ri void cpuTestINTCInts()
@@ -526,7 +620,8 @@ __fi void CPU_INT( EE_EventType n, s32 ecycle)
 		iopCycleEE = 0;
 	}
 
-	cpuSetNextEventDelta( cpuRegs.eCycle[n] );
+	if( eeServicedInts & (1 << n) )
+		cpuScheduleEvent( n, cpuRegs.cycle, cpuRegs.eCycle[n] );
 }
 
 // Called from recompilers; __fastcall define is mandatory.
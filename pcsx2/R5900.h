@@ -423,7 +423,13 @@ enum EE_EventType
 	
 	DMAC_GIF_UNIT,
 	VIF_VU0_FINISH,
-	VIF_VU1_FINISH
+	VIF_VU1_FINISH,
+
+	// Not interrupts, the counters in the EE's event queue
+	EE_EVENT_COUNTERS = 32,	// rcntUpdate
+	EE_EVENT_HSYNC,			// rcntUpdate_hScanline
+	EE_EVENT_TIMR,			// COP0 Count reaching Compare
+	EE_EVENT_COUNT
 };
 
 extern void CPU_INT( EE_EventType n, s32 ecycle );
@@ -445,6 +451,9 @@ extern void cpuSetNextEvent( u32 startCycle, s32 delta );
 extern void cpuSetNextEventDelta( s32 delta );
 extern int  cpuTestCycle( u32 startCycle, s32 delta );
 extern void cpuSetEvent();
+extern void cpuScheduleEvent( uint n, u32 startCycle, s32 delta );
+extern void cpuResetEvents();
+extern void cpuScheduleTIMR();
 
 extern void _cpuEventTest_Shared();		// for internal use by the Dynarecs and Ints inside R5900:
 
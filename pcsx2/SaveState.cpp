@@ -47,6 +47,9 @@ static void PostLoadPrep()
 	if (EmuConfig.Gamefixes.GoemonTlbHack) GoemonPreloadTlb();
 
 	UpdateVSyncRate();
+
+	cpuResetEvents();
+	psxResetEvents();
 }
 
 // --------------------------------------------------------------------------------------
@@ -174,6 +177,49 @@ SaveStateBase& SaveStateBase::FreezeMainMemory()
 	return *this;
 }
 
+SaveStateBase& SaveStateBase::FreezeMainMemoryDelta()
+{
+	vu1Thread.WaitVU(); // Finish VU1 just in-case...
+	if (IsLoading()) PreLoadPrep();
+
+	// Dirty EE RAM pages: count, page indices, then the pages
+	// -------------------------------------------------------
+	FreezeTag( "RamDelta" );
+
+	ScopedAlloc<u32> pages( Ps2MemSize::MainRam >> 12 );
+	u32 count = IsSaving() ? mmap_TakeDirtyPages( pages.GetPtr() ) : 0;
+
+	Freeze( count );
+	if( count > (Ps2MemSize::MainRam >> 12) )
+		throw Exception::SaveStateLoadError().SetDiagMsg( L"Savestate data corruption detected: invalid EE RAM page count." );
+
+	if (IsSaving()) m_memory->MakeRoomFor( m_idx + count * (sizeof(u32) + __pagesize) + MainMemorySizeInBytes - Ps2MemSize::MainRam );
+	FreezeMem( pages.GetPtr(), count * sizeof(u32) );
+
+	for( u32 i = 0; i < count; ++i )
+	{
+		if( pages[i] >= (Ps2MemSize::MainRam >> 12) )
+			throw Exception::SaveStateLoadError().SetDiagMsg( L"Savestate data corruption detected: invalid EE RAM page." );
+
+		FreezeMem( &eeMem->Main[pages[i] << 12], __pagesize );
+	}
+
+	// The rest is the same as FreezeMainMemory
+	FreezeMem(eeMem->Scratch,	Ps2MemSize::Scratch);
+	FreezeMem(eeHw,				Ps2MemSize::Hardware);
+
+	FreezeMem(iopMem->Main, 	Ps2MemSize::IopRam);
+	FreezeMem(iopHw,			Ps2MemSize::IopHardware);
+
+	FreezeMem(vuRegs[0].Micro,	VU0_PROGSIZE);
+	FreezeMem(vuRegs[0].Mem,	VU0_MEMSIZE);
+
+	FreezeMem(vuRegs[1].Micro,	VU1_PROGSIZE);
+	FreezeMem(vuRegs[1].Mem,	VU1_MEMSIZE);
+
+	return *this;
+}
+
 SaveStateBase& SaveStateBase::FreezeInternals()
 {
 	vu1Thread.WaitVU(); // Finish VU1 just in-case...
@@ -260,6 +306,16 @@ SaveStateBase& SaveStateBase::FreezeAll()
 	return *this;
 }
 
+SaveStateBase& SaveStateBase::FreezeAllDelta()
+{
+	FreezeMainMemoryDelta();
+	FreezeBios();
+	FreezeInternals();
+	FreezePlugins();
+
+	return *this;
+}
+
 
 // --------------------------------------------------------------------------------------
 //  memSavingState (implementations)
@@ -302,6 +358,13 @@ memSavingState& memSavingState::FreezeAll()
 	return *this;
 }
 
+memSavingState& memSavingState::FreezeAllDelta()
+{
+	MakeRoomForData();
+	_parent::FreezeAllDelta();
+	return *this;
+}
+
 // --------------------------------------------------------------------------------------
 //  memLoadingState  (implementations)
 // --------------------------------------------------------------------------------------
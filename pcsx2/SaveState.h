@@ -65,7 +65,14 @@ public:
 	// (loading) a state!
 	virtual SaveStateBase& FreezeAll();
 
+	// Incremental version of FreezeAll: EE RAM only has the pages written since the previous
+	// delta was saved (all of them for the first one, see mmap_TakeDirtyPages), the rest of
+	// the state is complete. Loading writes the pages over the current EE RAM, so the deltas
+	// must be loaded in the order they were saved, starting from the first one.
+	virtual SaveStateBase& FreezeAllDelta();
+
 	virtual SaveStateBase& FreezeMainMemory();
+	virtual SaveStateBase& FreezeMainMemoryDelta();
 	virtual SaveStateBase& FreezeBios();
 	virtual SaveStateBase& FreezeInternals();
 	virtual SaveStateBase& FreezePlugins();
@@ -183,6 +190,7 @@ public:
 
 	void FreezeMem( void* data, int size );
 	memSavingState& FreezeAll();
+	memSavingState& FreezeAllDelta();
 
 	bool IsSaving() const { return true; }
 };
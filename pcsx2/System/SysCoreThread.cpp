@@ -60,6 +60,9 @@ SysCoreThread::SysCoreThread()
 	m_resetVirtualMachine = true;
 
 	m_hasActiveMachine = false;
+#ifdef __LIBRETRO__
+	m_InThreadTaskPending = false;
+#endif
 }
 
 SysCoreThread::~SysCoreThread()
@@ -181,12 +184,31 @@ void SysCoreThread::UploadStateCopy(const VmStateBuffer& copy)
 	m_resetVirtualMachine = false;
 }
 
+#ifdef __LIBRETRO__
+void SysCoreThread::RunInThread(const std::function<void()>& task)
+{
+	pxAssertDev(GetMTGS().IsSelf(), "RunInThread must be called from the MTGS thread.");
+
+	m_InThreadTask = task;
+	m_InThreadTaskPending.store(true, std::memory_order_release);
+
+	// The core thread can be waiting for the MTGS to get to the vsync, and the task sends
+	// the GS freeze through the ring: keep running the MTGS until the core thread is done.
+	while (!GetMTGS().TakeReturnRequest())
+		GetMTGS().ExecuteTaskInThread();
+}
+#endif
+
 // --------------------------------------------------------------------------------------
 //  SysCoreThread *Worker* Implementations
 //    (Called from the context of this thread only)
 // --------------------------------------------------------------------------------------
 bool SysCoreThread::HasPendingStateChangeRequest() const
 {
+#ifdef __LIBRETRO__
+	if (m_InThreadTaskPending.load(std::memory_order_relaxed))
+		return true;
+#endif
 	return !m_hasActiveMachine || GetMTGS().HasPendingException() || _parent::HasPendingStateChangeRequest();
 }
 
@@ -275,6 +297,15 @@ void SysCoreThread::GameStartingInThread()
 bool SysCoreThread::StateCheckInThread()
 {
 	GetMTGS().RethrowException();
+#ifdef __LIBRETRO__
+	if (m_InThreadTaskPending.load(std::memory_order_acquire))
+	{
+		m_InThreadTask();
+		m_InThreadTask = nullptr;
+		m_InThreadTaskPending.store(false, std::memory_order_relaxed);
+		GetMTGS().RequestReturn();
+	}
+#endif
 	return _parent::StateCheckInThread() && (_reset_stuff_as_needed(), true);
 }
 
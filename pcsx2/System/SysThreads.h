@@ -20,6 +20,7 @@
 #include "Utilities/PersistentThread.h"
 #include "x86emitter/tools.h"
 #include "IPC.h"
+#include <functional>
 
 
 using namespace Threading;
@@ -323,6 +324,10 @@ protected:
 		ON
 	};
 	StateIPC m_IpcState = OFF;
+#else
+	// Task run by this thread at its next state check, see RunInThread().
+	std::function<void()> m_InThreadTask;
+	std::atomic<bool> m_InThreadTaskPending;
 #endif
 
 	// Indicates if the system has an active virtual machine state.  Pretty much always
@@ -349,6 +354,12 @@ public:
 
 	virtual bool StateCheckInThread();
 	virtual void VsyncInThread();
+#ifdef __LIBRETRO__
+	// Runs task on this thread once the emulation reaches a safe point (the next vsync), the
+	// VM state can be saved or loaded from it. Must be called from the MTGS thread (the
+	// frontend thread), which is run until the task completes.
+	void RunInThread(const std::function<void()>& task);
+#endif
 	virtual void GameStartingInThread();
 
 	virtual void ApplySettings( const Pcsx2Config& src );
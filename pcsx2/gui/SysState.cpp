@@ -28,7 +28,12 @@
 #include "ConsoleLogger.h"
 
 #include <wx/wfstream.h>
+#include <wx/mstream.h>
+#include <wx/ffile.h>
 #include <memory>
+#include <atomic>
+#include <thread>
+#include <zlib.h>
 
 #include "Patch.h"
 
@@ -294,32 +299,124 @@ static const std::unique_ptr<BaseSavestateEntry> SavestateEntries[] = {
 
 // It's bad mojo to have savestates trying to read and write from the same file at the
 // same time.  To prevent that we use this mutex lock, which is used by both the
-// CompressThread and the UnzipFromDisk events.  (note that CompressThread locks the
-// mutex during OnStartInThread, which ensures that the ZipToDisk event blocks; preventing
-// the SysExecutor's Idle Event from re-enabing savestates and slots.)
+// CompressToDisk and the UnzipFromDisk events.
 //
 static Mutex mtx_CompressToDisk;
 
-static void CheckVersion(pxInputStream& thr)
+static void CheckVersion(const wxString& filename, u32 savever)
 {
-	u32 savever;
-	thr.Read(savever);
-
 	// Major version mismatch.  Means we can't load this savestate at all.  Support for it
 	// was removed entirely.
 	if (savever > g_SaveVersion)
-		throw Exception::SaveStateLoadError(thr.GetStreamName())
+		throw Exception::SaveStateLoadError(filename)
 			.SetDiagMsg(pxsFmt(L"Savestate uses an unsupported or unknown savestate version.\n(PCSX2 ver=%x, state ver=%x)", g_SaveVersion, savever))
 			.SetUserMsg(_("Cannot load this savestate. The state is an unsupported version."));
 
 	// check for a "minor" version incompatibility; which happens if the savestate being loaded is a newer version
 	// than the emulator recognizes.  99% chance that trying to load it will just corrupt emulation or crash.
 	if ((savever >> 16) != (g_SaveVersion >> 16))
-		throw Exception::SaveStateLoadError(thr.GetStreamName())
+		throw Exception::SaveStateLoadError(filename)
 			.SetDiagMsg(pxsFmt(L"Savestate uses an unknown savestate version.\n(PCSX2 ver=%x, state ver=%x)", g_SaveVersion, savever))
 			.SetUserMsg(_("Cannot load this savestate. The state is an unsupported version."));
 };
 
+static void CheckVersion(pxInputStream& thr)
+{
+	u32 savever;
+	thr.Read(savever);
+	CheckVersion(thr.GetStreamName(), savever);
+}
+
+// Logs the required entries which weren't found, and throws if there are some.
+static void CheckRequiredEntries(const wxString& filename, const bool* found)
+{
+	bool throwIt = false;
+	for (uint i = 0; i < ArraySize(SavestateEntries); ++i)
+	{
+		if (found[i])
+			continue;
+
+		if (SavestateEntries[i]->IsRequired())
+		{
+			throwIt = true;
+			Console.WriteLn(Color_Red, " ... not found '%s'!", WX_STR(SavestateEntries[i]->GetFilename()));
+		}
+	}
+
+	if (throwIt)
+		throw Exception::SaveStateLoadError(filename)
+			.SetDiagMsg(L"Savestate cannot be loaded: some required components were not found or are incomplete.")
+			.SetUserMsg(_("This savestate cannot be loaded due to missing critical components.  See the log file for details."));
+}
+
+// --------------------------------------------------------------------------------------
+//  Savestate container
+// --------------------------------------------------------------------------------------
+// The savestates used to be zip archives, compressed by a single thread.  They are now
+// this container: the entries (the same as the zip entries) are split into frames of up
+// to StateFrameSize bytes, which are deflated independently, so that all the cores can
+// compress them when saving and inflate them when loading.  Zip savestates still load.
+//
+//   StateFileHeader
+//   StateFileEntry[entryCount]
+//   StateFileFrame[frameCount]  (the frames of the entries, in the order of the entries)
+//   the deflated frames, in the same order
+//
+static const u32 StateFileMagic = 0x5A533250; // "P2SZ"
+static const uint StateFrameSize = _1mb;
+static const uint StateMaxEntries = 64;
+
+struct StateFileHeader
+{
+	u32 magic;   // StateFileMagic
+	u32 version; // g_SaveVersion
+	u32 entryCount;
+	u32 frameCount;
+};
+
+struct StateFileEntry
+{
+	char name[48];
+	u32 size;
+	u32 firstFrame;
+	u32 frameCount;
+	u32 reserved;
+};
+
+struct StateFileFrame
+{
+	u32 compressedSize;
+	u32 size;
+};
+
+// Calls fn(0..count-1) from as many threads as there are cores.  fn must not throw.
+template <typename Fn>
+static void ParallelFor(uint count, const Fn& fn)
+{
+	std::atomic<uint> next(0);
+	auto work = [&]() {
+		for (uint i; (i = next++) < count;)
+			fn(i);
+	};
+
+	const uint threads = std::min(count, std::max(std::thread::hardware_concurrency(), 1u));
+	std::vector<std::thread> workers;
+	for (uint i = 1; i < threads; ++i)
+		workers.emplace_back(work);
+
+	work();
+
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+static bool IsStateContainer(const wxString& filename)
+{
+	wxFFile file(filename, L"rb");
+	u32 magic = 0;
+	return file.IsOpened() && file.Read(&magic, sizeof(magic)) == sizeof(magic) && magic == StateFileMagic;
+}
+
 // --------------------------------------------------------------------------------------
 //  SysExecEvent_DownloadState
 // --------------------------------------------------------------------------------------
@@ -381,60 +478,31 @@ protected:
 
 
 // --------------------------------------------------------------------------------------
-//  CompressThread_VmState
+//  SysExecEvent_CompressToDisk
 // --------------------------------------------------------------------------------------
-class VmStateCompressThread : public BaseCompressThread
-{
-	typedef BaseCompressThread _parent;
-
-protected:
-	ScopedLock m_lock_Compress;
-
-public:
-	VmStateCompressThread()
-	{
-		m_lock_Compress.Assign(mtx_CompressToDisk);
-	}
-
-	virtual ~VmStateCompressThread() = default;
-
-protected:
-	void OnStartInThread()
-	{
-		_parent::OnStartInThread();
-		m_lock_Compress.Acquire();
-	}
-
-	void OnCleanupInThread()
-	{
-		m_lock_Compress.Release();
-		_parent::OnCleanupInThread();
-	}
-};
-
-// --------------------------------------------------------------------------------------
-//  SysExecEvent_ZipToDisk
-// --------------------------------------------------------------------------------------
-class SysExecEvent_ZipToDisk : public SysExecEvent
+// Writes the downloaded state into a savestate container (see StateFileHeader).  The VM
+// runs again already, the frames are compressed by all the cores.
+//
+class SysExecEvent_CompressToDisk : public SysExecEvent
 {
 protected:
 	ArchiveEntryList* m_src_list;
 	wxString m_filename;
 
 public:
-	wxString GetEventName() const { return L"VM_ZipToDisk"; }
+	wxString GetEventName() const { return L"VM_CompressToDisk"; }
 
-	virtual ~SysExecEvent_ZipToDisk() = default;
+	virtual ~SysExecEvent_CompressToDisk() = default;
 
-	SysExecEvent_ZipToDisk* Clone() const { return new SysExecEvent_ZipToDisk(*this); }
+	SysExecEvent_CompressToDisk* Clone() const { return new SysExecEvent_CompressToDisk(*this); }
 
-	SysExecEvent_ZipToDisk(ArchiveEntryList& srclist, const wxString& filename)
+	SysExecEvent_CompressToDisk(ArchiveEntryList& srclist, const wxString& filename)
 		: m_filename(filename)
 	{
 		m_src_list = &srclist;
 	}
 
-	SysExecEvent_ZipToDisk(ArchiveEntryList* srclist, const wxString& filename)
+	SysExecEvent_CompressToDisk(ArchiveEntryList* srclist, const wxString& filename)
 		: m_filename(filename)
 	{
 		m_src_list = srclist;
@@ -449,50 +517,70 @@ protected:
 		// Provisionals for scoped cleanup, in case of exception:
 		std::unique_ptr<ArchiveEntryList> elist(m_src_list);
 
-		wxString tempfile(m_filename + L".tmp");
+		ScopedLock lock(mtx_CompressToDisk);
 
-		wxFFileOutputStream* woot = new wxFFileOutputStream(tempfile);
-		if (!woot->IsOk())
-			throw Exception::CannotCreateStream(tempfile);
+		// Split the entries into frames.
+		const uint entryCount = elist->GetLength();
+		std::vector<StateFileEntry> entries(entryCount);
+		std::vector<StateFileFrame> frames;
+		std::vector<const u8*> frameData;
 
-		// Scheduler hint (yield) -- creating and saving the file is low priority compared to
-		// the emulator/vm thread.  Sleeping the executor thread briefly before doing file
-		// transactions should help reduce overhead. --air
+		for (uint i = 0; i < entryCount; ++i)
+		{
+			const ArchiveEntry& src = (*elist)[i];
+			StateFileEntry& entry = entries[i];
 
-		pxYield(4);
+			memzero(entry);
+			strncpy(entry.name, src.GetFilename().ToUTF8(), sizeof(entry.name) - 1);
+			entry.size = src.GetDataSize();
+			entry.firstFrame = frames.size();
 
-		// Write the version and screenshot:
-		std::unique_ptr<pxOutputStream> out(new pxOutputStream(tempfile, new wxZipOutputStream(woot)));
-		wxZipOutputStream* gzfp = (wxZipOutputStream*)out->GetWxStreamBase();
+			for (uint pos = 0; pos < entry.size; pos += StateFrameSize)
+			{
+				frames.push_back({0, std::min(StateFrameSize, entry.size - pos)});
+				frameData.push_back(elist->GetPtr(src.GetDataIndex() + pos));
+			}
 
-		{
-			wxZipEntry* vent = new wxZipEntry(EntryFilename_StateVersion);
-			vent->SetMethod(wxZIP_METHOD_STORE);
-			gzfp->PutNextEntry(vent);
-			out->Write(g_SaveVersion);
-			gzfp->CloseEntry();
+			entry.frameCount = frames.size() - entry.firstFrame;
 		}
 
-		std::unique_ptr<wxImage> m_screenshot;
+		std::vector<std::vector<u8>> packed(frames.size());
+		std::atomic<bool> failed(false);
 
-		if (m_screenshot)
-		{
-			wxZipEntry* vent = new wxZipEntry(EntryFilename_Screenshot);
-			vent->SetMethod(wxZIP_METHOD_STORE);
-			gzfp->PutNextEntry(vent);
-			m_screenshot->SaveFile(*gzfp, wxBITMAP_TYPE_JPEG);
-			gzfp->CloseEntry();
-		}
+		ParallelFor(frames.size(), [&](uint i) {
+			uLongf size = compressBound(frames[i].size);
+			packed[i].resize(size);
+			if (compress2(packed[i].data(), &size, frameData[i], frames[i].size, Z_BEST_SPEED) != Z_OK)
+				failed = true;
+			packed[i].resize(size);
+			frames[i].compressedSize = size;
+		});
+
+		if (failed)
+			throw Exception::RuntimeError().SetDiagMsg(L"Savestate compression failed.");
+
+		wxString tempfile(m_filename + L".tmp");
 
-		(*new VmStateCompressThread())
-			.SetSource(elist.get())
-			.SetOutStream(out.get())
-			.SetFinishedPath(m_filename)
-			.Start();
+		wxFFile file(tempfile, L"wb");
+		if (!file.IsOpened())
+			throw Exception::CannotCreateStream(tempfile);
+
+		StateFileHeader header = {StateFileMagic, g_SaveVersion, entryCount, (u32)frames.size()};
+
+		bool ok = file.Write(&header, sizeof(header)) == sizeof(header);
+		ok = ok && file.Write(entries.data(), entries.size() * sizeof(StateFileEntry)) == entries.size() * sizeof(StateFileEntry);
+		ok = ok && file.Write(frames.data(), frames.size() * sizeof(StateFileFrame)) == frames.size() * sizeof(StateFileFrame);
+		for (uint i = 0; ok && i < packed.size(); ++i)
+			ok = file.Write(packed[i].data(), packed[i].size()) == packed[i].size();
+		ok = file.Close() && ok;
+
+		if (!ok)
+			throw Exception::BadStream(tempfile).SetDiagMsg(L"Failed to write the savestate.");
+
+		if (!wxRenameFile(tempfile, m_filename, true))
+			throw Exception::BadStream(m_filename).SetDiagMsg(L"Failed to move or copy the temporary savestate to the destination filename.");
 
-		// No errors?  Release cleanup handlers:
-		elist.release();
-		out.release();
+		Console.WriteLn("(SaveState) Data saved to disk without error.");
 	}
 
 	void CleanupEvent()
@@ -529,6 +617,12 @@ protected:
 	{
 		ScopedLock lock(mtx_CompressToDisk);
 
+		if (IsStateContainer(m_filename))
+		{
+			LoadFromContainer();
+			return;
+		}
+
 		// Ugh.  Exception handling made crappy because wxWidgets classes don't support scoped pointers yet.
 
 		std::unique_ptr<wxFFileInputStream> woot(new wxFFileInputStream(m_filename));
@@ -606,23 +700,10 @@ protected:
 		}
 
 		// Log any parts and pieces that are missing, and then generate an exception.
-		bool throwIt = false;
+		bool found[ArraySize(SavestateEntries)];
 		for (uint i = 0; i < ArraySize(SavestateEntries); ++i)
-		{
-			if (foundEntry[i])
-				continue;
-
-			if (SavestateEntries[i]->IsRequired())
-			{
-				throwIt = true;
-				Console.WriteLn(Color_Red, " ... not found '%s'!", WX_STR(SavestateEntries[i]->GetFilename()));
-			}
-		}
-
-		if (throwIt)
-			throw Exception::SaveStateLoadError(m_filename)
-				.SetDiagMsg(L"Savestate cannot be loaded: some required components were not found or are incomplete.")
-				.SetUserMsg(_("This savestate cannot be loaded due to missing critical components.  See the log file for details."));
+			found[i] = !!foundEntry[i];
+		CheckRequiredEntries(m_filename, found);
 
 		// We use direct Suspend/Resume control here, since it's desirable that emulation
 		// *ALWAYS* start execution after the new savestate is loaded.
@@ -653,6 +734,146 @@ protected:
 		memLoadingState(buffer).FreezeBios().FreezeInternals();
 		GetCoreThread().Resume(); // force resume regardless of emulation state earlier.
 	}
+
+	void LoadFromContainer()
+	{
+		wxFFile file(m_filename, L"rb");
+		if (!file.IsOpened())
+			throw Exception::CannotCreateStream(m_filename).SetDiagMsg(L"Cannot open file for reading.");
+
+		StateFileHeader header;
+		if (file.Read(&header, sizeof(header)) != sizeof(header))
+			throw Exception::SaveStateLoadError(m_filename).SetDiagMsg(L"Savestate header is truncated.");
+
+		CheckVersion(m_filename, header.version);
+
+		if (header.entryCount > StateMaxEntries || header.frameCount > header.entryCount + (_1gb / StateFrameSize))
+			throw Exception::SaveStateLoadError(m_filename).SetDiagMsg(L"Savestate header is corrupted.");
+
+		std::vector<StateFileEntry> entries(header.entryCount);
+		std::vector<StateFileFrame> frames(header.frameCount);
+		bool ok = file.Read(entries.data(), entries.size() * sizeof(StateFileEntry)) == entries.size() * sizeof(StateFileEntry);
+		ok = ok && file.Read(frames.data(), frames.size() * sizeof(StateFileFrame)) == frames.size() * sizeof(StateFileFrame);
+		if (!ok)
+			throw Exception::SaveStateLoadError(m_filename).SetDiagMsg(L"Savestate tables are truncated.");
+
+		// Offsets of the frames in the file and in the uncompressed entries.
+		std::vector<size_t> packedOffset(frames.size());
+		std::vector<size_t> dataOffset(frames.size());
+		std::vector<size_t> entryOffset(entries.size());
+		size_t packedSize = 0;
+		size_t dataSize = 0;
+		u64 nextFrame = 0;
+
+		for (uint i = 0; i < entries.size(); ++i)
+		{
+			StateFileEntry& entry = entries[i];
+			entry.name[sizeof(entry.name) - 1] = 0;
+			// The entries own consecutive runs of frames, so every frame gets its offsets
+			// exactly once and no two entries inflate into the same bytes.
+			if (entry.firstFrame != nextFrame || (u64)entry.firstFrame + entry.frameCount > frames.size())
+				throw Exception::SaveStateLoadError(m_filename).SetDiagMsg(L"Savestate tables are corrupted.");
+			nextFrame += entry.frameCount;
+
+			entryOffset[i] = dataSize;
+			size_t size = 0;
+			for (uint f = entry.firstFrame; f < entry.firstFrame + entry.frameCount; ++f)
+			{
+				if (frames[f].size > StateFrameSize || frames[f].compressedSize > compressBound(StateFrameSize))
+					throw Exception::SaveStateLoadError(m_filename).SetDiagMsg(L"Savestate tables are corrupted.");
+
+				packedOffset[f] = packedSize;
+				dataOffset[f] = dataSize + size;
+				packedSize += frames[f].compressedSize;
+				size += frames[f].size;
+			}
+
+			if (size != entry.size)
+				throw Exception::SaveStateLoadError(m_filename).SetDiagMsg(L"Savestate tables are corrupted.");
+			dataSize += size;
+		}
+
+		if (nextFrame != frames.size())
+			throw Exception::SaveStateLoadError(m_filename).SetDiagMsg(L"Savestate tables are corrupted.");
+
+		std::vector<u8> packed(packedSize);
+		if (file.Read(packed.data(), packedSize) != packedSize)
+			throw Exception::SaveStateLoadError(m_filename).SetDiagMsg(L"Savestate data is truncated.");
+		file.Close();
+
+		// Inflate all the frames while the VM still runs.
+		std::vector<u8> data(dataSize);
+		std::atomic<bool> failed(false);
+
+		ParallelFor(frames.size(), [&](uint i) {
+			uLongf size = frames[i].size;
+			if (uncompress(data.data() + dataOffset[i], &size, packed.data() + packedOffset[i], frames[i].compressedSize) != Z_OK || size != frames[i].size)
+				failed = true;
+		});
+
+		if (failed)
+			throw Exception::SaveStateLoadError(m_filename).SetDiagMsg(L"Savestate data is corrupted.");
+
+		int foundInternal = -1;
+		int foundEntry[ArraySize(SavestateEntries)];
+		bool found[ArraySize(SavestateEntries)] = {};
+
+		for (uint i = 0; i < entries.size(); ++i)
+		{
+			const wxString name(fromUTF8(entries[i].name));
+
+			if (name.CmpNoCase(EntryFilename_InternalStructures) == 0)
+			{
+				DevCon.WriteLn(Color_Green, L" ... found '%s'", EntryFilename_InternalStructures);
+				foundInternal = i;
+				continue;
+			}
+
+			for (uint e = 0; e < ArraySize(SavestateEntries); ++e)
+			{
+				if (name.CmpNoCase(SavestateEntries[e]->GetFilename()) == 0)
+				{
+					DevCon.WriteLn(Color_Green, L" ... found '%s'", WX_STR(SavestateEntries[e]->GetFilename()));
+					foundEntry[e] = i;
+					found[e] = true;
+					break;
+				}
+			}
+		}
+
+		if (foundInternal < 0)
+		{
+			throw Exception::SaveStateLoadError(m_filename)
+				.SetDiagMsg(pxsFmt(L"Savestate file does not contain '%s'", EntryFilename_InternalStructures))
+				.SetUserMsg(_("This file is not a valid PCSX2 savestate.  See the logfile for details."));
+		}
+
+		CheckRequiredEntries(m_filename, found);
+
+		PatchesVerboseReset();
+
+		GetCoreThread().Pause();
+		SysClearExecutionCache();
+
+		for (uint i = 0; i < ArraySize(SavestateEntries); ++i)
+		{
+			if (!found[i])
+				continue;
+
+			const StateFileEntry& entry = entries[foundEntry[i]];
+			pxInputStream reader(m_filename, new wxMemoryInputStream(data.data() + entryOffset[foundEntry[i]], entry.size));
+			SavestateEntries[i]->FreezeIn(reader);
+		}
+
+		// Load all the internal data
+
+		const StateFileEntry& internal = entries[foundInternal];
+		VmStateBuffer buffer(internal.size, L"StateBuffer_UnzipFromDisk");
+		memcpy(buffer.GetPtr(), data.data() + entryOffset[foundInternal], internal.size);
+
+		memLoadingState(buffer).FreezeBios().FreezeInternals();
+		GetCoreThread().Resume(); // force resume regardless of emulation state earlier.
+	}
 };
 
 // =====================================================================================================
@@ -666,7 +887,7 @@ void StateCopy_SaveToFile(const wxString& file)
 	std::unique_ptr<ArchiveEntryList> ziplist(new ArchiveEntryList(new VmStateBuffer(L"Zippable Savestate")));
 
 	GetSysExecutorThread().PostEvent(new SysExecEvent_DownloadState(ziplist.get()));
-	GetSysExecutorThread().PostEvent(new SysExecEvent_ZipToDisk(ziplist.get(), file));
+	GetSysExecutorThread().PostEvent(new SysExecEvent_CompressToDisk(ziplist.get(), file));
 
 	ziplist.release();
 }
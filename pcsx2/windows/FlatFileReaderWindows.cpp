@@ -16,7 +16,9 @@
 #include "PrecompiledHeader.h"
 #include "AsyncFileReader.h"
 
-FlatFileReader::FlatFileReader(bool shareWrite) : shareWrite(shareWrite)
+FlatFileReader::FlatFileReader(bool shareWrite, bool memoryMapped)
+	: shareWrite(shareWrite)
+	, memoryMapped(memoryMapped)
 {
 	m_blocksize = 2048;
 	hOverlappedFile = INVALID_HANDLE_VALUE;
@@ -17,13 +17,96 @@
 #include "PrecompiledHeader.h"
 #include "BaseblockEx.h"
 
+#include <wx/ffile.h>
+
+BaseBlockLinks::BaseBlockLinks()
+	: m_records(1)
+	, m_buckets(0x1000)
+	, m_used(0)
+	, m_shift(32 - 12)
+{
+}
+
+void BaseBlockLinks::Grow()
+{
+	std::vector<Bucket> old(m_buckets.size() * 2);
+	old.swap(m_buckets);
+	m_shift--;
+
+	const u32 mask = m_buckets.size() - 1;
+	for (const Bucket& bucket : old)
+	{
+		if (bucket.head == 0)
+			continue;
+
+		u32 i = Slot(bucket.pc);
+		while (m_buckets[i].head != 0)
+			i = (i + 1) & mask;
+		m_buckets[i] = bucket;
+	}
+}
+
+void BaseBlockLinks::Add(u32 pc, uptr jumpptr)
+{
+	// Keep the table at most half full.
+	if ((m_used + 1) * 2 > m_buckets.size())
+		Grow();
+
+	Bucket& bucket = m_buckets[Find(pc)];
+	if (bucket.head == 0)
+	{
+		bucket.pc = pc;
+		m_used++;
+	}
+
+	m_records.push_back({jumpptr, bucket.head});
+	bucket.head = m_records.size() - 1;
+}
+
+void BaseBlockLinks::Clear()
+{
+	// Keeps the memory, the recompiler compiles about as many links again after a reset.
+	m_records.resize(1);
+	if (m_used != 0)
+		std::fill(m_buckets.begin(), m_buckets.end(), Bucket{0, 0});
+	m_used = 0;
+}
+
+bool BaseBlockTrace::Save(const wxString& filename) const
+{
+	wxFFile file(filename, L"wb");
+	if (!file.IsOpened())
+		return false;
+
+	const BaseBlockTraceHeader header = {BLOCK_TRACE_MAGIC, BLOCK_TRACE_VERSION, (u32)m_records.size(), 0};
+	const size_t size = m_records.size() * sizeof(BaseBlockTraceRecord);
+
+	return file.Write(&header, sizeof(header)) == sizeof(header) &&
+		   file.Write(m_records.data(), size) == size && file.Close();
+}
+
+bool BaseBlockTrace::Load(const wxString& filename, std::vector<BaseBlockTraceRecord>& records)
+{
+	wxFFile file(filename, L"rb");
+	BaseBlockTraceHeader header;
+	if (!file.IsOpened() || file.Read(&header, sizeof(header)) != sizeof(header))
+		return false;
+
+	if (header.magic != BLOCK_TRACE_MAGIC || header.version != BLOCK_TRACE_VERSION || header.count > MaxRecords)
+		return false;
+
+	records.resize(header.count);
+	const size_t size = header.count * sizeof(BaseBlockTraceRecord);
+	return file.Read(records.data(), size) == size;
+}
+
 BASEBLOCKEX* BaseBlocks::New(u32 startpc, uptr fnptr)
 {
-	std::pair<linkiter_t, linkiter_t> range = links.equal_range(startpc);
-	for (linkiter_t i = range.first; i != range.second; ++i)
-		*(u32*)i->second = fnptr - (i->second + 4);
-	
-	return blocks.insert(startpc, fnptr);;
+	links.Patch(startpc, fnptr);
+	if (trace)
+		trace->Push(BlockTrace_New, startpc);
+
+	return blocks.insert(startpc, fnptr);
 }
 
 int BaseBlocks::LastIndex(u32 startpc) const
@@ -77,6 +160,8 @@ void BaseBlocks::Link(u32 pc, s32* jumpptr)
 		*jumpptr = (s32)(targetblock->fnptr - (sptr)(jumpptr + 1));
 	else
 		*jumpptr = (s32)(recompiler - (sptr)(jumpptr + 1));
-	links.insert(std::pair<u32, uptr>(pc, (uptr)jumpptr));
+	links.Add(pc, (uptr)jumpptr);
+	if (trace)
+		trace->Push(BlockTrace_Link, pc, (uptr)jumpptr);
 }
 
@@ -15,7 +15,8 @@
 
 #pragma once
 
-#include <map>			// used by BaseBlockEx
+#include <memory>
+#include <vector>
 
 // Every potential jump point in the PS2's addressable memory has a BASEBLOCK
 // associated with it. So that means a BASEBLOCK for every 4 bytes of PS2
@@ -140,15 +141,133 @@ public:
 	}
 };
 
+// --------------------------------------------------------------------------------------
+//  BaseBlockLinks
+// --------------------------------------------------------------------------------------
+// The static jumps to each block, by the startpc of the target, patched when the block is
+// compiled and when it's removed.  The records are allocated in one array and chained per
+// target, the chains start in an open addressing table (linear probing).  Nothing is freed
+// before Clear, like the blocks the jumps are in, which stay in the code buffer until the
+// recompiler is reset.
+//
+class BaseBlockLinks
+{
+	struct Record
+	{
+		uptr jumpptr;
+		u32 next; // index in m_records, 0 ends the chain
+	};
+
+	struct Bucket
+	{
+		u32 pc;
+		u32 head; // index in m_records, 0 for an empty bucket
+	};
+
+	std::vector<Record> m_records; // the first record isn't used
+	std::vector<Bucket> m_buckets; // power of 2
+	u32 m_used;                    // buckets
+	u32 m_shift;                   // 32 - log2(m_buckets.size())
+
+	__fi u32 Slot(u32 pc) const
+	{
+		return (pc * 0x9E3779B1u) >> m_shift;
+	}
+
+	// The bucket of pc, or the empty one where it would go.
+	__fi u32 Find(u32 pc) const
+	{
+		const u32 mask = m_buckets.size() - 1;
+		u32 i = Slot(pc);
+		while (m_buckets[i].head != 0 && m_buckets[i].pc != pc)
+			i = (i + 1) & mask;
+		return i;
+	}
+
+	void Grow();
+
+public:
+	BaseBlockLinks();
+
+	void Add(u32 pc, uptr jumpptr);
+	void Clear();
+
+	// Patches the rel32 of all the jumps to pc, so that they jump to target.
+	__fi void Patch(u32 pc, uptr target) const
+	{
+		for (u32 i = m_buckets[Find(pc)].head; i != 0; i = m_records[i].next)
+		{
+			const uptr jumpptr = m_records[i].jumpptr;
+			*(u32*)jumpptr = target - (jumpptr + 4);
+		}
+	}
+
+	u32 GetCount() const { return m_records.size() - 1; }
+};
+
+// --------------------------------------------------------------------------------------
+//  BaseBlockTrace
+// --------------------------------------------------------------------------------------
+// When EmuConfig.RecTraceLinks is set, the EE recompiler records what it does to its links
+// (see BaseBlocks) and saves it to the logs folder at shutdown.  The rec_link_bench tool
+// replays the trace against the link tables, games clearing a lot of blocks (overlays,
+// self modifying code) are the interesting ones.
+//
+// The file is a BaseBlockTraceHeader followed by the records, in little endian.
+//
+enum BaseBlockTraceOp
+{
+	BlockTrace_New,    // a block was compiled at pc
+	BlockTrace_Link,   // a jump to pc was compiled at site
+	BlockTrace_Remove, // the block at pc was removed
+	BlockTrace_Reset,
+};
+
+struct BaseBlockTraceRecord
+{
+	u32 op; // BaseBlockTraceOp
+	u32 pc;
+	u64 site;
+};
+
+struct BaseBlockTraceHeader
+{
+	u32 magic;   // BLOCK_TRACE_MAGIC
+	u32 version; // BLOCK_TRACE_VERSION
+	u32 count;
+	u32 reserved;
+};
+
+static const u32 BLOCK_TRACE_MAGIC = 0x544C4242; // "BBLT"
+static const u32 BLOCK_TRACE_VERSION = 1;
+
+class BaseBlockTrace
+{
+	std::vector<BaseBlockTraceRecord> m_records;
+
+public:
+	// 256MB of records, the trace stops there.
+	static const u32 MaxRecords = 16 * 1024 * 1024;
+
+	__fi void Push(BaseBlockTraceOp op, u32 pc, uptr site = 0)
+	{
+		if (m_records.size() < MaxRecords)
+			m_records.push_back({(u32)op, pc, (u64)site});
+	}
+
+	u32 GetCount() const { return m_records.size(); }
+
+	bool Save(const wxString& filename) const;
+	static bool Load(const wxString& filename, std::vector<BaseBlockTraceRecord>& records);
+};
+
 class BaseBlocks
 {
 protected:
-	typedef std::multimap<u32, uptr>::iterator linkiter_t;
-
-	// switch to a hash map later?
-	std::multimap<u32, uptr> links;
+	BaseBlockLinks links;
 	uptr recompiler;
 	BaseBlockArray blocks;
+	std::unique_ptr<BaseBlockTrace> trace;
 
 public:
 	BaseBlocks() :
@@ -162,6 +281,17 @@ public:
 		recompiler = (uptr)recompiler_;
 	}
 
+	// Starts (or stops, with false) recording a BaseBlockTrace.
+	void SetTrace(bool enabled)
+	{
+		if (!enabled)
+			trace = nullptr;
+		else if (!trace)
+			trace = std::make_unique<BaseBlockTrace>();
+	}
+
+	const BaseBlockTrace* GetTrace() const { return trace.get(); }
+
 	BASEBLOCKEX* New(u32 startpc, uptr fnptr);
 	int LastIndex (u32 startpc) const;
 	//BASEBLOCKEX* GetByX86(uptr ip);
@@ -197,10 +327,9 @@ public:
 		do{
 			pxAssert(idx <= last);
 
-			//u32 startpc = blocks[idx].startpc;
-			std::pair<linkiter_t, linkiter_t> range = links.equal_range(blocks[idx].startpc);
-			for (linkiter_t i = range.first; i != range.second; ++i)
-				*(u32*)i->second = recompiler - (i->second + 4);
+			links.Patch(blocks[idx].startpc, recompiler);
+			if (trace)
+				trace->Push(BlockTrace_Remove, blocks[idx].startpc);
 
 			if( IsDevBuild )
 			{
@@ -224,7 +353,9 @@ public:
 	__fi void Reset()
 	{
 		blocks.clear();
-		links.clear();
+		links.Clear();
+		if (trace)
+			trace->Push(BlockTrace_Reset, 0);
 	}
 };
 
@@ -0,0 +1,211 @@
+/*  PCSX2 - PS2 Emulator for PCs
+ *  Copyright (C) 2002-2020  PCSX2 Dev Team
+ *
+ *  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with PCSX2.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PrecompiledHeader.h"
+#include "RecBlockCache.h"
+
+#include <wx/ffile.h>
+
+static const u32 BlockCacheVersion = 1;
+
+struct BlockCacheHeader
+{
+	u32 magic;
+	u32 version;
+	u64 layout;
+	u32 count;
+	u32 reserved;
+};
+
+struct BlockCacheEntry
+{
+	u32 startpc;
+	u32 flags;
+	u64 stateHash;
+	u32 guestSize; // in words
+	u32 codeSize;
+	u32 relocCount;
+	u32 linkCount;
+};
+
+RecBlockCache::RecBlockCache(u32 magic, size_t maxCodeSize)
+	: m_magic(magic)
+	, m_layout(0)
+	, m_codeSize(0)
+	, m_maxCodeSize(maxCodeSize)
+	, m_modified(false)
+{
+}
+
+void RecBlockCache::Reset(u64 layout)
+{
+	m_blocks.clear();
+	m_layout = layout;
+	m_codeSize = 0;
+	m_modified = false;
+}
+
+// FNV-1a
+u64 RecBlockCache::Hash(const void* data, size_t size, u64 hash)
+{
+	const u8* p = (const u8*)data;
+	for (size_t i = 0; i < size; i++)
+		hash = (hash ^ p[i]) * 0x100000001b3ULL;
+	return hash;
+}
+
+template <typename T>
+static bool ReadVector(wxFFile& file, std::vector<T>& v, u32 count)
+{
+	v.resize(count);
+	return file.Read(v.data(), count * sizeof(T)) == count * sizeof(T);
+}
+
+template <typename T>
+static bool WriteVector(wxFFile& file, const std::vector<T>& v)
+{
+	return file.Write(v.data(), v.size() * sizeof(T)) == v.size() * sizeof(T);
+}
+
+// Loads the blocks saved with the current layout, returns false when there is no such file.
+bool RecBlockCache::Load(const wxString& filename)
+{
+	if (!wxFileExists(filename))
+		return false;
+
+	wxFFile file(filename, L"rb");
+	BlockCacheHeader header;
+	if (!file.IsOpened() || file.Read(&header, sizeof(header)) != sizeof(header))
+		return false;
+
+	if (header.magic != m_magic || header.version != BlockCacheVersion || header.layout != m_layout)
+	{
+		Console.WriteLn(Color_Gray, L"(RecBlockCache) Ignoring '%s', it was saved by another build or with other settings.", WX_STR(filename));
+		return false;
+	}
+
+	u32 loaded = 0;
+	for (; loaded < header.count; loaded++)
+	{
+		BlockCacheEntry entry;
+		if (file.Read(&entry, sizeof(entry)) != sizeof(entry))
+			break;
+
+		if (entry.guestSize == 0 || entry.guestSize > 0x10000 || entry.codeSize == 0 || entry.codeSize > _64kb ||
+			entry.relocCount > entry.codeSize || entry.linkCount > entry.codeSize)
+			break;
+
+		Block block;
+		block.startpc = entry.startpc;
+		block.flags = entry.flags;
+		block.stateHash = entry.stateHash;
+
+		if (!ReadVector(file, block.guest, entry.guestSize) || !ReadVector(file, block.code, entry.codeSize) ||
+			!ReadVector(file, block.relocs, entry.relocCount) || !ReadVector(file, block.links, entry.linkCount))
+			break;
+
+		bool valid = true;
+		for (const Reloc& reloc : block.relocs)
+			valid = valid && reloc.offset + sizeof(s32) <= entry.codeSize && reloc.type <= Reloc_Counter;
+		for (const Link& link : block.links)
+			valid = valid && link.offset + sizeof(s32) <= entry.codeSize;
+		if (!valid)
+			break;
+
+		Add(std::move(block));
+	}
+
+	if (loaded != header.count)
+		Console.Warning(L"(RecBlockCache) '%s' is truncated or corrupted, %u of %u blocks loaded.", WX_STR(filename), loaded, header.count);
+
+	m_modified = false;
+	return true;
+}
+
+bool RecBlockCache::Save(const wxString& filename)
+{
+	const wxString tempfile(filename + L".tmp");
+
+	{
+		wxFFile file(tempfile, L"wb");
+		if (!file.IsOpened())
+			return false;
+
+		BlockCacheHeader header = {m_magic, BlockCacheVersion, m_layout, (u32)m_blocks.size(), 0};
+		bool ok = file.Write(&header, sizeof(header)) == sizeof(header);
+
+		for (const auto& i : m_blocks)
+		{
+			const Block& block = i.second;
+			BlockCacheEntry entry = {block.startpc, block.flags, block.stateHash, (u32)block.guest.size(),
+									 (u32)block.code.size(), (u32)block.relocs.size(), (u32)block.links.size()};
+
+			ok = ok && file.Write(&entry, sizeof(entry)) == sizeof(entry);
+			ok = ok && WriteVector(file, block.guest) && WriteVector(file, block.code);
+			ok = ok && WriteVector(file, block.relocs) && WriteVector(file, block.links);
+		}
+
+		if (!ok || !file.Close())
+		{
+			wxRemoveFile(tempfile);
+			return false;
+		}
+	}
+
+	if (!wxRenameFile(tempfile, filename, true))
+		return false;
+
+	m_modified = false;
+	return true;
+}
+
+// Replaces the block compiled from the same code, if there is one.
+void RecBlockCache::Add(Block&& block)
+{
+	auto range = m_blocks.equal_range(block.startpc);
+	for (auto i = range.first; i != range.second; ++i)
+	{
+		if (i->second.guest == block.guest)
+		{
+			m_codeSize -= i->second.code.size();
+			m_blocks.erase(i);
+			break;
+		}
+	}
+
+	if (m_codeSize + block.code.size() > m_maxCodeSize)
+		return;
+
+	const u32 startpc = block.startpc;
+	m_codeSize += block.code.size();
+	m_modified = true;
+	m_blocks.emplace(startpc, std::move(block));
+}
+
+// guestSize is the count of bytes which can be read at guest.
+const RecBlockCache::Block* RecBlockCache::Find(u32 startpc, const void* guest, uint guestSize, u64 stateHash) const
+{
+	auto range = m_blocks.equal_range(startpc);
+	for (auto i = range.first; i != range.second; ++i)
+	{
+		const Block& block = i->second;
+		const uint size = block.guest.size() * sizeof(u32);
+
+		if (block.stateHash == stateHash && size <= guestSize && memcmp(block.guest.data(), guest, size) == 0)
+			return &block;
+	}
+
+	return NULL;
+}
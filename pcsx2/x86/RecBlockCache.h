@@ -0,0 +1,94 @@
+/*  PCSX2 - PS2 Emulator for PCs
+ *  Copyright (C) 2002-2020  PCSX2 Dev Team
+ *
+ *  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with PCSX2.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+// --------------------------------------------------------------------------------------
+//  RecBlockCache
+// --------------------------------------------------------------------------------------
+// Recompiled blocks kept across runs.  A block is stored with the guest code it was compiled
+// from, the displacements which reference code or data outside of it (see xRelocation), and
+// its links to other blocks, so that it can be copied anywhere in a code cache.
+//
+// The absolute addresses used by the code (the globals, the VM memory, the dispatchers) are
+// not relocated: the recompiler hashes them with the build and the settings affecting the
+// codegen into the layout, and a file saved with another layout is ignored.  The core is
+// position independent, so with ASLR the layout changes with every run and the file never
+// hits; the 64 bit immediates of the code aren't recorded by the emitter, which would be
+// needed to relocate against the base of the module instead.
+//
+class RecBlockCache
+{
+public:
+	enum RelocType
+	{
+		Reloc_Target,  // value is the target address
+		Reloc_Const,   // value is a 64 bit constant, allocated again by the recompiler
+		Reloc_Counter, // a counter of the recompiler, which allocates a new one
+	};
+
+	struct Reloc
+	{
+		u32 offset; // of the displacement in the code
+		u8 type;    // RelocType
+		u8 tail;    // see xRelocation, 0 for an absolute address
+		u16 pad;
+		u64 value;
+	};
+
+	struct Link
+	{
+		u32 offset; // of the rel32 in the code
+		u32 pc;     // of the target block
+	};
+
+	struct Block
+	{
+		u32 startpc;
+		u32 flags;     // owned by the recompiler
+		u64 stateHash; // the state the code depends on besides the guest code
+		std::vector<u32> guest;
+		std::vector<u8> code;
+		std::vector<Reloc> relocs;
+		std::vector<Link> links;
+	};
+
+protected:
+	std::unordered_multimap<u32, Block> m_blocks;
+	u32 m_magic;
+	u64 m_layout;
+	size_t m_codeSize;
+	size_t m_maxCodeSize;
+	bool m_modified;
+
+public:
+	RecBlockCache(u32 magic, size_t maxCodeSize);
+
+	void Reset(u64 layout);
+	bool Load(const wxString& filename);
+	bool Save(const wxString& filename);
+
+	void Add(Block&& block);
+	const Block* Find(u32 startpc, const void* guest, uint guestSize, u64 stateHash) const;
+
+	bool IsEmpty() const { return m_blocks.empty(); }
+	bool IsModified() const { return m_modified; }
+	u64 GetLayout() const { return m_layout; }
+
+	static u64 Hash(const void* data, size_t size, u64 hash = 0xcbf29ce484222325ULL);
+};
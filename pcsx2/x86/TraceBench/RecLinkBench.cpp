@@ -0,0 +1,264 @@
+/*  PCSX2 - PS2 Emulator for PCs
+ *  Copyright (C) 2002-2020  PCSX2 Dev Team
+ *
+ *  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with PCSX2.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Replays a recorded trace of the EE recompiler links (see BaseBlockTrace) against the
+// link table of BaseBlocks and the std::multimap it replaced, and reports their times.
+//
+//   rec_link_bench [options] <trace>
+//   rec_link_bench [options] --synthetic
+//
+// The synthetic trace is an overlay heavy game: a resident set of blocks, and overlays
+// which are compiled, linked to each other and to the resident code, then cleared.
+
+#include "PrecompiledHeader.h"
+#include "BaseblockEx.h"
+
+#include <chrono>
+#include <map>
+#include <random>
+#include <unordered_map>
+#include <wx/init.h>
+
+// BaseBlocks::links before BaseBlockLinks.
+class MultimapLinks
+{
+	std::multimap<u32, uptr> links;
+
+public:
+	void Add(u32 pc, uptr jumpptr)
+	{
+		links.insert(std::pair<u32, uptr>(pc, jumpptr));
+	}
+
+	void Patch(u32 pc, uptr target) const
+	{
+		auto range = links.equal_range(pc);
+		for (auto i = range.first; i != range.second; ++i)
+			*(u32*)i->second = target - (i->second + 4);
+	}
+
+	void Clear()
+	{
+		links.clear();
+	}
+};
+
+// A record with its site moved to the bench's own buffer.
+struct ReplayRecord
+{
+	u32 op;
+	u32 pc;
+	u32 site; // index in the sites
+};
+
+struct BenchOptions
+{
+	int iterations = 5;
+	u32 seed = 1;
+	bool synthetic = false;
+};
+
+static void Synthesize(std::vector<BaseBlockTraceRecord>& records, u32 seed)
+{
+	const u32 residentBlocks = 4000;
+	const u32 overlayBlocks = 3000;
+	const u32 overlayLoads = 200;
+	const u32 resetInterval = 50;
+	const u32 residentBase = 0x00100000;
+	const u32 overlayBase = 0x00800000;
+
+	std::mt19937 rng(seed);
+	u64 site = 0x10000000;
+
+	auto compile = [&](u32 pc, u32 linkBase, u32 linkBlocks) {
+		records.push_back({BlockTrace_New, pc, 0});
+		for (u32 i = 0, count = 1 + rng() % 3; i < count; i++)
+		{
+			// Mostly local jumps, some calls to the resident code.
+			const u32 target = rng() % 4 == 0 ? residentBase + (rng() % residentBlocks) * 0x40 : linkBase + (rng() % linkBlocks) * 0x40;
+			records.push_back({BlockTrace_Link, target, site});
+			site += 5 + rng() % 64;
+		}
+	};
+
+	for (u32 load = 0; load < overlayLoads; load++)
+	{
+		if (load % resetInterval == 0)
+		{
+			records.push_back({BlockTrace_Reset, 0, 0});
+			for (u32 i = 0; i < residentBlocks; i++)
+				compile(residentBase + i * 0x40, residentBase, residentBlocks);
+		}
+
+		// Only part of the overlay runs before the next one is loaded.
+		const u32 used = overlayBlocks / 2 + rng() % (overlayBlocks / 2);
+		for (u32 i = 0; i < used; i++)
+			compile(overlayBase + i * 0x40, overlayBase, overlayBlocks);
+		for (u32 i = 0; i < used; i++)
+			records.push_back({BlockTrace_Remove, overlayBase + i * 0x40, 0});
+	}
+}
+
+// Gives each jump site of the trace its own u32 in the bench's buffer.
+static u32 MapSites(const std::vector<BaseBlockTraceRecord>& records, std::vector<ReplayRecord>& replay)
+{
+	std::unordered_map<u64, u32> sites;
+	replay.reserve(records.size());
+
+	for (const BaseBlockTraceRecord& record : records)
+	{
+		u32 site = 0;
+		if (record.op == BlockTrace_Link)
+			site = sites.emplace(record.site, (u32)sites.size()).first->second;
+		replay.push_back({record.op, record.pc, site});
+	}
+
+	return sites.size();
+}
+
+template <typename Links>
+static double Replay(const std::vector<ReplayRecord>& replay, std::vector<u32>& sites)
+{
+	// The links are patched to the same targets BaseBlocks would use.
+	const uptr recompiler = 0x7f0000000000ULL;
+	const uptr code = 0x7f1000000000ULL;
+
+	std::fill(sites.begin(), sites.end(), 0);
+	Links links;
+
+	const auto start = std::chrono::steady_clock::now();
+	for (const ReplayRecord& record : replay)
+	{
+		switch (record.op)
+		{
+			case BlockTrace_New:
+				links.Patch(record.pc, code + record.pc * 4);
+				break;
+			case BlockTrace_Link:
+				links.Add(record.pc, (uptr)&sites[record.site]);
+				break;
+			case BlockTrace_Remove:
+				links.Patch(record.pc, recompiler);
+				break;
+			case BlockTrace_Reset:
+				links.Clear();
+				break;
+		}
+	}
+	const auto end = std::chrono::steady_clock::now();
+
+	return std::chrono::duration<double>(end - start).count();
+}
+
+template <typename Links>
+static bool Run(const char* name, const std::vector<ReplayRecord>& replay, std::vector<u32>& sites,
+				const BenchOptions& options, u64& checksum)
+{
+	double best = 0, total = 0;
+	for (int i = 0; i < options.iterations; i++)
+	{
+		const double seconds = Replay<Links>(replay, sites);
+		best = i == 0 ? seconds : std::min(best, seconds);
+		total += seconds;
+	}
+
+	u64 sum = 0;
+	for (u32 site : sites)
+		sum = sum * 31 + site;
+
+	printf("%-10s best %.3fms, average %.3fms, %.1f ns/record\n", name, best * 1000, total * 1000 / options.iterations,
+		   replay.empty() ? 0.0 : best * 1e9 / replay.size());
+
+	// Both must leave the same rel32 at every site.
+	const bool same = checksum == 0 || checksum == sum;
+	checksum = sum;
+	return same;
+}
+
+static void Usage()
+{
+	fprintf(stderr,
+			"Usage: rec_link_bench [options] <trace>\n"
+			"       rec_link_bench [options] --synthetic\n"
+			"  --iterations N  replays per table (default 5)\n"
+			"  --seed N        seed of the synthetic trace (default 1)\n");
+}
+
+int main(int argc, char* argv[])
+{
+	BenchOptions options;
+	int arg = 1;
+
+	for (; arg < argc && argv[arg][0] == '-'; arg++)
+	{
+		const wxString opt(fromUTF8(argv[arg]));
+		if (opt == L"--synthetic")
+			options.synthetic = true;
+		else if (opt == L"--iterations" && arg + 1 < argc)
+			options.iterations = std::max(atoi(argv[++arg]), 1);
+		else if (opt == L"--seed" && arg + 1 < argc)
+			options.seed = strtoul(argv[++arg], NULL, 0);
+		else
+		{
+			Usage();
+			return 1;
+		}
+	}
+
+	if (options.synthetic ? arg != argc : argc - arg != 1)
+	{
+		Usage();
+		return 1;
+	}
+
+	wxInitializer initializer(argc, argv);
+	if (!initializer.IsOk())
+	{
+		fprintf(stderr, "Unable to initialize wxWidgets\n");
+		return 1;
+	}
+
+	std::vector<BaseBlockTraceRecord> records;
+	if (options.synthetic)
+	{
+		Synthesize(records, options.seed);
+		printf("synthetic: %u records\n", (uint)records.size());
+	}
+	else
+	{
+		if (!BaseBlockTrace::Load(fromUTF8(argv[arg]), records))
+		{
+			fprintf(stderr, "Unable to load the trace %s\n", argv[arg]);
+			return 1;
+		}
+		printf("%s: %u records\n", argv[arg], (uint)records.size());
+	}
+
+	std::vector<ReplayRecord> replay;
+	std::vector<u32> sites(MapSites(records, replay));
+	printf("%u jump sites\n", (uint)sites.size());
+
+	u64 checksum = 0;
+	bool same = Run<MultimapLinks>("multimap", replay, sites, options, checksum);
+	same = Run<BaseBlockLinks>("flat", replay, sites, options, checksum) && same;
+
+	if (!same)
+	{
+		fprintf(stderr, "The tables patched the jumps differently\n");
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,295 @@
+/*  PCSX2 - PS2 Emulator for PCs
+ *  Copyright (C) 2002-2020  PCSX2 Dev Team
+ *
+ *  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with PCSX2.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Replays the unpack blocks of the newVif dynarec with the SSE code and with the AVX2 one
+// (see VifUnpackSSE_Dynarec::IsWideUnpack), checks that both write the same VU memory, and
+// reports their times.
+//
+//   vif_unpack_bench [options]
+//   vif_unpack_bench --check
+//
+// The blocks are the unmasked V4-32, V4-16 and V4-8 unpacks, with cl == wl and cl > wl, to
+// an even and an odd destination quadword, the cases the AVX2 code splits differently.
+// --check compiles every num from 1 to 256 instead of timing, and exits with 77 when the
+// host has no AVX2 (the skip code of ctest).  The wide stores are aligned, a wrong dstOdd
+// faults, and the upper halves of the ymm registers must be clean when a block returns.
+
+#include "PrecompiledHeader.h"
+#include "newVif_UnpackSSE.h"
+
+#include <chrono>
+#include <cpuid.h>
+#include <random>
+#include <wx/init.h>
+
+static const int CheckSkipped = 77;
+
+struct BenchOptions
+{
+	int iterations = 5;
+	u32 seed = 1;
+	bool check = false;
+};
+
+struct UnpackType
+{
+	const char* name;
+	int upk;
+};
+
+struct UnpackCycle
+{
+	int cl;
+	int wl;
+};
+
+static const UnpackType UnpackTypes[] = {{"V4-32", 12}, {"V4-16", 13}, {"V4-8", 14}};
+static const UnpackCycle UnpackCycles[] = {{4, 4}, {1, 1}, {16, 16}, {4, 2}, {4, 3}, {8, 5}, {2, 1}};
+
+// Twice the VU1 memory, more than the blocks below write.
+static const uint DestSize = 0x4000 * 2;
+static const uint SourceSize = 256 * 16;
+static const uint CodeSize = _1mb;
+
+// XGETBV with ecx = 1 (XINUSE), when the cpu has it.
+static bool HasXinuse()
+{
+	u32 eax, ebx, ecx, edx;
+	return __get_cpuid_count(0xd, 1, &eax, &ebx, &ecx, &edx) && (eax & 4);
+}
+
+// The upper halves of the ymm registers are in use: the SSE code which runs next pays the
+// AVX transition penalty.
+static __fi bool IsUpperStateDirty()
+{
+	u32 eax, edx;
+	__asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(1));
+	return eax & 4;
+}
+
+class UnpackBench
+{
+	u8* m_code;
+	u8* m_source;
+	u8* m_dest[2];
+	bool m_hasAVX2;
+	bool m_hasXinuse;
+	bool m_upperDirty;
+
+public:
+	UnpackBench()
+	{
+		m_code = (u8*)HostSys::Mmap(0, CodeSize);
+		if (m_code)
+			HostSys::MemProtect(m_code, CodeSize, PageAccess_Any());
+		m_source = (u8*)_aligned_malloc(SourceSize, 32);
+		m_dest[0] = (u8*)_aligned_malloc(DestSize, 32);
+		m_dest[1] = (u8*)_aligned_malloc(DestSize, 32);
+		m_hasAVX2 = x86caps.hasAVX2;
+		m_hasXinuse = HasXinuse();
+		m_upperDirty = false;
+	}
+
+	~UnpackBench()
+	{
+		x86caps.hasAVX2 = m_hasAVX2;
+		if (m_code)
+			HostSys::Munmap(m_code, CodeSize);
+		_aligned_free(m_source);
+		_aligned_free(m_dest[0]);
+		_aligned_free(m_dest[1]);
+	}
+
+	bool IsOk() const { return m_code && m_source && m_dest[0] && m_dest[1]; }
+
+	// The last block left the upper halves of the ymm registers in use.
+	bool IsUpperDirty() const { return m_upperDirty; }
+
+	void FillSource(std::mt19937& rng)
+	{
+		for (uint i = 0; i < SourceSize; i++)
+			m_source[i] = rng();
+	}
+
+	// The SSE code in the first half of the buffer, the AVX2 code in the second.
+	nVifrecCall Compile(const nVifBlock& block, bool avx2)
+	{
+		u8* code = m_code + (avx2 ? CodeSize / 2 : 0);
+
+		x86caps.hasAVX2 = avx2;
+		xSetPtr(code);
+		VifUnpackSSE_Dynarec(nVif[0], block).CompileRoutine();
+		pxAssert(xGetPtr() < code + CodeSize / 2);
+		x86caps.hasAVX2 = m_hasAVX2;
+
+		return (nVifrecCall)code;
+	}
+
+	u8* Run(nVifrecCall unpack, int dest, bool odd)
+	{
+		memset(m_dest[dest], 0xcd, DestSize);
+		u8* start = m_dest[dest] + (odd ? 16 : 0);
+		unpack((uptr)start, (uptr)m_source);
+		m_upperDirty = m_hasXinuse && IsUpperStateDirty();
+		return m_dest[dest];
+	}
+
+	double Time(nVifrecCall unpack, bool odd, int iterations)
+	{
+		u8* start = m_dest[0] + (odd ? 16 : 0);
+		double best = 0;
+
+		for (int i = 0; i < iterations; i++)
+		{
+			const auto begin = std::chrono::steady_clock::now();
+			for (int r = 0; r < 10000; r++)
+				unpack((uptr)start, (uptr)m_source);
+			const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count() / 10000;
+			best = i == 0 ? seconds : std::min(best, seconds);
+		}
+
+		return best;
+	}
+};
+
+static nVifBlock MakeBlock(const UnpackType& type, const UnpackCycle& cycle, int num, bool usn, bool odd)
+{
+	nVifBlock block = {};
+	block.num = num & 0xff;
+	block.upkType = type.upk | (usn << 5);
+	block.cl = cycle.cl;
+	block.wl = cycle.wl;
+	block.aligned = odd << 7; // as the key of dVifUnpack
+	return block;
+}
+
+// Every num, both signs and both parities of the destination.
+static int Check(UnpackBench& bench, const BenchOptions& options)
+{
+	std::mt19937 rng(options.seed);
+	int blocks = 0, failed = 0;
+
+	for (const UnpackType& type : UnpackTypes)
+	{
+		for (const UnpackCycle& cycle : UnpackCycles)
+		{
+			for (int num = 1; num <= 256; num++)
+			{
+				for (int variant = 0; variant < 4; variant++)
+				{
+					const bool usn = variant & 1;
+					const bool odd = variant & 2;
+					const nVifBlock block = MakeBlock(type, cycle, num, usn, odd);
+
+					bench.FillSource(rng);
+					const u8* sse = bench.Run(bench.Compile(block, false), 0, odd);
+					const u8* avx2 = bench.Run(bench.Compile(block, true), 1, odd);
+					blocks++;
+
+					const char* error = NULL;
+					if (memcmp(sse, avx2, DestSize))
+						error = "the AVX2 unpack differs";
+					else if (bench.IsUpperDirty())
+						error = "the AVX2 unpack returns without vzeroupper";
+
+					if (error && failed++ < 20)
+						fprintf(stderr, "%s cl=%d wl=%d num=%d usn=%d %s: %s\n",
+								type.name, cycle.cl, cycle.wl, num, usn, odd ? "odd" : "even", error);
+				}
+			}
+		}
+	}
+
+	printf("%d blocks, %d failed\n", blocks, failed);
+	return failed ? 1 : 0;
+}
+
+// A full packet of each kind, num = 0 (256 quadwords).
+static int Bench(UnpackBench& bench, const BenchOptions& options)
+{
+	std::mt19937 rng(options.seed);
+	bench.FillSource(rng);
+
+	for (const UnpackType& type : UnpackTypes)
+	{
+		for (const UnpackCycle& cycle : UnpackCycles)
+		{
+			for (int odd = 0; odd < 2; odd++)
+			{
+				const nVifBlock block = MakeBlock(type, cycle, 0, false, odd);
+				const double sse = bench.Time(bench.Compile(block, false), odd, options.iterations);
+				const double avx2 = bench.Time(bench.Compile(block, true), odd, options.iterations);
+
+				printf("%-6s cl=%-2d wl=%-2d %-4s sse %7.1f ns, avx2 %7.1f ns (%.2fx)\n",
+					   type.name, cycle.cl, cycle.wl, odd ? "odd" : "even", sse * 1e9, avx2 * 1e9, sse / avx2);
+			}
+		}
+	}
+
+	return 0;
+}
+
+static void Usage()
+{
+	fprintf(stderr,
+			"Usage: vif_unpack_bench [options]\n"
+			"  --check         compares the unpacks of every num instead of timing them\n"
+			"  --iterations N  timed runs per block, the best is reported (default 5)\n"
+			"  --seed N        seed of the source data (default 1)\n");
+}
+
+int main(int argc, char* argv[])
+{
+	BenchOptions options;
+
+	for (int arg = 1; arg < argc; arg++)
+	{
+		const wxString opt(fromUTF8(argv[arg]));
+		if (opt == L"--check")
+			options.check = true;
+		else if (opt == L"--iterations" && arg + 1 < argc)
+			options.iterations = std::max(atoi(argv[++arg]), 1);
+		else if (opt == L"--seed" && arg + 1 < argc)
+			options.seed = strtoul(argv[++arg], NULL, 0);
+		else
+		{
+			Usage();
+			return 1;
+		}
+	}
+
+	wxInitializer initializer(argc, argv);
+	if (!initializer.IsOk())
+	{
+		fprintf(stderr, "Unable to initialize wxWidgets\n");
+		return 1;
+	}
+
+	x86caps.Identify();
+	if (!x86caps.hasAVX2)
+	{
+		printf("The host has no AVX2, only the SSE unpacks are available\n");
+		return options.check ? CheckSkipped : 0;
+	}
+
+	UnpackBench bench;
+	if (!bench.IsOk())
+	{
+		fprintf(stderr, "Unable to allocate the code and VU memory buffers\n");
+		return 1;
+	}
+
+	return options.check ? Check(bench, options) : Bench(bench, options);
+}
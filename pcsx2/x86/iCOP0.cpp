@@ -219,6 +219,14 @@ void recMTC0()
 				xMOV(ecx, ptr[&cpuRegs.cycle]);
 				xMOV(ptr[&s_iLastCOP0Cycle], ecx);
 				xMOV(ptr32[&cpuRegs.CP0.r[9]], g_cpuConstRegs[_Rt_].UL[0]);
+				iFlushCall(FLUSH_INTERPRETER);
+				xFastCall((void*)cpuScheduleTIMR);
+			break;
+
+			case 11:
+				xMOV(ptr32[&cpuRegs.CP0.r[11]], g_cpuConstRegs[_Rt_].UL[0]);
+				iFlushCall(FLUSH_INTERPRETER);
+				xFastCall((void*)cpuScheduleTIMR);
 			break;
 
 			case 25:
@@ -269,6 +277,14 @@ void recMTC0()
 				xMOV(ecx, ptr[&cpuRegs.cycle]);
 				_eeMoveGPRtoM((uptr)&cpuRegs.CP0.r[9], _Rt_);
 				xMOV(ptr[&s_iLastCOP0Cycle], ecx);
+				iFlushCall(FLUSH_INTERPRETER);
+				xFastCall((void*)cpuScheduleTIMR);
+			break;
+
+			case 11:
+				_eeMoveGPRtoM((uptr)&cpuRegs.CP0.r[11], _Rt_);
+				iFlushCall(FLUSH_INTERPRETER);
+				xFastCall((void*)cpuScheduleTIMR);
 			break;
 
 			case 25:
@@ -22,6 +22,7 @@
 #include "R5900OpcodeTables.h"
 #include "iR5900.h"
 #include "BaseblockEx.h"
+#include "RecBlockCache.h"
 #include "System/RecTypes.h"
 
 #include "vtlb.h"
@@ -34,11 +35,15 @@
 
 #include "../DebugTools/Breakpoints.h"
 #include "Patch.h"
+#include "AppConfig.h"
+#include "svnrev.h"
 
 #if !PCSX2_SEH
 #	include <csetjmp>
 #endif
 
+#include <unordered_set>
+
 
 #include "Utilities/MemsetFast.inl"
 #include "Utilities/Perf.h"
@@ -93,6 +98,46 @@ static u32 s_nInstCacheSize = 0;
 
 static BASEBLOCK* s_pCurBlock = NULL;
 static BASEBLOCKEX* s_pCurBlockEx = NULL;
+
+// Blocks of the running game kept across runs (see RecBlockCache), saved in the cache folder
+// as eerec_<ElfCRC>.bin.  recRecompile copies a cached block instead of compiling it when the
+// guest code is the same.
+static RecBlockCache recBlockCache(0x43524545 /* "EERC" */, _64mb);
+static u32 recBlockCacheCRC = 0; // ElfCRC when recBlockCache was loaded
+
+// Recorded while a block is compiled, for recBlockCache
+static std::vector<xRelocation> s_blockRelocs;
+static std::vector<RecBlockCache::Link> s_blockLinks;
+static u32 s_blockFlags;
+
+enum
+{
+	BLOCK_PROTECTED = 1 << 0, // the block relies on the write protection of its page
+	BLOCK_NOCACHE = 1 << 1,   // the code depends on more than the guest code (hooks, debugger)
+	BLOCK_COUNTED = 1 << 2,   // the block counts its runs to be promoted (s_blockCounter)
+};
+
+// Tiered compilation (EmuConfig.Cpu.Recompiler.EnableEETiering): the blocks ending with a
+// forward conditional branch count their runs, and when they get hot they are compiled again
+// as superblocks.  A superblock goes on with the fall-through path of its conditional branches
+// until the end of the page, so the registers and the constants are kept across what were
+// blocks of their own; the taken paths are side exits linked to the other blocks.
+static const u32 EE_HOT_BLOCK_RUNS = 2048;
+static std::unordered_set<u32> s_hotBlocks; // startpc of the blocks to compile as superblocks
+static u32* s_blockCounter;                 // of the current block, in recConstBuf
+
+static bool s_nBlockSuper;                  // the current block is a superblock
+static u32 s_nBlockContinue;                // where it goes on after the current branch
+static EEINST* s_pContinueInstInfo;
+static bool s_branchStateSaved;             // the branch is compiling its other path
+static bool s_blockContinued;               // the last instruction went on with its fall-through
+
+static void recLinkBlock(u32 pc, s32* jumpptr)
+{
+	recBlocks.Link(pc, jumpptr);
+	s_blockLinks.push_back({(u32)((u8*)jumpptr - recPtr), pc});
+}
+
 u32 s_nEndBlock = 0; // what pc the current block ends
 u32 s_branchTo;
 static bool s_nBlockFF;
@@ -291,6 +336,17 @@ u32* recGetImm64(u32 hi, u32 lo)
 	return imm64;
 }
 
+// A run counter for tier 1 blocks, never shared like the constants.
+static u32* recAllocCounter()
+{
+	u32* counter = recConstBufPtr;
+	recConstBufPtr += 2;
+
+	counter[0] = EE_HOT_BLOCK_RUNS;
+	counter[1] = 0;
+	return counter;
+}
+
 // Use this to call into interpreter functions that require an immediate branchtest
 // to be done afterward (anything that throws an exception or enables interrupts, etc).
 void recBranchCall( void (*func)() )
@@ -318,6 +374,7 @@ void recCall( void (*func)() )
 static void __fastcall recRecompile( const u32 startpc );
 static void __fastcall dyna_block_discard(u32 start,u32 sz);
 static void __fastcall dyna_page_reset(u32 start,u32 sz);
+static void __fastcall dyna_block_promote(u32 start,u32 sz);
 
 // Recompiled code buffer for EE recompiler dispatchers!
 static u8 __pagealigned eeRecDispatchers[__pagesize];
@@ -332,6 +389,7 @@ static DynGenFunc* EnterRecompiledCode	= NULL;
 static DynGenFunc* ExitRecompiledCode	= NULL;
 static DynGenFunc* DispatchBlockDiscard = NULL;
 static DynGenFunc* DispatchPageReset    = NULL;
+static DynGenFunc* DispatchBlockPromote = NULL;
 
 static void recEventTest()
 {
@@ -435,6 +493,14 @@ static DynGenFunc* _DynGen_DispatchPageReset()
 	return (DynGenFunc*)retval;
 }
 
+static DynGenFunc* _DynGen_DispatchBlockPromote()
+{
+	u8* retval = xGetPtr();
+	xFastCall((void*)dyna_block_promote);
+	xJMP((void*)DispatcherReg);
+	return (DynGenFunc*)retval;
+}
+
 static void _DynGen_Dispatchers()
 {
 	// In case init gets called multiple times:
@@ -455,6 +521,7 @@ static void _DynGen_Dispatchers()
 	EnterRecompiledCode  = _DynGen_EnterRecompiledCode();
 	DispatchBlockDiscard = _DynGen_DispatchBlockDiscard();
 	DispatchPageReset    = _DynGen_DispatchPageReset();
+	DispatchBlockPromote = _DynGen_DispatchBlockPromote();
 
 	HostSys::MemProtectStatic( eeRecDispatchers, PageAccess_ExecOnly() );
 
@@ -592,6 +659,49 @@ static bool g_resetEeScalingStats = false;
 static int g_patchesNeedRedo = 0;
 
 ////////////////////////////////////////////////////
+// What the recompiled code depends on besides the guest code and the TLB: the addresses which
+// are not relocated, the build, the host CPU and the settings which change the codegen.
+static u64 recBlockCacheLayout()
+{
+	const uptr addresses[] = {(uptr)&cpuRegs, (uptr)&vtlb_private::vtlbdata, (uptr)eeMem, (uptr)recLUT, (uptr)&recRecompile};
+	const u32 settings[] = {
+		x86caps.Flags, x86caps.Flags2, x86caps.EFlags, x86caps.EFlags2, x86caps.SEFlag,
+		EmuConfig.Cpu.Recompiler.bitset, EmuConfig.Cpu.sseMXCSR.bitmask, EmuConfig.Gamefixes.bitset,
+		EmuConfig.Speedhacks.bitset, (u32)EmuConfig.Speedhacks.EECycleRate, EmuConfig.Speedhacks.EECycleSkip};
+
+	u64 hash = RecBlockCache::Hash(addresses, sizeof(addresses));
+	hash = RecBlockCache::Hash(GIT_REV, strlen(GIT_REV), hash);
+	hash = RecBlockCache::Hash(eeRecDispatchers, sizeof(eeRecDispatchers), hash);
+	return RecBlockCache::Hash(settings, sizeof(settings), hash);
+}
+
+static wxString recBlockCacheFilename(u32 crc)
+{
+	wxDirName folder(GetSettingsFolder().Combine(wxDirName(L"cache")));
+	folder.Mkdir();
+	return Path::Combine(folder, wxsFormat(L"eerec_%08X.bin", crc));
+}
+
+static void recBlockCacheFlush()
+{
+	if (recBlockCacheCRC == 0 || !recBlockCache.IsModified())
+		return;
+
+	if (!recBlockCache.Save(recBlockCacheFilename(recBlockCacheCRC)))
+		Console.Warning("EE/iR5900-32 Block cache: could not save the blocks of %08X.", recBlockCacheCRC);
+}
+
+// Called when the game (ElfCRC) or the layout changes.
+static void recBlockCacheSwitch()
+{
+	recBlockCacheFlush();
+	recBlockCache.Reset(recBlockCacheLayout());
+
+	recBlockCacheCRC = EmuConfig.Cpu.Recompiler.EnableEEBlockCache ? ElfCRC : 0;
+	if (recBlockCacheCRC != 0 && recBlockCache.Load(recBlockCacheFilename(recBlockCacheCRC)))
+		Console.WriteLn(Color_StrongBlack, "EE/iR5900-32 Block cache: loaded the blocks of %08X.", recBlockCacheCRC);
+}
+
 static void recResetRaw()
 {
 	Perf::ee.reset();
@@ -616,7 +726,9 @@ static void recResetRaw()
 	if( s_pInstCache )
 		memset( s_pInstCache, 0, sizeof(EEINST)*s_nInstCacheSize );
 
+	recBlocks.SetTrace(EmuConfig.RecTraceLinks);
 	recBlocks.Reset();
+	s_hotBlocks.clear();
 	mmap_ResetBlockTracking();
 
 	x86SetPtr(*recMem);
@@ -624,13 +736,40 @@ static void recResetRaw()
 	recPtr = *recMem;
 	recConstBufPtr = recConstBuf;
 
+	// In case the last block didn't finish (and the settings may have changed).
+	xRelocations = NULL;
+	if (recBlockCacheCRC != 0 && recBlockCache.GetLayout() != recBlockCacheLayout())
+		recBlockCacheSwitch();
+
 	g_branch = 0;
 	g_resetEeScalingStats = true;
 	g_patchesNeedRedo = 1;
 }
 
+// EmuConfig.RecTraceLinks, see BaseBlockTrace
+static void recSaveLinkTrace()
+{
+	const BaseBlockTrace* trace = recBlocks.GetTrace();
+	if (!trace || !trace->GetCount())
+		return;
+
+	g_Conf->Folders.Logs.Mkdir();
+	wxString filename(Path::Combine(g_Conf->Folders.Logs, wxFileName(L"eerec_links.bbtrace")));
+
+	if (trace->Save(filename))
+		Console.WriteLn(Color_StrongBlue, L"EE/iR5900-32 Link trace: %u records saved to %s", trace->GetCount(), WX_STR(filename));
+	else
+		Console.Error(L"EE/iR5900-32 Link trace: unable to write %s", WX_STR(filename));
+}
+
 static void recShutdown()
 {
+	recSaveLinkTrace();
+	recBlocks.SetTrace(false);
+	recBlockCacheFlush();
+	recBlockCache.Reset(0);
+	recBlockCacheCRC = 0;
+
 	safe_delete( recMem );
 	safe_aligned_free( recRAMCopy );
 	safe_aligned_free( recLutReserve_RAM );
@@ -906,10 +1045,23 @@ void SetBranchReg( u32 reg )
 
 void SetBranchImm( u32 imm )
 {
-	g_branch = 1;
-
 	pxAssert( imm );
 
+	// A superblock goes on with the fall-through path once the other one is compiled, the
+	// registers and the constants are left as they are.  The taken path set g_branch, and
+	// LoadBranchState doesn't restore it: clear it or the block would end here without a
+	// jump to the fall-through.
+	if (imm == s_nBlockContinue && !s_branchStateSaved)
+	{
+		pc = imm;
+		g_pCurInstInfo = s_pContinueInstInfo;
+		g_branch = 0;
+		s_blockContinued = true;
+		return;
+	}
+
+	g_branch = 1;
+
 	// end the current block
 	iFlushCall(FLUSH_EVERYTHING);
 	xMOV(ptr32[&cpuRegs.pc], imm);
@@ -918,6 +1070,7 @@ void SetBranchImm( u32 imm )
 
 void SaveBranchState()
 {
+	s_branchStateSaved = true;
 	s_savenBlockCycles = s_nBlockCycles;
 	memcpy(s_saveConstRegs, g_cpuConstRegs, sizeof(g_cpuConstRegs));
 	s_saveHasConstReg = g_cpuHasConstReg;
@@ -929,6 +1082,7 @@ void SaveBranchState()
 
 void LoadBranchState()
 {
+	s_branchStateSaved = false;
 	s_nBlockCycles = s_savenBlockCycles;
 
 	memcpy(g_cpuConstRegs, s_saveConstRegs, sizeof(g_cpuConstRegs));
@@ -1090,7 +1244,7 @@ static void iBranchTest(u32 newpc)
 		if (newpc == 0xffffffff)
 			xJS( DispatcherReg );
 		else
-			recBlocks.Link(HWADDR(newpc), xJcc32(Jcc_Signed));
+			recLinkBlock(HWADDR(newpc), xJcc32(Jcc_Signed));
 
 		xJMP( (void*)DispatcherEvent );
 	}
@@ -1534,6 +1688,15 @@ void __fastcall dyna_page_reset(u32 start,u32 sz)
 	mmap_MarkCountedRamPage( start );
 }
 
+// called when the counter of a tier 1 block runs out.  The block is cleared, and compiled again
+// as a superblock when the dispatcher jumps to it.
+void __fastcall dyna_block_promote(u32 start,u32 sz)
+{
+	eeRecPerfLog.Write( "Promoting block @ 0x%08X  [size=%d]", start, sz*4 );
+	s_hotBlocks.insert(start);
+	recClear(start, sz);
+}
+
 static void memory_protect_recompiled_code(u32 startpc, u32 size)
 {
 	u32 inpage_ptr = HWADDR(startpc);
@@ -1555,6 +1718,7 @@ static void memory_protect_recompiled_code(u32 startpc, u32 size)
         case ProtMode_Write:
 			mmap_MarkCountedRamPage( inpage_ptr );
 			manual_page[inpage_ptr >> 12] = 0;
+			s_blockFlags |= BLOCK_PROTECTED;
 			break;
 
         case ProtMode_Manual:
@@ -1651,6 +1815,181 @@ void doPlace0Patches()
     ApplyLoadedPatches(PPT_ONCE_ON_LOAD);
 }
 
+// Makes the block at recPtr (s_pCurBlock and s_pCurBlockEx) reachable, once its code is
+// complete.  Overlapping blocks whose code has changed are cleared.
+static void recRegisterBlock(u32 startpc, u32 endpc)
+{
+	if (HWADDR(endpc) <= Ps2MemSize::MainRam) {
+		BASEBLOCKEX *oldBlock;
+		int i;
+
+		i = recBlocks.LastIndex(HWADDR(endpc) - 4);
+		while (oldBlock = recBlocks[i--]) {
+			if (oldBlock == s_pCurBlockEx)
+				continue;
+			if (oldBlock->startpc >= HWADDR(endpc))
+				continue;
+			if ((oldBlock->startpc + oldBlock->size * 4) <= HWADDR(startpc))
+				break;
+
+			if (memcmp(&recRAMCopy[oldBlock->startpc / 4], PSM(oldBlock->startpc),
+			           oldBlock->size * 4))
+			{
+				recClear(startpc, (endpc - startpc) / 4);
+				s_pCurBlockEx = recBlocks.Get(HWADDR(startpc));
+				pxAssert(s_pCurBlockEx->startpc == HWADDR(startpc));
+				break;
+			}
+		}
+
+		memcpy(&recRAMCopy[HWADDR(startpc) / 4], PSM(startpc), endpc - startpc);
+	}
+
+	s_pCurBlock->SetFnptr((uptr)recPtr);
+
+	for(u32 i = 1; i < (u32)s_pCurBlockEx->size; i++) {
+		if ((uptr)JITCompile == s_pCurBlock[i].GetFnptr())
+			s_pCurBlock[i].SetFnptr((uptr)JITCompileInBlock);
+	}
+
+	if( !(endpc&0x10000000) )
+		maxrecmem = std::max( (endpc&~0xa0000000), maxrecmem );
+}
+
+// vtlb_DynGen*_Const resolve the addresses through the TLB when the block is compiled.
+static u64 recBlockStateHash()
+{
+	return RecBlockCache::Hash(tlb, sizeof(tlb));
+}
+
+// Adds the block which has just been compiled to recBlockCache.
+static void recBlockCacheAdd(u32 startpc)
+{
+	const u8* guest = (u8*)PSM(startpc);
+	if (recBlockCacheCRC == 0 || (s_blockFlags & BLOCK_NOCACHE) || !guest || s_pCurBlockEx->size == 0)
+		return;
+
+	const u8* code = (u8*)s_pCurBlockEx->fnptr;
+	const uint size = s_pCurBlockEx->x86size;
+
+	RecBlockCache::Block block;
+	block.startpc = HWADDR(startpc);
+	block.flags = s_blockFlags;
+	block.stateHash = recBlockStateHash();
+	block.guest.assign((u32*)guest, (u32*)guest + s_pCurBlockEx->size);
+	block.code.assign(code, code + size);
+
+	for (const xRelocation& reloc : s_blockRelocs)
+	{
+		const uptr target = reloc.GetTarget();
+		const sptr offset = (u8*)reloc.disp - code;
+		pxAssert(offset >= 0 && offset + sizeof(s32) <= size);
+
+		if (target >= (uptr)code && target < (uptr)code + size)
+			continue;
+
+		if (target == (uptr)s_blockCounter)
+			block.relocs.push_back({(u32)offset, RecBlockCache::Reloc_Counter, (u8)reloc.tail, 0, 0});
+		else if (target >= (uptr)recConstBuf && target < (uptr)(recConstBuf + RECCONSTBUF_SIZE))
+			block.relocs.push_back({(u32)offset, RecBlockCache::Reloc_Const, (u8)reloc.tail, 0, *(u64*)target});
+		else if (target >= (uptr)(u8*)*recMem && target < (uptr)recMem->GetPtrEnd())
+			return; // into another block, only the links can be moved
+		else
+			block.relocs.push_back({(u32)offset, RecBlockCache::Reloc_Target, (u8)reloc.tail, 0, target});
+	}
+
+	block.links = s_blockLinks;
+	recBlockCache.Add(std::move(block));
+}
+
+// Copies the cached block for the code at startpc to recPtr instead of recompiling it.
+static bool recLoadCachedBlock(u32 startpc)
+{
+	if (recBlockCache.IsEmpty())
+		return false;
+
+	// The hooks are compiled in these blocks
+	if (HWADDR(startpc) == EELOAD_START || (g_eeloadMain && HWADDR(startpc) == HWADDR(g_eeloadMain)) ||
+		(g_eeloadExec && HWADDR(startpc) == HWADDR(g_eeloadExec)) || (g_GameLoading && HWADDR(startpc) == ElfEntry))
+		return false;
+
+	// Blocks end at page boundaries, or after the delay slot of a branch at the end of the page.
+	const u8* guest = (u8*)PSM(startpc);
+	if (!guest)
+		return false;
+
+	const RecBlockCache::Block* block = recBlockCache.Find(HWADDR(startpc), guest, 0x1004 - (startpc & 0xfff), recBlockStateHash());
+	if (!block)
+		return false;
+
+	// Promoted, the superblock must be compiled.
+	if ((block->flags & BLOCK_COUNTED) && s_hotBlocks.count(HWADDR(startpc)))
+		return false;
+
+	// A protected block may only count on the write protection of its page when
+	// recRecompile would protect it now: not on the thread stack pages, and not once the
+	// page was demoted to manual checks.
+	if (block->flags & BLOCK_PROTECTED)
+	{
+		const bool contains_thread_stack = ((startpc >> 12) == 0x81) || ((startpc >> 12) == 0x80001);
+		const vtlb_ProtectionMode PageType = mmap_GetRamPageInfo(HWADDR(startpc));
+		if (contains_thread_stack || (PageType != ProtMode_None && PageType != ProtMode_Write))
+			return false;
+	}
+
+	const u32 endpc = startpc + block->guest.size() * 4;
+	for (u32 i = startpc; i < endpc; i += 4)
+	{
+		if (isBreakpointNeeded(i) != 0 || isMemcheckNeeded(i) != 0)
+			return false;
+	}
+
+	if (recConstBufPtr + block->relocs.size() * 2 >= recConstBuf + RECCONSTBUF_SIZE - 64)
+		return false;
+
+	u8* code = recPtr;
+	memcpy(code, block->code.data(), block->code.size());
+
+	for (const RecBlockCache::Reloc& reloc : block->relocs)
+	{
+		s32* disp = (s32*)(code + reloc.offset);
+		uptr target = (uptr)reloc.value;
+		if (reloc.type == RecBlockCache::Reloc_Const)
+			target = (uptr)recGetImm64((u32)(reloc.value >> 32), (u32)reloc.value);
+		else if (reloc.type == RecBlockCache::Reloc_Counter)
+			target = (uptr)recAllocCounter();
+
+		const sptr value = reloc.tail ? (sptr)target - (sptr)((u8*)disp + reloc.tail) : (sptr)target;
+		if (value != (s32)value)
+			return false;
+		*disp = (s32)value;
+	}
+
+	s_pCurBlock = PC_GETBLOCK(startpc);
+	s_pCurBlockEx = recBlocks.New(HWADDR(startpc), (uptr)code);
+	s_pCurBlockEx->size = block->guest.size();
+	s_pCurBlockEx->x86size = block->code.size();
+
+	for (const RecBlockCache::Link& link : block->links)
+		recBlocks.Link(link.pc, (s32*)(code + link.offset));
+
+	if (block->flags & BLOCK_PROTECTED)
+	{
+		mmap_MarkCountedRamPage(HWADDR(startpc));
+		manual_page[HWADDR(startpc) >> 12] = 0;
+	}
+
+	recRegisterBlock(startpc, endpc);
+
+	Perf::ee.map(s_pCurBlockEx->fnptr, s_pCurBlockEx->x86size, s_pCurBlockEx->startpc);
+
+	recPtr = code + block->code.size();
+
+	s_pCurBlock = NULL;
+	s_pCurBlockEx = NULL;
+	return true;
+}
+
 static void __fastcall recRecompile( const u32 startpc )
 {
 	u32 i = 0;
@@ -1677,6 +2016,18 @@ static void __fastcall recRecompile( const u32 startpc )
 	xSetPtr( recPtr );
 	recPtr = xGetAlignedCallTarget();
 
+	if (ElfCRC != recBlockCacheCRC && (ElfCRC == 0 || EmuConfig.Cpu.Recompiler.EnableEEBlockCache))
+		recBlockCacheSwitch();
+
+	if (recLoadCachedBlock(startpc))
+		return;
+
+	s_blockRelocs.clear();
+	s_blockLinks.clear();
+	s_blockFlags = 0;
+	s_blockCounter = NULL;
+	xRelocations = &s_blockRelocs;
+
 	if (0x8000d618 == startpc)
 		DbgCon.WriteLn("Compiling block @ 0x%08x", startpc);
 
@@ -1702,6 +2053,7 @@ static void __fastcall recRecompile( const u32 startpc )
 
 	if (g_eeloadMain && HWADDR(startpc) == HWADDR(g_eeloadMain))
 	{
+		s_blockFlags |= BLOCK_NOCACHE;
 		xFastCall((void*)eeloadHook);
 		if (g_SkipBiosHack)
 		{
@@ -1730,11 +2082,15 @@ static void __fastcall recRecompile( const u32 startpc )
 	}
 	
 	if (g_eeloadExec && HWADDR(startpc) == HWADDR(g_eeloadExec))
+	{
+		s_blockFlags |= BLOCK_NOCACHE;
 		xFastCall((void*)eeloadHook2);
+	}
 
 	// this is the only way patches get applied, doesn't depend on a hack
 	if (g_GameLoading && HWADDR(startpc) == ElfEntry) {
 		Console.WriteLn(L"Elf entry point @ 0x%08x about to get recompiled. Load patches first.", startpc);
+		s_blockFlags |= BLOCK_NOCACHE;
 		xFastCall((void*)eeGameStarting);
 
 		// Apply patch as soon as possible. Normally it is done in
@@ -1759,14 +2115,17 @@ static void __fastcall recRecompile( const u32 startpc )
 		// [TODO] : These must be enabled from the GUI or INI to be used, otherwise the
 		// code that calls PreBlockCheck will not be generated.
 
+		s_blockFlags |= BLOCK_NOCACHE;
 		xFastCall((void*)PreBlockCheck, pc);
 	}
 
 	if (EmuConfig.Gamefixes.GoemonTlbHack) {
 		if (pc == 0x33ad48 || pc == 0x35060c) {
 			// 0x33ad48 and 0x35060c are the return address of the function (0x356250) that populate the TLB cache
+			s_blockFlags |= BLOCK_NOCACHE;
 			xFastCall((void*)GoemonPreloadTlb);
 		} else if (pc == 0x3563b8) {
+			s_blockFlags |= BLOCK_NOCACHE;
 			// Game will unmap some virtual addresses. If a constant address were hardcoded in the block, we would be in a bad situation.
 			eeRecNeedsReset = true;
 			// 0x3563b8 is the start address of the function that invalidate entry in TLB cache
@@ -1779,18 +2138,25 @@ static void __fastcall recRecompile( const u32 startpc )
 	s_nEndBlock = 0xffffffff;
 	s_branchTo = -1;
 
+	s_nBlockSuper = EmuConfig.Cpu.Recompiler.EnableEETiering && !(s_blockFlags & BLOCK_NOCACHE) &&
+		s_hotBlocks.count(HWADDR(startpc));
+	bool extensible = false; // a superblock would go on after the last branch
+
 	// compile breakpoints as individual blocks
 	int n1 = isBreakpointNeeded(i);
 	int n2 = isMemcheckNeeded(i);
 	int n = std::max<int>(n1,n2);
 	if (n != 0)
 	{
+		s_blockFlags |= BLOCK_NOCACHE;
+		s_nBlockSuper = false;
 		s_nEndBlock = i + n*4;
 		goto StartRecomp;
 	}
 
 	while(1) {
 		BASEBLOCK* pblock = PC_GETBLOCK(i);
+		bool condbranch = false;
 
 		// stop before breakpoints
 		if (isBreakpointNeeded(i) != 0 || isMemcheckNeeded(i) != 0)
@@ -1810,7 +2176,8 @@ static void __fastcall recRecompile( const u32 startpc )
 				break;
 			}
 
-			if (pblock->GetFnptr() != (uptr)JITCompile && pblock->GetFnptr() != (uptr)JITCompileInBlock)
+			// superblocks are compiled over the blocks they run into
+			if (!s_nBlockSuper && pblock->GetFnptr() != (uptr)JITCompile && pblock->GetFnptr() != (uptr)JITCompileInBlock)
 			{
 				willbranch3 = 1;
 				s_nEndBlock = i;
@@ -1834,10 +2201,7 @@ static void __fastcall recRecompile( const u32 startpc )
 				if( _Rt_ < 4 || (_Rt_ >= 16 && _Rt_ < 20) ) {
 					// branches
 					s_branchTo = _Imm_ * 4 + i + 4;
-					if( s_branchTo > startpc && s_branchTo < i ) s_nEndBlock = s_branchTo;
-					else  s_nEndBlock = i+8;
-
-					goto StartRecomp;
+					condbranch = true;
 				}
 				break;
 
@@ -1851,10 +2215,8 @@ static void __fastcall recRecompile( const u32 startpc )
 			case 4: case 5: case 6: case 7:
 			case 20: case 21: case 22: case 23:
 				s_branchTo = _Imm_ * 4 + i + 4;
-				if( s_branchTo > startpc && s_branchTo < i ) s_nEndBlock = s_branchTo;
-				else  s_nEndBlock = i+8;
-
-				goto StartRecomp;
+				condbranch = true;
+				break;
 
 			case 16: // cp0
 				if( _Rs_ == 16 ) {
@@ -1872,14 +2234,25 @@ static void __fastcall recRecompile( const u32 startpc )
 					// BC1F, BC1T, BC1FL, BC1TL
 					// BC2F, BC2T, BC2FL, BC2TL
 					s_branchTo = _Imm_ * 4 + i + 4;
-					if( s_branchTo > startpc && s_branchTo < i ) s_nEndBlock = s_branchTo;
-					else  s_nEndBlock = i+8;
-
-					goto StartRecomp;
+					condbranch = true;
 				}
 				break;
 		}
 
+		if (condbranch) {
+			if( s_branchTo > startpc && s_branchTo < i ) s_nEndBlock = s_branchTo;
+			else  s_nEndBlock = i+8;
+
+			// the fall-through path, if it's in the same page
+			extensible = s_nEndBlock == i + 8 && ((i + 8) & 0xffc) != 0;
+			if (!s_nBlockSuper || !extensible)
+				goto StartRecomp;
+
+			s_branchTo = -1;
+			i += 8;
+			continue;
+		}
+
 		i += 4;
 	}
 
@@ -2038,6 +2411,22 @@ StartRecomp:
 	if (dumplog & 1) iDumpBlock(startpc, recPtr);
 #endif
 
+	// Tier 1 blocks which would make a longer superblock count their runs, the counter is
+	// checked first so that the block can be cleared before it has done anything.
+	if (extensible && !s_nBlockSuper && EmuConfig.Cpu.Recompiler.EnableEETiering &&
+		!(s_blockFlags & BLOCK_NOCACHE) && HWADDR(startpc) < Ps2MemSize::MainRam)
+	{
+		s_blockFlags |= BLOCK_COUNTED;
+		s_blockCounter = recAllocCounter();
+
+		xSUB(ptr32[s_blockCounter], 1);
+		xForwardJNZ8 notHot;
+		xMOV(arg1regd, HWADDR(startpc));
+		xMOV(arg2regd, (s_nEndBlock - startpc) >> 2);
+		xJMP((void*)DispatchBlockPromote);
+		notHot.SetTarget();
+	}
+
 	// Detect and handle self-modified code
 	memory_protect_recompiled_code(startpc, (s_nEndBlock-startpc) >> 2);
 
@@ -2048,8 +2437,19 @@ StartRecomp:
 		// Finally: Generate x86 recompiled code!
 		g_pCurInstInfo = s_pInstCache;
 		while (!g_branch && pc < s_nEndBlock) {
+			// where a superblock goes on if this is a conditional branch (see SetBranchImm)
+			s_nBlockContinue = s_nBlockSuper && pc + 8 < s_nEndBlock ? pc + 8 : 0;
+			s_pContinueInstInfo = g_pCurInstInfo + 2;
+			s_branchStateSaved = false;
+			s_blockContinued = false;
+
 			recompileNextInstruction(0);		// For the love of recursion, batman!
+
+			// a conditional branch in the middle of a superblock must not end it
+			pxAssertDev(!s_blockContinued || (!g_branch && pc < s_nEndBlock),
+				"EE superblock ends on the fall-through of a conditional branch");
 		}
+		s_nBlockContinue = 0;
 	}
 
 #ifdef PCSX2_DEBUG
@@ -2059,41 +2459,7 @@ StartRecomp:
 	pxAssert( (pc-startpc)>>2 <= 0xffff );
 	s_pCurBlockEx->size = (pc-startpc)>>2;
 
-	if (HWADDR(pc) <= Ps2MemSize::MainRam) {
-		BASEBLOCKEX *oldBlock;
-		int i;
-
-		i = recBlocks.LastIndex(HWADDR(pc) - 4);
-		while (oldBlock = recBlocks[i--]) {
-			if (oldBlock == s_pCurBlockEx)
-				continue;
-			if (oldBlock->startpc >= HWADDR(pc))
-				continue;
-			if ((oldBlock->startpc + oldBlock->size * 4) <= HWADDR(startpc))
-				break;
-
-			if (memcmp(&recRAMCopy[oldBlock->startpc / 4], PSM(oldBlock->startpc),
-			           oldBlock->size * 4))
-			{
-				recClear(startpc, (pc - startpc) / 4);
-				s_pCurBlockEx = recBlocks.Get(HWADDR(startpc));
-				pxAssert(s_pCurBlockEx->startpc == HWADDR(startpc));
-				break;
-			}
-		}
-
-		memcpy(&recRAMCopy[HWADDR(startpc) / 4], PSM(startpc), pc - startpc);
-	}
-
-	s_pCurBlock->SetFnptr((uptr)recPtr);
-
-	for(i = 1; i < (u32)s_pCurBlockEx->size; i++) {
-		if ((uptr)JITCompile == s_pCurBlock[i].GetFnptr())
-			s_pCurBlock[i].SetFnptr((uptr)JITCompileInBlock);
-	}
-
-	if( !(pc&0x10000000) )
-		maxrecmem = std::max( (pc&~0xa0000000), maxrecmem );
+	recRegisterBlock(startpc, pc);
 
 	if( g_branch == 2 )
 	{
@@ -2128,7 +2494,7 @@ StartRecomp:
 			{
 				xMOV( ptr32[&cpuRegs.pc], pc );
 				xADD( ptr32[&cpuRegs.cycle], scaleblockcycles() );
-				recBlocks.Link( HWADDR(pc), xJcc32() );
+				recLinkBlock( HWADDR(pc), xJcc32() );
 			}
 		}
 	}
@@ -2147,6 +2513,9 @@ StartRecomp:
 #endif
 	Perf::ee.map(s_pCurBlockEx->fnptr, s_pCurBlockEx->x86size, s_pCurBlockEx->startpc);
 
+	xRelocations = NULL;
+	recBlockCacheAdd(startpc);
+
 	recPtr = xGetPtr();
 
 	pxAssert( (g_cpuHasConstReg&g_cpuFlushedConstReg) == g_cpuHasConstReg );
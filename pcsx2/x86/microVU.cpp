@@ -69,6 +69,7 @@ void mVUinit(microVU& mVU, uint vuIndex) {
 	else mVU.dispCache = vu0_RecDispatchers;
 
 	mVU.regAlloc.reset(new microRegAlloc(mVU.index));
+	mVU.progCache.reset(new microProgCache(mVU.index));
 }
 
 // Resets Rec Data
@@ -112,6 +113,7 @@ void mVUreset(microVU& mVU, bool resetReserve) {
 	mVU.prog.x86end		= z + ((mVU.cacheSize - mVUcacheSafeZone) * _1mb);
 	//memset(mVU.prog.x86start, 0xcc, mVU.cacheSize*_1mb);
 
+	mVUcacheMerge(mVU); // Keep the programs compiled so far
 	for(u32 i = 0; i < (mVU.progSize / 2); i++) {
 		if(!mVU.prog.prog[i]) {
 			mVU.prog.prog[i] = new std::deque<microProgram*>();
@@ -126,6 +128,10 @@ void mVUreset(microVU& mVU, bool resetReserve) {
 		mVU.prog.quick[i].prog  = NULL;
 	}
 
+	if (!mVU.prog.index) mVU.prog.index = new microProgramIndex();
+	else mVU.prog.index->clear();
+	memset(mVU.prog.dirtyLines, 0xff, sizeof(mVU.prog.dirtyLines)); // Rehash the whole micro memory
+
 	HostSys::MemProtect(mVU.dispCache, mVUdispCacheSize, PageAccess_ExecOnly());
 
 	if (mVU.index) Perf::any.map((uptr)&mVU.dispCache, mVUdispCacheSize, "mVU1 Dispatcher");
@@ -137,6 +143,8 @@ void mVUclose(microVU& mVU) {
 
 	safe_delete  (mVU.cache_reserve);
 
+	mVUcacheFlush(mVU);
+
 	// Delete Programs and Block Managers
 	for (u32 i = 0; i < (mVU.progSize / 2); i++) {
 		if (!mVU.prog.prog[i]) continue;
@@ -146,10 +154,18 @@ void mVUclose(microVU& mVU) {
 		}
 		safe_delete(mVU.prog.prog[i]);
 	}
+	safe_delete(mVU.prog.index);
 }
 
 // Clears Block Data in specified range
 __fi void mVUclear(mV, u32 addr, u32 size) {
+	// The data is written after this, the lines are hashed again by the next search
+	addr &= mVU.microMemSize - 1;
+	const u32 end = std::min(addr + size, mVU.microMemSize);
+	for (u32 line = addr / 64; line * 64 < end; line++) {
+		mVU.prog.dirtyLines[line / 64] |= 1ULL << (line % 64);
+	}
+
 	if(!mVU.prog.cleared) {
 		mVU.prog.cleared = 1;		// Next execution searches/creates a new microprogram
 		memzero(mVU.prog.lpState); // Clear pipeline state
@@ -175,6 +191,7 @@ __ri void mVUdeleteProg(microVU& mVU, microProgram*& prog) {
 		safe_delete(prog->block[i]);
 	}
 	safe_delete(prog->ranges);
+	safe_delete(prog->entries);
 	safe_aligned_free(prog);
 }
 
@@ -184,6 +201,7 @@ __ri microProgram* mVUcreateProg(microVU& mVU, int startPC) {
 	memset(prog, 0, sizeof(microProgram));
 	prog->idx     = mVU.prog.total++;
 	prog->ranges  = new std::deque<microRange>();
+	prog->entries = new std::vector<microCacheEntry>();
 	prog->startPC = startPC;
 	mVUcacheProg(mVU, *prog); // Cache Micro Program
 	double cacheSize = (double)((uptr)mVU.prog.x86end - (uptr)mVU.prog.x86start);
@@ -200,6 +218,37 @@ __ri void mVUcacheProg(microVU& mVU, microProgram& prog) {
 	if (!mVU.index)	memcpy(prog.data, mVU.regs().Micro, 0x1000);
 	else			memcpy(prog.data, mVU.regs().Micro, 0x4000);
 	mVUdumpProg(mVU, prog);
+
+	// Index the program by the hash of its new data
+	if (prog.memHash) {
+		auto range = mVU.prog.index->equal_range(prog.memHash);
+		for (auto it = range.first; it != range.second; ++it) {
+			if (it->second == &prog) { mVU.prog.index->erase(it); break; }
+		}
+	}
+	mVUupdateHash(mVU);
+	prog.memHash = mVU.prog.memHash;
+	memcpy(prog.lineHash, mVU.prog.lineHash, sizeof(prog.lineHash));
+	mVU.prog.index->emplace(prog.memHash, &prog);
+}
+
+// Hashes the lines of the micro memory written since the last update
+__ri void mVUupdateHash(microVU& mVU) {
+	for (u32 line = 0; line < mVU.microMemSize / 64; line++) {
+		u64& dirty = mVU.prog.dirtyLines[line / 64];
+		if (!dirty) { line |= 63; continue; }
+		if (!(dirty & (1ULL << (line % 64)))) continue;
+		dirty &= ~(1ULL << (line % 64));
+
+		// FNV-1a over the u64s, seeded with the line so that the sum depends on the order
+		const u64* data = (u64*)(mVU.regs().Micro + line * 64);
+		u64 hash = 0xcbf29ce484222325ULL ^ line;
+		for (int i = 0; i < 8; i++) {
+			hash = (hash ^ data[i]) * 0x100000001b3ULL;
+		}
+		mVU.prog.memHash += hash - mVU.prog.lineHash[line];
+		mVU.prog.lineHash[line] = hash;
+	}
 }
 
 // Generate Hash for partial program based on compiled ranges...
@@ -250,6 +299,11 @@ __fi bool mVUcmpProg(microVU& mVU, microProgram& prog, const bool cmpWholeProg)
 		for (const auto& range : *prog.ranges) {
 			auto cmpOffset = [&](void* x) { return (u8*)x + range.start; };
 			if ((range.start < 0) || (range.end < 0)) { DevCon.Error("microVU%d: Negative Range![%d][%d]", mVU.index, range.start, range.end); }
+			// Different hashes of the lines inside of the range are a mismatch for sure
+			for (int line = (range.start + 63) / 64; line < (range.end + 8) / 64; line++) {
+				if (prog.lineHash[line] != mVU.prog.lineHash[line])
+					return false;
+			}
 			if (memcmp_mmx(cmpOffset(prog.data), cmpOffset(mVU.regs().Micro), ((range.end + 8) - range.start))) {
 				return false;
 			}
@@ -268,6 +322,21 @@ _mVUt __fi void* mVUsearchProg(u32 startPC, uptr pState) {
 	microProgramList* list = mVU.prog.prog[mVU.regs().start_pc / 8];
 
 	if(!quick.prog) { // If null, we need to search for new program
+		mVUupdateHash(mVU);
+
+		// A program compiled from the same micro memory, only compared when the hashes match
+		auto range = mVU.prog.index->equal_range(mVU.prog.memHash);
+		for (auto hit = range.first; hit != range.second; ++hit) {
+			microProgram* prog = hit->second;
+			if (prog->startPC != mVU.regs().start_pc / 8 || !mVUcmpProg(mVU, *prog, 1)) continue;
+			quick.block = prog->block[startPC/8];
+			quick.prog  = prog;
+			prog->used  = true;
+			list->erase(std::find(list->begin(), list->end(), prog));
+			list->push_front(prog);
+			return mVUentryGet(mVU, quick.block, startPC, pState);
+		}
+
 		std::deque<microProgram*>::iterator it(list->begin());
 		for ( ; it != list->end(); ++it) {
 			bool b = mVUcmpProg(mVU, *it[0], 0);
@@ -293,6 +362,7 @@ _mVUt __fi void* mVUsearchProg(u32 startPC, uptr pState) {
 			if (b) {
 				quick.block = it[0]->block[startPC/8];
 				quick.prog  = it[0];
+				quick.prog->used = true;
 				list->erase(it);
 				list->push_front(quick.prog);
 				return mVUentryGet(mVU, quick.block, startPC, pState);
@@ -303,6 +373,7 @@ _mVUt __fi void* mVUsearchProg(u32 startPC, uptr pState) {
 		mVU.prog.cleared	= 0;
 		mVU.prog.isSame		= 1;
 		mVU.prog.cur		= mVUcreateProg(mVU, mVU.regs().start_pc / 8);
+		mVU.prog.cur->used	= true;
 		void* entryPoint	= mVUblockFetch(mVU,  startPC, pState);
 		quick.block			= mVU.prog.cur->block[startPC/8];
 		quick.prog			= mVU.prog.cur;
@@ -21,6 +21,7 @@ class AsciiFile;
 using namespace x86Emitter;
 
 #include <deque>
+#include <unordered_map>
 #include <algorithm>
 #include <memory>
 #include "Common.h"
@@ -34,6 +35,7 @@ using namespace x86Emitter;
 #include "x86emitter/x86emitter.h"
 #include "microVU_Misc.h"
 #include "microVU_IR.h"
+#include "microVU_Cache.h"
 #include "microVU_Profiler.h"
 #include "Utilities/Perf.h"
 
@@ -143,15 +145,21 @@ struct microRange {
 };
 
 #define mProgSize (0x4000/4)
+#define mProgLines (0x4000/64) // 64 byte lines of the micro memory, hashed separately
 struct microProgram {
 	u32				   data [mProgSize];   // Holds a copy of the VU microProgram
 	microBlockManager* block[mProgSize/2]; // Array of Block Managers
 	std::deque<microRange>* ranges;			   // The ranges of the microProgram that have already been recompiled
 	u32 startPC; // Start PC of this program
 	int idx;	 // Program index
+	u64 memHash;				// Hash of data (see mVUupdateHash)
+	u64 lineHash[mProgLines];	// Hash of each line of data
+	std::vector<microCacheEntry>* entries; // Blocks compiled since the program was merged to the cache
+	bool used;					// Run since the program was merged to the cache
 };
 
 typedef std::deque<microProgram*> microProgramList;
+typedef std::unordered_multimap<u64, microProgram*> microProgramIndex;
 
 struct microProgramQuick {
 	microBlockManager*    block; // Quick reference to valid microBlockManager for current startPC
@@ -162,6 +170,10 @@ struct microProgManager {
 	microIR<mProgSize>	IRinfo;				// IR information
 	microProgramList*	prog [mProgSize/2];	// List of microPrograms indexed by startPC values
 	microProgramQuick	quick[mProgSize/2];	// Quick reference to valid microPrograms for current execution
+	microProgramIndex*	index;				// All the microPrograms by their memHash
+	u64					lineHash[mProgLines];	// Hash of each line of mVU.regs().Micro
+	u64					dirtyLines[mProgLines/64];	// Lines written since they were hashed (see mVUclear)
+	u64					memHash;			// Hash of mVU.regs().Micro, up to date when dirtyLines is empty
 	microProgram*		cur;				// Pointer to currently running MicroProgram
 	int					total;				// Total Number of valid MicroPrograms
 	int					isSame;				// Current cached microProgram is Exact Same program as mVU.regs().Micro (-1 = unknown, 0 = No, 1 = Yes)
@@ -197,6 +209,7 @@ struct microVU {
 	microProgManager				prog;		// Micro Program Data
 	microProfiler					profiler;   // Opcode Profiler
 	std::unique_ptr<microRegAlloc>	regAlloc;	// Reg Alloc Class
+	std::unique_ptr<microProgCache>	progCache;	// Programs kept across runs
 	std::unique_ptr<AsciiFile>		logFile;	// Log File Pointer
 
 	RecompiledCodeReserve* cache_reserve;
@@ -249,6 +262,12 @@ mVUop(mVUopL);
 
 // Private Functions
 extern void  mVUcacheProg (microVU& mVU, microProgram&  prog);
+extern void  mVUupdateHash(microVU& mVU);
+extern microProgram* mVUcreateProg(microVU& mVU, int startPC);
+extern void  mVUcacheRecord(microVU& mVU, u32 startPC, uptr pState);
+extern void  mVUcacheMerge(microVU& mVU);
+extern void  mVUcacheFlush(microVU& mVU);
+extern void  mVUcacheUpdate(microVU& mVU);
 extern void  mVUdeleteProg(microVU& mVU, microProgram*& prog);
 _mVUt extern void* mVUsearchProg(u32 startPC, uptr pState);
 extern void* __fastcall mVUexecuteVU0(u32 startPC, u32 cycles);
@@ -280,5 +299,6 @@ void sortVector(T& v) {
 #include "microVU_Flags.inl"
 #include "microVU_Branch.inl"
 #include "microVU_Compile.inl"
+#include "microVU_Cache.inl"
 #include "microVU_Execute.inl"
 #include "microVU_Macro.inl"
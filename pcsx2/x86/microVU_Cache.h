@@ -0,0 +1,77 @@
+/*  PCSX2 - PS2 Emulator for PCs
+ *  Copyright (C) 2002-2020  PCSX2 Dev Team
+ *
+ *  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with PCSX2.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+// A block the program compiled: its start pc and the pipeline state it was compiled for.
+struct __aligned16 microCacheEntry {
+	microRegInfo state;
+	u32 pc;				// in bytes
+	u32 pad[3];
+};
+
+struct microCachedProg {
+	u32 startPC;		// as microProgram::startPC
+	u32 lastUse;		// microProgCache::m_clock when the program last ran
+	std::vector<u32> data;
+	std::vector<microCacheEntry> entries;
+};
+
+// --------------------------------------------------------------------------------------
+//  microProgCache
+// --------------------------------------------------------------------------------------
+// The microPrograms of the running game kept across runs, saved in the cache folder as
+// mvu<index>_<ElfCRC>.bin.  The x86 code references the microBlocks on the heap, so it isn't
+// saved: a program is its micro memory and the entries of the blocks which were compiled,
+// and when the file is loaded they are compiled again before the VU runs anything (see
+// mVUcacheReplay), instead of the first time each scene uses them.
+//
+// The entries don't depend on the build or the settings, a block compiled for a pipeline
+// state which never comes back is only wasted space.
+//
+// The programs which ran most recently come first in the file and in the replay, and they
+// replace the oldest ones once MaxPrograms are kept.  The replay only fills half of the
+// code cache, so that the VU doesn't reset it as soon as it runs.
+//
+class microProgCache {
+public:
+	static const u32 MaxPrograms = 512;
+
+protected:
+	std::unordered_map<u64, microCachedProg> m_progs; // by the hash of the data and startPC
+	u32 m_clock;	// incremented by each merge of a program which ran
+	u32 m_index;
+	u32 m_crc;
+	bool m_modified;
+
+public:
+	bool replay; // the loaded programs haven't been compiled yet
+
+	microProgCache(u32 index)
+		: m_clock(0), m_index(index), m_crc(0), m_modified(false), replay(false) {}
+
+	void Reset(u32 crc);
+	bool Load();
+	bool Save();
+
+	void Merge(u64 hash, u32 startPC, const u32* data, u32 size, bool used, std::vector<microCacheEntry>& entries);
+
+	u32 GetCRC() const { return m_crc; }
+	bool IsModified() const { return m_modified; }
+	std::vector<const microCachedProg*> GetRecentPrograms() const;
+};
@@ -0,0 +1,273 @@
+/*  PCSX2 - PS2 Emulator for PCs
+ *  Copyright (C) 2002-2020  PCSX2 Dev Team
+ *
+ *  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with PCSX2.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "AppConfig.h"
+#include "Elfheader.h"
+#include "RecBlockCache.h"
+#include <wx/ffile.h>
+#include <algorithm>
+
+//------------------------------------------------------------------
+// Micro VU - Program Cache (see microProgCache)
+//------------------------------------------------------------------
+
+static const u32 mVUcacheMagic   = 0x4355564d; // "MVUC"
+static const u32 mVUcacheVersion = 1;
+
+struct microCacheHeader {
+	u32 magic;
+	u32 version;
+	u32 index;	// VU index
+	u32 count;	// programs
+};
+
+struct microCacheProgHeader {
+	u32 startPC;
+	u32 size;	// data, in u32's
+	u32 count;	// entries
+	u32 pad;
+};
+
+static wxString mVUcacheFilename(u32 index, u32 crc) {
+	wxDirName folder(GetSettingsFolder().Combine(wxDirName(L"cache")));
+	folder.Mkdir();
+	return Path::Combine(folder, wxsFormat(L"mvu%u_%08X.bin", index, crc));
+}
+
+void microProgCache::Reset(u32 crc) {
+	m_progs.clear();
+	m_clock = 0;
+	m_crc = crc;
+	m_modified = false;
+	replay = false;
+}
+
+bool microProgCache::Load() {
+	const wxString filename(mVUcacheFilename(m_index, m_crc));
+	if (!wxFileExists(filename)) return false;
+
+	wxFFile file(filename, L"rb");
+	microCacheHeader header;
+	if (!file.IsOpened() || file.Read(&header, sizeof(header)) != sizeof(header)) return false;
+	if (header.magic != mVUcacheMagic || header.version != mVUcacheVersion || header.index != m_index) {
+		Console.WriteLn(Color_Gray, L"microVU%d: Ignoring '%s', it was saved by another version.", m_index, WX_STR(filename));
+		return false;
+	}
+
+	u32 loaded = 0;
+	for (; loaded < header.count && loaded < MaxPrograms; loaded++) {
+		microCacheProgHeader ph;
+		if (file.Read(&ph, sizeof(ph)) != sizeof(ph)) break;
+		if (ph.size != (m_index ? 0x4000 : 0x1000) / 4 || ph.startPC >= ph.size / 2 || ph.count > ph.size / 2 * 8) break;
+
+		microCachedProg prog;
+		prog.startPC = ph.startPC;
+		prog.lastUse = header.count - loaded; // saved from the most recent
+		prog.data.resize(ph.size);
+		prog.entries.resize(ph.count);
+		if (file.Read(prog.data.data(), ph.size * 4) != ph.size * 4) break;
+		if (file.Read(prog.entries.data(), ph.count * sizeof(microCacheEntry)) != ph.count * sizeof(microCacheEntry)) break;
+
+		bool valid = true;
+		for (const microCacheEntry& entry : prog.entries) {
+			valid = valid && !(entry.pc & 7) && entry.pc < ph.size * 4;
+		}
+		if (!valid) break;
+
+		const u64 key = RecBlockCache::Hash(prog.data.data(), ph.size * 4, prog.startPC);
+		m_progs.emplace(key, std::move(prog));
+	}
+
+	m_clock = header.count;
+	if (loaded != header.count)
+		Console.Warning(L"microVU%d: '%s' is truncated or corrupted, %u of %u programs loaded.", m_index, WX_STR(filename), loaded, header.count);
+
+	m_modified = false;
+	replay = !m_progs.empty();
+	return true;
+}
+
+bool microProgCache::Save() {
+	const wxString filename(mVUcacheFilename(m_index, m_crc));
+	const wxString tempfile(filename + L".tmp");
+
+	{
+		wxFFile file(tempfile, L"wb");
+		if (!file.IsOpened()) return false;
+
+		microCacheHeader header = {mVUcacheMagic, mVUcacheVersion, m_index, (u32)m_progs.size()};
+		bool ok = file.Write(&header, sizeof(header)) == sizeof(header);
+
+		for (const microCachedProg* p : GetRecentPrograms()) {
+			const microCachedProg& prog = *p;
+			microCacheProgHeader ph = {prog.startPC, (u32)prog.data.size(), (u32)prog.entries.size(), 0};
+			ok = ok && file.Write(&ph, sizeof(ph)) == sizeof(ph);
+			ok = ok && file.Write(prog.data.data(), prog.data.size() * 4) == prog.data.size() * 4;
+			ok = ok && file.Write(prog.entries.data(), prog.entries.size() * sizeof(microCacheEntry)) == prog.entries.size() * sizeof(microCacheEntry);
+		}
+
+		if (!ok || !file.Close()) {
+			wxRemoveFile(tempfile);
+			return false;
+		}
+	}
+
+	if (!wxRenameFile(tempfile, filename, true)) return false;
+
+	m_modified = false;
+	return true;
+}
+
+// The programs, from the one which ran most recently
+std::vector<const microCachedProg*> microProgCache::GetRecentPrograms() const {
+	std::vector<const microCachedProg*> progs;
+	progs.reserve(m_progs.size());
+	for (const auto& i : m_progs)
+		progs.push_back(&i.second);
+	std::sort(progs.begin(), progs.end(), [](const microCachedProg* a, const microCachedProg* b) {
+		return a->lastUse > b->lastUse;
+	});
+	return progs;
+}
+
+// Adds the entries (then cleared) to the program compiled from the same data, and marks it
+// as the most recent when it ran.  The oldest program makes room for a new one.
+void microProgCache::Merge(u64 hash, u32 startPC, const u32* data, u32 size, bool used, std::vector<microCacheEntry>& entries) {
+	if (entries.empty() && !used) return;
+
+	auto it = m_progs.find(hash);
+	if (it == m_progs.end() || it->second.startPC != startPC || memcmp(it->second.data.data(), data, size * 4)) {
+		if (entries.empty()) return;
+		if (it == m_progs.end() && m_progs.size() >= MaxPrograms) {
+			auto oldest = std::min_element(m_progs.begin(), m_progs.end(), [](const auto& a, const auto& b) {
+				return a.second.lastUse < b.second.lastUse;
+			});
+			m_progs.erase(oldest);
+		}
+		microCachedProg& prog = m_progs[hash];
+		prog.startPC = startPC;
+		prog.data.assign(data, data + size);
+		prog.entries.clear();
+		it = m_progs.find(hash);
+	}
+
+	if (used && it->second.lastUse != m_clock) {
+		it->second.lastUse = ++m_clock;
+		m_modified = true;
+	}
+
+	std::vector<microCacheEntry>& cached = it->second.entries;
+	for (const microCacheEntry& entry : entries) {
+		bool found = false;
+		for (const microCacheEntry& c : cached) {
+			if (c.pc == entry.pc && !memcmp(&c.state, &entry.state, sizeof(microRegInfo))) { found = true; break; }
+		}
+		if (!found) {
+			cached.push_back(entry);
+			m_modified = true;
+		}
+	}
+	entries.clear();
+}
+
+// Records a block which is going to be compiled for the current program
+__fi void mVUcacheRecord(microVU& mVU, u32 startPC, uptr pState) {
+	if (!mVU.progCache->GetCRC() || !mVU.prog.cur) return;
+	mVU.prog.cur->entries->emplace_back();
+	microCacheEntry& entry = mVU.prog.cur->entries->back();
+	memcpy(&entry.state, (void*)pState, sizeof(microRegInfo));
+	entry.pc = startPC;
+}
+
+// Moves the entries of the live programs to the cache
+void mVUcacheMerge(microVU& mVU) {
+	if (!mVU.progCache->GetCRC()) return;
+	for (u32 i = 0; i < (mVU.progSize / 2); i++) {
+		if (!mVU.prog.prog[i]) continue;
+		for (microProgram* prog : *mVU.prog.prog[i]) {
+			const u64 key = RecBlockCache::Hash(prog->data, mVU.microMemSize, prog->startPC);
+			mVU.progCache->Merge(key, prog->startPC, prog->data, mVU.progSize, prog->used, *prog->entries);
+			prog->used = false;
+		}
+	}
+}
+
+void mVUcacheFlush(microVU& mVU) {
+	mVUcacheMerge(mVU);
+	if (!mVU.progCache->GetCRC() || !mVU.progCache->IsModified()) return;
+	if (!mVU.progCache->Save())
+		Console.Warning("microVU%d: Could not save the program cache of %08X.", mVU.index, mVU.progCache->GetCRC());
+}
+
+// Compiles the blocks of the loaded programs, with the micro memory of each one, the most
+// recent first and up to half of the code cache
+void mVUcacheReplay(microVU& mVU) {
+	mVU.progCache->replay = false;
+
+	std::vector<u8> micro(mVU.regs().Micro, mVU.regs().Micro + mVU.microMemSize);
+	microRegInfo lpState;
+	memcpy(&lpState, &mVU.prog.lpState, sizeof(lpState)); // changed by mVUinitFirstPass
+
+	u8* limit = mVU.prog.x86start + (mVU.prog.x86end - mVU.prog.x86start) / 2;
+	u32 progs = 0, blocks = 0;
+	for (const microCachedProg* p : mVU.progCache->GetRecentPrograms()) {
+		const microCachedProg& cached = *p;
+		if (xGetPtr() >= limit) break;
+
+		memcpy(mVU.regs().Micro, cached.data.data(), mVU.microMemSize);
+		memset(mVU.prog.dirtyLines, 0xff, sizeof(mVU.prog.dirtyLines));
+
+		mVU.prog.cleared = 0;
+		mVU.prog.isSame  = 1;
+		mVU.prog.cur     = mVUcreateProg(mVU, cached.startPC);
+		mVU.prog.prog[cached.startPC]->push_front(mVU.prog.cur);
+
+		for (const microCacheEntry& entry : cached.entries) {
+			if (xGetPtr() >= limit) break;
+			mVUblockFetch(mVU, entry.pc, (uptr)&entry.state);
+			blocks++;
+		}
+		mVU.prog.cur->entries->clear(); // already in the cache
+		progs++;
+	}
+
+	memcpy(mVU.regs().Micro, micro.data(), mVU.microMemSize);
+	memset(mVU.prog.dirtyLines, 0xff, sizeof(mVU.prog.dirtyLines));
+	memcpy(&mVU.prog.lpState, &lpState, sizeof(lpState));
+
+	mVU.prog.cleared = 1;
+	mVU.prog.isSame  = -1;
+	mVU.prog.cur     = NULL;
+	for (u32 i = 0; i < (mVU.progSize / 2); i++) {
+		mVU.prog.quick[i].block = NULL;
+		mVU.prog.quick[i].prog  = NULL;
+	}
+
+	Console.WriteLn(mVU.index ? Color_Orange : Color_Magenta, "microVU%d: Compiled %u cached programs (%u blocks).", mVU.index, progs, blocks);
+}
+
+// Called before the VU runs, the x86 ptr is where the next program is compiled
+void mVUcacheUpdate(microVU& mVU) {
+	if (ElfCRC != mVU.progCache->GetCRC() && (ElfCRC == 0 || EmuConfig.Cpu.Recompiler.EnableVUProgramCache)) {
+		mVUcacheFlush(mVU);
+		mVU.progCache->Reset(EmuConfig.Cpu.Recompiler.EnableVUProgramCache ? ElfCRC : 0);
+		if (mVU.progCache->GetCRC() && mVU.progCache->Load())
+			Console.WriteLn(Color_StrongBlack, "microVU%d: Loaded the program cache of %08X.", mVU.index, mVU.progCache->GetCRC());
+	}
+
+	if (mVU.progCache->replay) mVUcacheReplay(mVU);
+}
@@ -33,7 +33,9 @@ static void __fc mVUprintPC2(u32 pc)			{ Console.WriteLn("Block End PC   = 0x%04
 // Used by mVUsetupRange
 __fi void mVUcheckIsSame(mV) {
 	if (mVU.prog.isSame == -1) {
-		mVU.prog.isSame = !memcmp_mmx((u8*)mVUcurProg.data, mVU.regs().Micro, mVU.microMemSize);
+		mVUupdateHash(mVU);
+		mVU.prog.isSame = mVUcurProg.memHash == mVU.prog.memHash &&
+		                  !memcmp_mmx((u8*)mVUcurProg.data, mVU.regs().Micro, mVU.microMemSize);
 	}
 	if (mVU.prog.isSame == 0) {
 		mVUcacheProg(mVU, *mVU.prog.cur);
@@ -758,7 +760,7 @@ perf_and_return:
 __fi void* mVUentryGet(microVU& mVU, microBlockManager* block, u32 startPC, uptr pState) {
 	microBlock* pBlock = block->search((microRegInfo*)pState);
 	if (pBlock) return pBlock->x86ptrStart;
-	else	 {  return mVUcompile(mVU, startPC, pState);}
+	else	 {  mVUcacheRecord(mVU, startPC, pState); return mVUcompile(mVU, startPC, pState);}
 }
 
  // Search for Existing Compiled Block (if found, return x86ptr; else, compile and return x86ptr)
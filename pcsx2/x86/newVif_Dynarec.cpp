@@ -63,8 +63,10 @@ VifUnpackSSE_Dynarec::VifUnpackSSE_Dynarec(const nVifStruct& vif_, const nVifBlo
 	usn			= (vB.upkType>>5) & 1;
 	doMask		= (vB.upkType>>4) & 1;
 	doMode		= vB.mode & 3;
-	IsAligned   = vB.aligned;
+	IsAligned   = vB.aligned & 0x7f;
 	vCL			= 0;
+	dstOdd		= vB.aligned >> 7;
+	usedYMM		= false;
 }
 
 __fi void makeMergeMask(u32& x)
@@ -154,6 +156,33 @@ void VifUnpackSSE_Dynarec::writeBackRow() const {
 	// ToDo: Do we need to write back to vifregs.rX too!? :/
 }
 
+// With AVX2 the unmasked V4-32/V4-16/V4-8 unpacks are done two quadwords at a time, when
+// the output is contiguous in VU memory and the store doesn't cross a 32 byte boundary.
+// (V3-32 needs an insert and a mask for the W fields, it isn't faster than two SSE loads)
+bool VifUnpackSSE_Dynarec::IsWideUnpack(int upknum) {
+	return x86caps.hasAVX2 && (upknum >= 12) && (upknum <= 14);
+}
+
+void VifUnpackSSE_Dynarec::xUnpackWide(int upknum) const {
+	const xRegisterYMM destYMM(destReg.Id);
+
+	switch (upknum) {
+		case 12:
+			xVMOVDQU(destYMM, ptr[srcIndirect]);
+			break;
+		case 13:
+			if (usn)	xVPMOVZX.WD(destYMM, ptr[srcIndirect]);
+			else		xVPMOVSX.WD(destYMM, ptr[srcIndirect]);
+			break;
+		case 14:
+			if (usn)	xVPMOVZX.BD(destYMM, ptr[srcIndirect]);
+			else		xVPMOVSX.BD(destYMM, ptr[srcIndirect]);
+			break;
+	}
+	// VU memory is page aligned, dstOdd keeps the wide stores on 32 byte boundaries
+	xVMOVDQA(ptr[dstIndirect], destYMM);
+}
+
 static void ShiftDisplacementWindow( xAddressVoid& addr, const xRegisterLong& modReg )
 {
 	// Shifts the displacement factor of a given indirect address, so that the address
@@ -207,6 +236,7 @@ void VifUnpackSSE_Dynarec::CompileRoutine() {
 	const int  cycleSize = isFill ? vB.cl : wl;
 	const int  blockSize = isFill ? wl : vB.cl;
 	const int  skipSize	 = blockSize - cycleSize;
+	const bool contiguous = !isFill && !skipSize; // cl == wl
 
 	uint vNum	= vB.num ? vB.num : 256;
 	doMode		= (upkNum == 0xf) ? 0 : doMode;		// V4_5 has no mode feature.
@@ -215,6 +245,8 @@ void VifUnpackSSE_Dynarec::CompileRoutine() {
 
 	pxAssume(vCL == 0);
 
+	const bool wideUnpack = !isFill && IsUnmaskedOp() && IsWideUnpack(upkNum);
+
 	// Value passed determines # of col regs we need to load
 	SetMasks(isFill ? blockSize : cycleSize);
 
@@ -227,7 +259,18 @@ void VifUnpackSSE_Dynarec::CompileRoutine() {
 			ShiftDisplacementWindow( srcIndirect, arg2reg ); //Don't need to do this otherwise as we arent reading the source.
 
 
-		if (vCL < cycleSize) {
+		if (!dstOdd && vNum >= 2 && (vCL + 1 < cycleSize || contiguous) && wideUnpack) {
+			xUnpackWide(upkNum);
+			usedYMM = true;
+
+			dstIndirect += 32;
+			srcIndirect += vift * 2;
+
+			vNum -= 2;
+			vCL   = (vCL + 2) % blockSize;
+		}
+		else if (vCL < cycleSize) {
+			if (usedYMM) { xVZEROUPPER(); usedYMM = false; }
 			ModUnpack(upkNum, false);
 			xUnpack(upkNum);
 			xMovDest();
@@ -236,6 +279,7 @@ void VifUnpackSSE_Dynarec::CompileRoutine() {
 
 			dstIndirect += 16;
 			srcIndirect += vift;
+			dstOdd ^= 1;
 
 			vNum--;
 			if (++vCL == blockSize) vCL = 0;
@@ -247,17 +291,20 @@ void VifUnpackSSE_Dynarec::CompileRoutine() {
 			xMovDest();
 
 			dstIndirect += 16;
+			dstOdd ^= 1;
 
 			vNum--;
 			if (++vCL == blockSize) vCL = 0;
 		}
 		else {
 			dstIndirect += (16 * skipSize);
+			dstOdd ^= skipSize & 1;
 			vCL = 0;
 		}
 	}
 
 	if (doMode>=2) writeBackRow();
+	if (usedYMM) xVZEROUPPER();
 	xRET();
 }
 
@@ -322,6 +369,11 @@ _vifT __fi void dVifUnpack(const u8* data, bool isFill) {
 	if ((upkType & 0xf) != 9)
 		key1 &= 0xFFFF01FF;
 
+	// The AVX2 unpacks depend on the 32 byte alignment of the destination, the bit 7 of
+	// the 'aligned' field tells if it starts on an odd quadword.
+	if (!doMask && !(vifRegs.mode & 3) && VifUnpackSSE_Dynarec::IsWideUnpack(upkType & 0xf))
+		key1 |= (vif.tag.addr & 0x10) << 11;
+
 	// Zero out the mask parameter if it's unused -- games leave random junk
 	// values here which cause false recblock cache misses.
 	u32 key0 = doMask ? vifRegs.mask : 0;
@@ -27,7 +27,7 @@ union nVifBlock {
 		u16 length; 	// [02] Extra: pre computed Length
 		u32 mask;		// [04] Mask Field
 		u8 mode;		// [08] Mode Field
-		u8 aligned; 	// [09] Packet Alignment
+		u8 aligned; 	// [09] Packet Alignment (bit 7: odd destination quadword, see dVifUnpack)
 		u8 cl;			// [10] CL Field
 		u8 wl;			// [11] WL Field
 		uptr startPtr;	// [12] Start Ptr of RecGen Code
@@ -113,6 +113,8 @@ protected:
 	const nVifStruct&	v;			// vif0 or vif1
 	const nVifBlock&	vB;			// some pre-collected data from VifStruct
 	int					vCL;		// internal copy of vif->cl
+	int					dstOdd;		// the destination is 16 bytes past a 32 byte boundary
+	bool				usedYMM;	// the block has 256 bit unpacks (AVX2)
 
 public:
 	VifUnpackSSE_Dynarec(const nVifStruct& vif_, const nVifBlock& vifBlock_);
@@ -123,6 +125,8 @@ public:
 	{
 		isFill	= src.isFill;
 		vCL		= src.vCL;
+		dstOdd	= src.dstOdd;
+		usedYMM	= src.usedYMM;
 	}
 
 	virtual ~VifUnpackSSE_Dynarec() = default;
@@ -131,12 +135,15 @@ public:
 
 	void ModUnpack( int upknum, bool PostOp );
 	void CompileRoutine();
+
+	static bool IsWideUnpack(int upknum);
 	
 
 protected:
 	virtual void doMaskWrite(const xRegisterSSE& regX) const;
 	void SetMasks(int cS) const;
 	void writeBackRow() const;
+	void xUnpackWide(int upknum) const;
 
 	static VifUnpackSSE_Dynarec FillingWrite( const VifUnpackSSE_Dynarec& src )
 	{
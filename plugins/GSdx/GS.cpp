@@ -28,6 +28,7 @@
 #include "Renderers/OpenGL/GSDeviceOGL.h"
 #include "Renderers/OpenGL/GSRendererOGL.h"
 #include "GSLzma.h"
+#include <chrono>
 
 #ifdef _WIN32
 
@@ -63,6 +64,7 @@ static void (*s_irq)() = NULL;
 static uint8* s_basemem = NULL;
 static int s_vsync = 0;
 static bool s_exclusive = true;
+static bool s_headless = false; // GSReplayHeadless, no window and offscreen targets
 static std::string s_renderer_name;
 bool gsopen_done = false; // crash guard for GSgetTitleInfo2 and GSKeyEvent (replace with lock?)
 
@@ -232,6 +234,12 @@ static int _GSopen(void** dsp, const char* title, GSRendererType renderer, int t
 		{
 			// Select the window first to detect the GL requirement
 			std::vector<std::shared_ptr<GSWnd>> wnds;
+			if (s_headless)
+			{
+				wnds.push_back(std::make_shared<GSWndHeadless>());
+			}
+			else
+			{
 #ifdef __LIBRETRO__
 			switch (renderer)
 			{
@@ -278,6 +286,7 @@ static int _GSopen(void** dsp, const char* title, GSRendererType renderer, int t
 					break;
 			}
 #endif
+			}
 			int w = theApp.GetConfigI("ModeWidth");
 			int h = theApp.GetConfigI("ModeHeight");
 #if defined(__unix__)
@@ -340,7 +349,10 @@ static int _GSopen(void** dsp, const char* title, GSRendererType renderer, int t
 			renderer_name = "OpenGL";
 			break;
 		case GSRendererType::OGL_SW:
-			dev = new GSDeviceOGL();
+			if (s_headless)
+				dev = new GSDeviceNull();
+			else
+				dev = new GSDeviceOGL();
 			s_renderer_name = "SW";
 			renderer_name = "Software";
 			break;
@@ -961,6 +973,49 @@ EXPORT_C GSsetExclusive(int enabled)
 	}
 }
 
+// Replays a batch of packets read by GSDumpReader, frame is called after each vsync.
+template<class T> static void GSReplayBatch(GSDumpReader::Batch* batch, uint8* regs, std::vector<uint8>& buff, T frame)
+{
+	for(size_t offset = 0; offset < batch->data.size();)
+	{
+		const GSDumpPacket& p = *(const GSDumpPacket*)&batch->data[offset];
+		uint8* data = &batch->data[offset + sizeof(p)];
+		offset = p.next;
+
+		switch(p.type)
+		{
+			case 0:
+				switch(p.param)
+				{
+					case 0:
+						// path 1 reads from the end of the VU1 memory
+						if(buff.size() < 0x4000) buff.resize(0x4000);
+						memcpy(&buff[0x4000 - p.size], data, p.size);
+						GSgifTransfer1(&buff[0], 0x4000 - p.size);
+						break;
+					case 1: GSgifTransfer2(data, p.size / 16); break;
+					case 2: GSgifTransfer3(data, p.size / 16); break;
+					case 3: GSgifTransfer(data, p.size / 16); break;
+				}
+				break;
+
+			case 1:
+				GSvsync(p.param);
+				frame();
+				break;
+
+			case 2:
+				if(buff.size() < p.size) buff.resize(p.size);
+				GSreadFIFO2(&buff[0], p.size / 16);
+				break;
+
+			case 3:
+				memcpy(regs, data, 0x2000);
+				break;
+		}
+	}
+}
+
 #ifdef _WIN32
 
 #include <io.h>
@@ -1053,13 +1108,6 @@ EXPORT_C GSReplay(HWND hwnd, HINSTANCE hinst, LPSTR lpszCmdLine, int nCmdShow)
 
 	Console console{"GSdx", true};
 
-	const std::string f{lpszCmdLine};
-	const bool is_xz = f.size() >= 4 && f.compare(f.size() - 3, 3, ".xz") == 0;
-
-	auto file = is_xz
-		? std::unique_ptr<GSDumpFile>{std::make_unique<GSDumpLzma>(lpszCmdLine, nullptr)}
-		: std::unique_ptr<GSDumpFile>{std::make_unique<GSDumpRaw>(lpszCmdLine, nullptr)};
-
 	GSinit();
 
 	std::array<uint8, 0x2000> regs;
@@ -1071,97 +1119,35 @@ EXPORT_C GSReplay(HWND hwnd, HINSTANCE hinst, LPSTR lpszCmdLine, int nCmdShow)
 
 	_GSopen((void**)&hWnd, "", renderer);
 
-	uint32 crc;
-	file->Read(&crc, 4);
-	GSsetGameCRC(crc, 0);
+	GSDumpReader reader(lpszCmdLine, nullptr, (size_t)theApp.GetConfigI("replay_cache_size") << 20);
+	if(!reader.Open())
+	{
+		fprintf(stderr, "Failed to read %s\n", lpszCmdLine);
+		GSclose();
+		GSshutdown();
+		return;
+	}
+
+	GSsetGameCRC(reader.GetCRC(), 0);
 
 	{
 		GSFreezeData fd;
-		file->Read(&fd.size, 4);
-		std::vector<uint8> freeze_data(fd.size);
-		fd.data = freeze_data.data();
-		file->Read(fd.data, fd.size);
+		fd.size = reader.GetState().size();
+		fd.data = reader.GetState().data();
 		GSfreeze(FREEZE_LOAD, &fd);
 	}
 
-	file->Read(regs.data(), 0x2000);
+	memcpy(regs.data(), reader.GetRegs(), 0x2000);
 
 	GSvsync(1);
 
-	struct Packet {uint8 type, param; uint32 size, addr; std::vector<uint8> buff;};
-
-	auto read_packet = [&file](uint8 type) {
-		Packet p;
-		p.type = type;
-
-		switch(p.type) {
-		case 0:
-			file->Read(&p.param, 1);
-			file->Read(&p.size, 4);
-			switch(p.param) {
-			case 0:
-				p.buff.resize(0x4000);
-				p.addr = 0x4000 - p.size;
-				file->Read(&p.buff[p.addr], p.size);
-				break;
-			case 1:
-			case 2:
-			case 3:
-				p.buff.resize(p.size);
-				file->Read(p.buff.data(), p.size);
-				break;
-			}
-			break;
-		case 1:
-			file->Read(&p.param, 1);
-			break;
-		case 2:
-			file->Read(&p.size, 4);
-			break;
-		case 3:
-			p.buff.resize(0x2000);
-			file->Read(p.buff.data(), 0x2000);
-			break;
-		}
-
-		return p;
-	};
-
-	std::list<Packet> packets;
-	uint8 type;
-	while(file->Read(&type, 1))
-		packets.push_back(read_packet(type));
-
-	Sleep(100);
-
 	std::vector<uint8> buff;
 	while(IsWindowVisible(hWnd))
 	{
-		for(auto &p : packets)
-		{
-			switch(p.type)
-			{
-			case 0:
-				switch(p.param)
-				{
-				case 0: GSgifTransfer1(p.buff.data(), p.addr); break;
-				case 1: GSgifTransfer2(p.buff.data(), p.size / 16); break;
-				case 2: GSgifTransfer3(p.buff.data(), p.size / 16); break;
-				case 3: GSgifTransfer(p.buff.data(), p.size / 16); break;
-				}
-				break;
-			case 1:
-				GSvsync(p.param);
-				break;
-			case 2:
-				if(buff.size() < p.size) buff.resize(p.size);
-				GSreadFIFO2(p.buff.data(), p.size / 16);
-				break;
-			case 3:
-				memcpy(regs.data(), p.buff.data(), 0x2000);
-				break;
-			}
-		}
+		while(GSDumpReader::Batch* batch = reader.Next())
+			GSReplayBatch(batch, regs.data(), buff, []() {});
+
+		reader.Rewind();
 	}
 
 	Sleep(100);
@@ -1403,9 +1389,6 @@ EXPORT_C GSReplay(char* lpszCmdLine, int renderer)
 		return;
 	}
 
-	struct Packet {uint8 type, param; uint32 size, addr; std::vector<uint8> buff;};
-
-	std::list<Packet*> packets;
 	std::vector<uint8> buff;
 	uint8 regs[0x2000];
 
@@ -1430,140 +1413,49 @@ EXPORT_C GSReplay(char* lpszCmdLine, int renderer)
 	}
 	if (s_gs->m_wnd == NULL) return;
 
-	{ // Read .gs content
-		std::string f(lpszCmdLine);
-		bool is_xz = (f.size() >= 4) && (f.compare(f.size()-3, 3, ".xz") == 0);
-		if (is_xz)
-			f.replace(f.end()-6, f.end(), "_repack.gs");
-		else
-			f.replace(f.end()-3, f.end(), "_repack.gs");
-
-		GSDumpFile* file = is_xz
-			? (GSDumpFile*) new GSDumpLzma(lpszCmdLine, repack_dump ? f.c_str() : nullptr)
-			: (GSDumpFile*) new GSDumpRaw(lpszCmdLine, repack_dump ? f.c_str() : nullptr);
-
-		uint32 crc;
-		file->Read(&crc, 4);
-		GSsetGameCRC(crc, 0);
-
-		GSFreezeData fd;
-		file->Read(&fd.size, 4);
-		fd.data = new uint8[fd.size];
-		file->Read(fd.data, fd.size);
-
-		GSfreeze(FREEZE_LOAD, &fd);
-		delete [] fd.data;
-
-		file->Read(regs, 0x2000);
-
-		uint8 type;
-		while(file->Read(&type, 1))
-		{
-			Packet* p = new Packet();
-
-			p->type = type;
-
-			switch(type)
-			{
-			case 0:
-				file->Read(&p->param, 1);
-				file->Read(&p->size, 4);
-
-				switch(p->param)
-				{
-				case 0:
-					p->buff.resize(0x4000);
-					p->addr = 0x4000 - p->size;
-					file->Read(&p->buff[p->addr], p->size);
-					break;
-				case 1:
-				case 2:
-				case 3:
-					p->buff.resize(p->size);
-					file->Read(&p->buff[0], p->size);
-					break;
-				}
-
-				break;
-
-			case 1:
-				file->Read(&p->param, 1);
-				frame_number++;
-
-				break;
-
-			case 2:
-				file->Read(&p->size, 4);
-
-				break;
+	std::string f(lpszCmdLine);
+	bool is_xz = (f.size() >= 4) && (f.compare(f.size()-3, 3, ".xz") == 0);
+	if (is_xz)
+		f.replace(f.end()-6, f.end(), "_repack.gs");
+	else
+		f.replace(f.end()-3, f.end(), "_repack.gs");
 
-			case 3:
-				p->buff.resize(0x2000);
+	// The packets are read while they are replayed, the repack stops after -finished frames
+	GSDumpReader reader(lpszCmdLine, repack_dump ? f.c_str() : nullptr,
+		repack_dump ? 0 : (size_t)theApp.GetConfigI("replay_cache_size") << 20, repack_dump ? -finished : 0);
 
-				file->Read(&p->buff[0], 0x2000);
+	if (!reader.Open()) {
+		fprintf(stderr, "Failed to read %s\n", lpszCmdLine);
+		GSclose();
+		GSshutdown();
+		return;
+	}
 
-				break;
-			}
+	GSsetGameCRC(reader.GetCRC(), 0);
 
-			packets.push_back(p);
+	GSFreezeData fd;
+	fd.size = reader.GetState().size();
+	fd.data = reader.GetState().data();
+	GSfreeze(FREEZE_LOAD, &fd);
 
-			if (repack_dump && frame_number > -finished)
-				break;
-		}
+	memcpy(regs, reader.GetRegs(), 0x2000);
 
-		delete file;
+	if (repack_dump) {
+		while (reader.Next())
+			;
 	}
 
 	sleep(2);
 
-
-	frame_number = 0;
-
 	// Init vsync stuff
 	GSvsync(1);
 
 	while(finished > 0)
 	{
-		for(auto i = packets.begin(); i != packets.end(); i++)
-		{
-			Packet* p = *i;
-
-			switch(p->type)
-			{
-				case 0:
-
-					switch(p->param)
-					{
-						case 0: GSgifTransfer1(&p->buff[0], p->addr); break;
-						case 1: GSgifTransfer2(&p->buff[0], p->size / 16); break;
-						case 2: GSgifTransfer3(&p->buff[0], p->size / 16); break;
-						case 3: GSgifTransfer(&p->buff[0], p->size / 16); break;
-					}
-
-					break;
-
-				case 1:
-
-					GSvsync(p->param);
-					frame_number++;
-
-					break;
+		while(GSDumpReader::Batch* batch = reader.Next())
+			GSReplayBatch(batch, regs, buff, [&frame_number]() {frame_number++;});
 
-				case 2:
-
-					if(buff.size() < p->size) buff.resize(p->size);
-
-					GSreadFIFO2(&buff[0], p->size / 16);
-
-					break;
-
-				case 3:
-
-					memcpy(regs, &p->buff[0], 0x2000);
-
-					break;
-			}
-		}
+		reader.Rewind();
 
 		if (finished >= 200) {
 			; // Nop for Nvidia Profiler
@@ -1585,16 +1477,131 @@ EXPORT_C GSReplay(char* lpszCmdLine, int renderer)
 		   );
 #endif
 
-	for(auto i = packets.begin(); i != packets.end(); i++)
+	sleep(2);
+
+	GSclose();
+	GSshutdown();
+}
+
+// Replays a dump without a window, with the SW renderer drawing to offscreen targets or the
+// Null renderer, and writes the time and the GSPerfMon counters of each frame to csv (or
+// stdout). Used by linux_replay --headless as a renderer benchmark which doesn't need a GPU.
+//
+// gs_thread_cpu_ms is the CPU time of the GS thread only, the SW rasterizer threads aren't
+// counted.  The first loop also waits for the dump to be decompressed (GSDumpReader), its
+// wall_ms is reported apart in the summary, the following loops replay the cached batches
+// when they fit in replay_cache_size.
+EXPORT_C GSReplayHeadless(char* lpszCmdLine, const char* renderer_name, const char* csv, int loops)
+{
+	GSRendererType renderer;
+	if(strcmp(renderer_name, "sw") == 0)
+		renderer = GSRendererType::OGL_SW;
+	else if(strcmp(renderer_name, "null") == 0)
+		renderer = GSRendererType::Null;
+	else
 	{
-		delete *i;
+		fprintf(stderr, "Unknown headless renderer %s (sw or null)\n", renderer_name);
+		return;
 	}
 
-	packets.clear();
+	FILE* out = csv ? fopen(csv, "w") : stdout;
+	if(!out)
+	{
+		fprintf(stderr, "Failed to open %s\n", csv);
+		return;
+	}
 
-	sleep(2);
+	GSinit();
+
+	uint8 regs[0x2000];
+	GSsetBaseMem(regs);
+	s_vsync = 0;
+	s_headless = true;
+
+	void* hWnd = NULL;
+	GSDumpReader reader(lpszCmdLine, nullptr, (size_t)theApp.GetConfigI("replay_cache_size") << 20);
+
+	if(_GSopen((void**)&hWnd, "", renderer) != 0)
+		fprintf(stderr, "Error failed to GSopen\n");
+	else if(!reader.Open())
+		fprintf(stderr, "Failed to read %s\n", lpszCmdLine);
+	else
+	{
+		GSsetGameCRC(reader.GetCRC(), 0);
+
+		GSFreezeData fd;
+		fd.size = reader.GetState().size();
+		fd.data = reader.GetState().data();
+		GSfreeze(FREEZE_LOAD, &fd);
+
+		memcpy(regs, reader.GetRegs(), 0x2000);
+
+		static const GSPerfMon::counter_t counters[] = {
+			GSPerfMon::Prim, GSPerfMon::Draw, GSPerfMon::Swizzle, GSPerfMon::Unswizzle,
+			GSPerfMon::Fillrate, GSPerfMon::Quad, GSPerfMon::SyncPoint};
+		double last[countof(counters)] = {};
+
+		fprintf(out, "loop,frame,wall_ms,gs_thread_cpu_ms,prims,draws,swizzle,unswizzle,fillrate,quads,sync_points\n");
+
+		GSvsync(1);
+
+		const GSPerfMon& pm = s_gs->m_perfmon;
+		for(size_t i = 0; i < countof(counters); i++)
+			last[i] = pm.GetTotal(counters[i]);
+		uint64 last_frame_time = pm.GetFrameTime();
+
+		std::vector<uint8> buff;
+		double total_ms[2] = {}; // the first loop, the others
+		long frames[2] = {};
+
+		for(int loop = 0; loop < loops; loop++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			long frame = 0;
+			const int first = loop == 0 ? 0 : 1;
+
+			auto vsync = [&]()
+			{
+				auto now = std::chrono::steady_clock::now();
+				const double wall = std::chrono::duration<double, std::milli>(now - start).count();
+				start = now;
+				total_ms[first] += wall;
+
+				double delta[countof(counters)];
+				for(size_t i = 0; i < countof(counters); i++)
+				{
+					const double v = pm.GetTotal(counters[i]);
+					delta[i] = v - last[i];
+					last[i] = v;
+				}
+
+				const uint64 frame_time = pm.GetFrameTime();
+				const double cpu = (frame_time - last_frame_time) / 1000.0;
+				last_frame_time = frame_time;
+
+				fprintf(out, "%d,%ld,%.3f,%.3f,%.0f,%.0f,%.0f,%.0f,%.0f,%.0f,%.0f\n", loop, frame++, wall,
+					cpu, delta[0], delta[1], delta[2], delta[3], delta[4], delta[5], delta[6]);
+				frames[first]++;
+			};
+
+			while(GSDumpReader::Batch* batch = reader.Next())
+				GSReplayBatch(batch, regs, buff, vsync);
+
+			reader.Rewind();
+		}
+
+		fprintf(stderr, "%s: first loop (decoding the dump) %ld frames in %.1f ms, %.2f ms/frame\n", lpszCmdLine,
+			frames[0], total_ms[0], frames[0] ? total_ms[0] / frames[0] : 0.0);
+		if(loops > 1)
+			fprintf(stderr, "%s: next loops %ld frames in %.1f ms, %.2f ms/frame\n", lpszCmdLine,
+				frames[1], total_ms[1], frames[1] ? total_ms[1] / frames[1] : 0.0);
+	}
+
+	if(out != stdout)
+		fclose(out);
 
 	GSclose();
 	GSshutdown();
+	s_headless = false;
 }
 #endif
@@ -176,3 +176,259 @@ bool GSDumpRaw::Read(void* ptr, size_t size) {
 
 	return false;
 }
+
+/******************************************************************/
+
+GSDumpReader::GSDumpReader(const char* path, const char* repack_path, size_t cache_budget, int max_frames)
+	: m_path(path)
+	, m_repack_path(repack_path ? repack_path : "")
+	, m_max_frames(max_frames)
+	, m_cache_budget(cache_budget)
+	, m_live(0)
+	, m_current(nullptr)
+	, m_cache_size(0)
+	, m_cache_pos(0)
+	, m_caching(cache_budget > 0)
+	, m_cached(false)
+	, m_eof(false)
+	, m_exit(false)
+	, m_crc(0)
+{
+	memset(m_regs, 0, sizeof(m_regs));
+}
+
+GSDumpReader::~GSDumpReader() {
+	Stop();
+	Recycle(m_current);
+	DropCache();
+
+	for (Batch* batch : m_free)
+		delete batch;
+}
+
+// Opens the file and reads the header, then starts the worker.
+bool GSDumpReader::Open() {
+	const bool is_xz = m_path.size() >= 4 && m_path.compare(m_path.size() - 3, 3, ".xz") == 0;
+	const char* repack = m_repack_path.empty() ? nullptr : m_repack_path.c_str();
+
+	if (is_xz)
+		m_file.reset(new GSDumpLzma(&m_path[0], repack));
+	else
+		m_file.reset(new GSDumpRaw(&m_path[0], repack));
+
+	if (!ReadHeader())
+		return false;
+
+	Start();
+	return true;
+}
+
+bool GSDumpReader::ReadHeader() {
+	uint32 size;
+	if (!m_file->Read(&m_crc, 4) || !m_file->Read(&size, 4))
+		return false;
+
+	m_state.resize(size);
+	return m_file->Read(m_state.data(), size) && m_file->Read(m_regs, 0x2000);
+}
+
+// Appends the next packet of the file to the batch, returns false at the end of the dump.
+bool GSDumpReader::ReadPacket(Batch* batch, int& frames) {
+	uint8 type;
+	if (!m_file->Read(&type, 1))
+		return false;
+
+	GSDumpPacket p = {type, 0, 0, 0, 0, 0};
+	bool ok = true;
+
+	switch (type) {
+		case 0: ok = m_file->Read(&p.param, 1) && m_file->Read(&p.size, 4); break;
+		case 1: ok = m_file->Read(&p.param, 1); frames++; break;
+		case 2: ok = m_file->Read(&p.size, 4); break;
+		case 3: p.size = 0x2000; break;
+	}
+
+	if (!ok)
+		return false;
+
+	std::vector<uint8>& data = batch->data;
+	const size_t offset = data.size();
+	const size_t size = type == 2 ? 0 : p.size; // GSreadFIFO2 only has a size
+	p.next = (uint32)(offset + sizeof(p) + ((size + 15) & ~15));
+	data.resize(p.next);
+	memcpy(&data[offset], &p, sizeof(p));
+
+	if (size && !m_file->Read(&data[offset + sizeof(p)], size)) {
+		data.resize(offset);
+		return false;
+	}
+
+	return m_max_frames <= 0 || frames < m_max_frames;
+}
+
+void GSDumpReader::ThreadProc() {
+	int frames = 0;
+	bool eof = false;
+
+	while (!eof) {
+		Batch* batch;
+
+		{
+			std::unique_lock<std::mutex> l(m_lock);
+
+			while (!m_exit && m_free.empty() && m_live >= RingSize)
+				m_consumed.wait(l);
+
+			if (m_exit)
+				return;
+
+			if (m_free.empty()) {
+				batch = new Batch();
+				batch->data.reserve(BatchSize);
+				m_live++;
+			} else {
+				batch = m_free.back();
+				m_free.pop_back();
+			}
+		}
+
+		batch->data.clear();
+
+		try {
+			while (batch->data.size() < BatchSize && !eof)
+				eof = !ReadPacket(batch, frames);
+		} catch (...) {
+			fprintf(stderr, "Failed to read %s\n", m_path.c_str());
+			eof = true;
+		}
+
+		{
+			std::lock_guard<std::mutex> l(m_lock);
+
+			if (batch->data.empty())
+				m_free.push_back(batch);
+			else
+				m_ready.push_back(batch);
+
+			m_eof = eof;
+		}
+
+		m_produced.notify_one();
+	}
+}
+
+void GSDumpReader::Start() {
+	m_eof = false;
+	m_exit = false;
+	m_thread = std::thread(&GSDumpReader::ThreadProc, this);
+}
+
+void GSDumpReader::Stop() {
+	if (!m_thread.joinable())
+		return;
+
+	{
+		std::lock_guard<std::mutex> l(m_lock);
+		m_exit = true;
+	}
+	m_consumed.notify_one();
+
+	m_thread.join();
+
+	for (Batch* batch : m_ready)
+		m_free.push_back(batch);
+	m_ready.clear();
+}
+
+void GSDumpReader::Recycle(Batch* batch) {
+	if (batch == nullptr)
+		return;
+
+	{
+		std::lock_guard<std::mutex> l(m_lock);
+		m_free.push_back(batch);
+	}
+	m_consumed.notify_one();
+}
+
+void GSDumpReader::DropCache() {
+	for (Batch* batch : m_cache)
+		delete batch;
+
+	m_cache.clear();
+	m_cache_size = 0;
+	m_caching = false;
+	m_cached = false;
+}
+
+// Returns the next batch of packets, valid until the following call, or null at the end
+// of the dump.
+GSDumpReader::Batch* GSDumpReader::Next() {
+	if (m_cached)
+		return m_cache_pos < m_cache.size() ? m_cache[m_cache_pos++] : nullptr;
+
+	Batch* done = m_current;
+	m_current = nullptr;
+
+	if (done && m_caching) {
+		m_cache_size += done->data.capacity();
+
+		if (m_cache_size <= m_cache_budget) {
+			m_cache.push_back(done);
+			done = nullptr;
+
+			// The worker allocates another one in its place.
+			{
+				std::lock_guard<std::mutex> l(m_lock);
+				m_live--;
+			}
+			m_consumed.notify_one();
+		} else {
+			DropCache();
+		}
+	}
+
+	std::unique_lock<std::mutex> l(m_lock);
+
+	if (done) {
+		m_free.push_back(done);
+		m_consumed.notify_one();
+	}
+
+	while (m_ready.empty() && !m_eof)
+		m_produced.wait(l);
+
+	if (m_ready.empty()) {
+		if (m_caching) {
+			m_caching = false;
+			m_cached = true;
+			m_cache_pos = m_cache.size();
+		}
+		return nullptr;
+	}
+
+	m_current = m_ready.front();
+	m_ready.pop_front();
+	return m_current;
+}
+
+// Goes back to the first packet, decoding the file again if it isn't cached.
+void GSDumpReader::Rewind() {
+	if (m_cached) {
+		m_cache_pos = 0;
+		return;
+	}
+
+	Stop();
+	Recycle(m_current);
+	m_current = nullptr;
+	DropCache();
+
+	// Only the first pass writes the repack.
+	m_repack_path.clear();
+
+	if (!Open()) {
+		fprintf(stderr, "Failed to read %s\n", m_path.c_str());
+		m_eof = true;
+	}
+}
@@ -75,3 +75,75 @@ class GSDumpRaw : public GSDumpFile {
 	bool IsEof() final;
 	bool Read(void* ptr, size_t size) final;
 };
+
+// The packets of a dump, one after the other in a buffer. The data of each packet follows
+// its header, both aligned on 16 bytes like the GIF transfers want, and next is the offset
+// of the following packet.
+struct GSDumpPacket {uint8 type, param; uint16 pad; uint32 size; uint32 next; uint32 pad2;};
+
+// Reads a dump ahead of the replay on a worker thread (the LZMA decompression is most of
+// the cost of a replay) into a bounded ring of batches of packets, so that the replay
+// starts right away and the memory doesn't grow with the size of the dump.
+//
+// The batches of the first pass are kept while they fit in the cache budget, then Rewind
+// replays them from memory. A dump which doesn't fit is decoded again from the file.
+class GSDumpReader {
+	public:
+	struct Batch {
+		std::vector<uint8> data;
+	};
+
+	private:
+	static const size_t BatchSize = 4 * 1024 * 1024;
+	static const size_t RingSize  = 8;
+
+	std::string m_path;
+	std::string m_repack_path;
+	int         m_max_frames;
+	size_t      m_cache_budget;
+
+	std::unique_ptr<GSDumpFile> m_file;
+	std::thread m_thread;
+	std::mutex  m_lock;
+	std::condition_variable m_produced;
+	std::condition_variable m_consumed;
+
+	std::deque<Batch*>  m_ready;    // decoded, in the order of the dump
+	std::vector<Batch*> m_free;
+	size_t              m_live;     // batches of the ring, the cache excluded
+	Batch*              m_current;  // returned by Next
+
+	std::vector<Batch*> m_cache;
+	size_t m_cache_size;
+	size_t m_cache_pos;
+	bool   m_caching;   // the first pass is being cached
+	bool   m_cached;    // the whole dump is in m_cache
+
+	bool   m_eof;
+	bool   m_exit;
+
+	uint32 m_crc;
+	std::vector<uint8> m_state;
+	uint8  m_regs[0x2000];
+
+	bool ReadHeader();
+	bool ReadPacket(Batch* batch, int& frames);
+	void ThreadProc();
+	void Start();
+	void Stop();
+	void Recycle(Batch* batch);
+	void DropCache();
+
+	public:
+	// max_frames stops the reading after as many vsyncs, 0 reads the whole dump.
+	GSDumpReader(const char* path, const char* repack_path, size_t cache_budget, int max_frames = 0);
+	~GSDumpReader();
+
+	bool Open();
+	Batch* Next();
+	void Rewind();
+
+	uint32 GetCRC() const {return m_crc;}
+	std::vector<uint8>& GetState() {return m_state;}
+	const uint8* GetRegs() const {return m_regs;}
+};
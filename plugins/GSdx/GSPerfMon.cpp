@@ -23,12 +23,14 @@
 #include "GSPerfMon.h"
 
 GSPerfMon::GSPerfMon()
-	: m_frame(0)
+	: m_frame_time(0)
+	, m_frame(0)
 	, m_lastframe(0)
 	, m_count(0)
 {
 	memset(m_counters, 0, sizeof(m_counters));
 	memset(m_stats, 0, sizeof(m_stats));
+	memset(m_totals, 0, sizeof(m_totals));
 	memset(m_total, 0, sizeof(m_total));
 	memset(m_begin, 0, sizeof(m_begin));
 }
@@ -51,6 +53,8 @@ void GSPerfMon::Put(counter_t c, double val)
 		if(m_lastframe != 0)
 		{
 			m_counters[c] += (now - m_lastframe) * 1000 / CLOCKS_PER_SEC;
+			m_totals[c] += (now - m_lastframe) * 1000 / CLOCKS_PER_SEC;
+			m_frame_time += (uint64)(now - m_lastframe) * 1000000 / CLOCKS_PER_SEC;
 		}
 
 		m_lastframe = now;
@@ -60,6 +64,7 @@ void GSPerfMon::Put(counter_t c, double val)
 	else
 	{
 		m_counters[c] += val;
+		m_totals[c] += val;
 	}
 #endif
 }
@@ -30,6 +30,8 @@ public:
 		Sync, 
 		WorkerDraw0, WorkerDraw1, WorkerDraw2, WorkerDraw3, WorkerDraw4, WorkerDraw5, WorkerDraw6, WorkerDraw7, 
 		WorkerDraw8, WorkerDraw9, WorkerDraw10, WorkerDraw11, WorkerDraw12, WorkerDraw13, WorkerDraw14, WorkerDraw15, 
+		WorkerDraw16, WorkerDraw17, WorkerDraw18, WorkerDraw19, WorkerDraw20, WorkerDraw21, WorkerDraw22, WorkerDraw23, 
+		WorkerDraw24, WorkerDraw25, WorkerDraw26, WorkerDraw27, WorkerDraw28, WorkerDraw29, WorkerDraw30, WorkerDraw31, 
 		TimerLast,
 	};
 	
@@ -42,6 +44,8 @@ public:
 protected:
 	double m_counters[CounterLast];
 	double m_stats[CounterLast];
+	double m_totals[CounterLast]; // not reset by Update, for the replay benchmark
+	uint64 m_frame_time; // total of the Frame intervals in microseconds, Frame is in whole ms
 	uint64 m_begin[TimerLast], m_total[TimerLast], m_start[TimerLast];
 	uint64 m_frame;
 	clock_t m_lastframe;
@@ -57,6 +61,8 @@ public:
 
 	void Put(counter_t c, double val = 0);
 	double Get(counter_t c) {return m_stats[c];}
+	double GetTotal(counter_t c) const {return m_totals[c];}
+	uint64 GetFrameTime() const {return m_frame_time;}
 	void Update();
 
 	void Start(int timer = Main);
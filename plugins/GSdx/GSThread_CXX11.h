@@ -113,3 +113,145 @@ public:
 		m_func(item);
 	}
 };
+
+// Same as GSJobQueue, for streams of short jobs. Push neither locks nor notifies: when it
+// runs out of jobs the worker spins for a while before it parks, and Flush only wakes it
+// up if it did park, so a burst of jobs costs at most one wakeup instead of one per job.
+// Like GSJobQueue, there must be a single producer thread.
+template<class T, int CAPACITY> class GSSpinJobQueue final
+{
+private:
+	// ~50us on recent cpus, which covers the gap between the draws of a busy frame
+	static const int SPIN_COUNT = 1 << 9;
+
+	std::thread m_thread;
+	std::function<void(T&)> m_func;
+	std::atomic<bool> m_exit;
+	ringbuffer_base<T, CAPACITY> m_queue;
+
+	std::atomic<bool> m_parked;  // the worker waits on m_notempty
+	std::atomic<bool> m_waiting; // the producer waits on m_empty
+
+	std::mutex m_lock;
+	std::condition_variable m_empty;
+	std::condition_variable m_notempty;
+
+	// Returns as soon as the queue is (not) empty, or false when it gave up.
+	bool Spin(bool empty)
+	{
+		for (int i = 0; i < SPIN_COUNT; i++) {
+			if (m_queue.empty() == empty)
+				return true;
+
+			_mm_pause();
+		}
+
+		return m_queue.empty() == empty;
+	}
+
+	void ThreadProc() {
+		while (true) {
+			while (m_queue.consume_one(*this))
+				;
+
+			// Pairs with the fence of Wait, either it sees the queue empty or we see it waiting.
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+
+			if (m_waiting.load(std::memory_order_relaxed)) {
+				std::lock_guard<std::mutex> l(m_lock);
+				m_empty.notify_one();
+			}
+
+			if (Spin(false))
+				continue;
+
+			std::unique_lock<std::mutex> l(m_lock);
+
+			// Pairs with the fence of Flush, either it sees us parked or we see the new jobs.
+			m_parked.store(true, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+
+			while (m_queue.empty()) {
+				if (m_exit.load(std::memory_order_relaxed))
+					return;
+
+				m_notempty.wait(l);
+			}
+
+			m_parked.store(false, std::memory_order_relaxed);
+		}
+	}
+
+public:
+	GSSpinJobQueue(std::function<void(T&)> func) :
+		m_func(func),
+		m_exit(false),
+		m_parked(false),
+		m_waiting(false)
+	{
+		m_thread = std::thread(&GSSpinJobQueue::ThreadProc, this);
+	}
+
+	~GSSpinJobQueue()
+	{
+		{
+			std::lock_guard<std::mutex> l(m_lock);
+			m_exit = true;
+		}
+		m_notempty.notify_one();
+
+		m_thread.join();
+	}
+
+	bool IsEmpty()
+	{
+		return m_queue.empty();
+	}
+
+	// The job isn't guaranteed to be picked up until the next Flush or Wait.
+	void Push(const T& item) {
+		while(!m_queue.push(item)) {
+			Flush();
+			std::this_thread::yield();
+		}
+	}
+
+	void Flush()
+	{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		if (m_parked.load(std::memory_order_relaxed)) {
+			{
+				std::lock_guard<std::mutex> l(m_lock);
+			}
+			m_notempty.notify_one();
+		}
+	}
+
+	void Wait()
+	{
+		if (IsEmpty())
+			return;
+
+		Flush();
+
+		if (Spin(true))
+			return;
+
+		std::unique_lock<std::mutex> l(m_lock);
+
+		m_waiting.store(true, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		while (!IsEmpty())
+			m_empty.wait(l);
+
+		m_waiting.store(false, std::memory_order_relaxed);
+
+		assert(IsEmpty());
+	}
+
+	void operator() (T& item) {
+		m_func(item);
+	}
+};
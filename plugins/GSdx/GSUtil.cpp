@@ -247,6 +247,16 @@ bool GSUtil::CheckSSE()
 	return status;
 }
 
+// F, BW, DQ and VL, what AVX512_TARGET compiles for
+bool GSUtil::HasAVX512()
+{
+	static const bool avx512 =
+		g_cpu.has(Xbyak::util::Cpu::tAVX512F) && g_cpu.has(Xbyak::util::Cpu::tAVX512BW) &&
+		g_cpu.has(Xbyak::util::Cpu::tAVX512DQ) && g_cpu.has(Xbyak::util::Cpu::tAVX512VL);
+
+	return avx512;
+}
+
 CRCHackLevel GSUtil::GetRecommendedCRCHackLevel(GSRendererType type)
 {
 	return type == GSRendererType::OGL_HW ? CRCHackLevel::Partial : CRCHackLevel::Full;
@@ -87,6 +87,14 @@ class GSVector4i;
 #if _M_SSE >= 0x500
 
 class GSVector8;
+class GSVector16i;
+
+// The AVX-512 code is selected at runtime, so it's compiled for it whatever the build targets.
+#if defined(__GNUC__)
+#define AVX512_TARGET __attribute__((target("avx512f,avx512bw,avx512dq,avx512vl")))
+#else
+#define AVX512_TARGET
+#endif
 
 #endif
 
@@ -101,6 +109,7 @@ class GSVector8i;
 #include "GSVector4.h"
 #include "GSVector8i.h"
 #include "GSVector8.h"
+#include "GSVector16i.h"
 
 // conversion
 
@@ -0,0 +1,78 @@
+/*
+ *	Copyright (C) 2007-2017 Gabest
+ *	http://www.gabest.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#if _M_SSE >= 0x500
+
+// AVX-512 is never required by the build: the functions using GSVector16i are compiled for it
+// with AVX512_TARGET, and only called when GSUtil::HasAVX512() is true.
+//
+// Only what GSDrawScanline::FillBlock16 needs, add the rest when it gets other users.
+
+class alignas(64) GSVector16i
+{
+public:
+	union
+	{
+		int v[16];
+		int32 i32[16];
+		uint32 u32[16];
+		__m512i m;
+	};
+
+	AVX512_TARGET __forceinline GSVector16i() {}
+
+	AVX512_TARGET __forceinline GSVector16i(const GSVector16i& v)
+	{
+		m = v.m;
+	}
+
+	AVX512_TARGET __forceinline explicit GSVector16i(int i)
+	{
+		m = _mm512_set1_epi32(i);
+	}
+
+	AVX512_TARGET __forceinline explicit GSVector16i(__m512i m)
+	{
+		this->m = m;
+	}
+
+	AVX512_TARGET __forceinline void operator = (const GSVector16i& v)
+	{
+		m = v.m;
+	}
+
+	AVX512_TARGET __forceinline operator __m512i() const
+	{
+		return m;
+	}
+
+	AVX512_TARGET __forceinline friend GSVector16i operator & (const GSVector16i& v1, const GSVector16i& v2)
+	{
+		return GSVector16i(_mm512_and_si512(v1.m, v2.m));
+	}
+
+	AVX512_TARGET __forceinline friend GSVector16i operator | (const GSVector16i& v1, const GSVector16i& v2)
+	{
+		return GSVector16i(_mm512_or_si512(v1.m, v2.m));
+	}
+};
+
+#endif
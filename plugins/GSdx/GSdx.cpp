@@ -343,6 +343,8 @@ void GSdxApp::Init()
 	m_default_configuration["dump"]                                       = "0";
 	m_default_configuration["extrathreads"]                               = "2";
 	m_default_configuration["extrathreads_height"]                        = "4";
+	m_default_configuration["extrathreads_tiles"]                         = "0";
+	m_default_configuration["jit_cache_sw"]                               = "1";
 	m_default_configuration["filter"]                                     = std::to_string(static_cast<int8>(BiFiltering::PS2));
 	m_default_configuration["force_texture_clear"]                        = "0";
 	m_default_configuration["fxaa"]                                       = "0";
@@ -390,6 +392,7 @@ void GSdxApp::Init()
 	m_default_configuration["png_compression_level"]                      = std::to_string(Z_BEST_SPEED);
 	m_default_configuration["preload_frame_with_gs_data"]                 = "0";
 	m_default_configuration["Renderer"]                                   = std::to_string(static_cast<int>(GSRendererType::Default));
+	m_default_configuration["replay_cache_size"]                          = "1024";
 	m_default_configuration["resx"]                                       = "1024";
 	m_default_configuration["resy"]                                       = "1024";
 	m_default_configuration["save"]                                       = "0";
@@ -512,6 +515,13 @@ void GSdxApp::SetConfigDir(const char* dir)
 	}
 }
 
+std::string GSdxApp::GetConfigDir() const
+{
+	size_t pos = m_ini.find_last_of("/\\");
+
+	return pos != std::string::npos ? m_ini.substr(0, pos + 1) : std::string();
+}
+
 std::string GSdxApp::GetConfigS(const char* entry)
 {
 	char buff[4096] = {0};
@@ -104,6 +104,14 @@ public:
 		}
 	}
 
+	void GetKeys(std::vector<KEY>& keys)
+	{
+		for(const auto &i : m_map_active)
+		{
+			keys.push_back(i.first);
+		}
+	}
+
 	virtual void PrintStats()
 	{
 		uint64 ttpf = 0;
@@ -162,6 +170,7 @@ class GSCodeGeneratorFunctionMap : public GSFunctionMap<KEY, VALUE>
 	std::unordered_map<uint64, VALUE> m_cgmap;
 	GSCodeBuffer m_cb;
 	size_t m_total_code_size;
+	std::mutex m_lock; // the functions can also be generated in advance by another thread
 
 	enum {MAX_SIZE = 8192};
 
@@ -182,6 +191,8 @@ public:
 
 	VALUE GetDefaultFunction(KEY key)
 	{
+		std::lock_guard<std::mutex> lock(m_lock);
+
 		VALUE ret = NULL;
 
 		auto i = m_cgmap.find(key);
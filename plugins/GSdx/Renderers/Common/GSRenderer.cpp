@@ -383,7 +383,7 @@ void GSRenderer::VSync(int field)
 
 				int sum = 0;
 
-				for(int i = 0; i < 16; i++)
+				for(int i = 0; i < 32; i++)
 				{
 					sum += m_perfmon.CPU(GSPerfMon::WorkerDraw0 + i);
 				}
@@ -0,0 +1,141 @@
+/*
+ *	Copyright (C) 2007-2009 Gabest
+ *	http://www.gabest.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#pragma once
+
+#include "GSLocalMemory.h"
+
+// Shared by the SW and HW texture caches, next to their per page lists.
+//
+// GSTextureCacheIndex maps the TEX0 bits which the lookups compare (TBP0 TBW PSM TW TH) to
+// the texture that was used last with them. The caller still checks the rest (TEXA, clut,
+// width), and falls back to the page list when the texture doesn't match.
+//
+// GSPageBitmap tells which pages have textures, so an invalidation only visits the written
+// pages that have some.
+
+template<class T> class GSTextureCacheIndex
+{
+	std::unordered_map<uint64, T*> m_map;
+
+public:
+	static __forceinline uint64 Key(const GIFRegTEX0& TEX0)
+	{
+		return (uint64)TEX0.u32[0] | ((uint64)(TEX0.u32[1] & 3) << 32);
+	}
+
+	__forceinline T* Find(const GIFRegTEX0& TEX0) const
+	{
+		auto i = m_map.find(Key(TEX0));
+
+		return i != m_map.end() ? i->second : NULL;
+	}
+
+	__forceinline void Set(T* t)
+	{
+		m_map[Key(t->m_TEX0)] = t;
+	}
+
+	__forceinline void Erase(T* t)
+	{
+		auto i = m_map.find(Key(t->m_TEX0));
+
+		if(i != m_map.end() && i->second == t)
+		{
+			m_map.erase(i);
+		}
+	}
+
+	void Clear()
+	{
+		m_map.clear();
+	}
+};
+
+class GSPageBitmap
+{
+	alignas(16) uint32 m_bits[MAX_PAGES / 32];
+
+public:
+	GSPageBitmap() {Clear();}
+
+	void Clear()
+	{
+		memset(m_bits, 0, sizeof(m_bits));
+	}
+
+	__forceinline void Set(uint32 page) {m_bits[page >> 5] |= 1u << (page & 31);}
+	__forceinline void Reset(uint32 page) {m_bits[page >> 5] &= ~(1u << (page & 31));}
+	__forceinline bool Test(uint32 page) const {return (m_bits[page >> 5] & (1u << (page & 31))) != 0;}
+
+	__forceinline void SetBits(const uint32* RESTRICT bits)
+	{
+		for(uint32 i = 0; i < MAX_PAGES / 128; i++)
+		{
+			((GSVector4i*)m_bits)[i] |= GSVector4i::load<false>(&bits[i * 4]);
+		}
+	}
+
+	// Copies the pages of the list (EOP terminated) which are set to dst (MAX_PAGES + 1 entries, EOP terminated),
+	// dst can be the list itself
+
+	void Intersect(const uint32* pages, uint32* dst) const
+	{
+		alignas(16) uint32 tmp[MAX_PAGES / 32];
+
+		memset(tmp, 0, sizeof(tmp));
+
+		for(const uint32* p = pages; *p != GSOffset::EOP; p++)
+		{
+			tmp[*p >> 5] |= 1u << (*p & 31);
+		}
+
+		GSVector4i any = GSVector4i::zero();
+
+		for(uint32 i = 0; i < MAX_PAGES / 128; i++)
+		{
+			GSVector4i v = ((GSVector4i*)tmp)[i] & ((const GSVector4i*)m_bits)[i];
+
+			((GSVector4i*)tmp)[i] = v;
+
+			any |= v;
+		}
+
+		if(!any.allfalse())
+		{
+			for(uint32 i = 0; i < MAX_PAGES / 32; i++)
+			{
+				uint32 p = tmp[i];
+
+				unsigned long j;
+
+				while(_BitScanForward(&j, p))
+				{
+					p ^= 1U << j;
+
+					*dst++ = (i << 5) + j;
+				}
+			}
+		}
+
+		*dst = GSOffset::EOP;
+	}
+};
@@ -199,6 +199,30 @@ GSTextureCache::Source* GSTextureCache::LookupDepthSource(const GIFRegTEX0& TEX0
 	return src;
 }
 
+bool GSTextureCache::SourceMatch(Source* s, const GIFRegTEX0& TEX0, const GIFRegTEXA& TEXA, const uint32* clut)
+{
+	if (((TEX0.u32[0] ^ s->m_TEX0.u32[0]) | ((TEX0.u32[1] ^ s->m_TEX0.u32[1]) & 3)) != 0) // TBP0 TBW PSM TW TH
+		return false;
+
+	// Target are converted (AEM & palette) on the fly by the GPU. They don't need extra check
+	if (!s->m_target) {
+		const GSLocalMemory::psm_t& psm_s = GSLocalMemory::m_psm[TEX0.PSM];
+
+		// We request a palette texture (psm_s.pal). If the texture was
+		// converted by the CPU (!s->m_palette), we need to ensure
+		// palette content is the same.
+		if (psm_s.pal > 0 && !s->m_palette && !s->ClutMatch({ clut, psm_s.pal }))
+			return false;
+
+		// We request a 24/16 bit RGBA texture. Alpha expansion was done by
+		// the CPU.  We need to check that TEXA is identical
+		if (psm_s.pal == 0 && psm_s.fmt > 0 && s->m_TEXA.u64 != TEXA.u64)
+			return false;
+	}
+
+	return true;
+}
+
 GSTextureCache::Source* GSTextureCache::LookupSource(const GIFRegTEX0& TEX0, const GIFRegTEXA& TEXA, const GSVector4i& r)
 {
 	const GSLocalMemory::psm_t& psm_s = GSLocalMemory::m_psm[TEX0.PSM];
@@ -210,38 +234,32 @@ GSTextureCache::Source* GSTextureCache::LookupSource(const GIFRegTEX0& TEX0, con
 
 	const uint32* clut = m_renderer->m_mem.m_clut;
 
-	Source* src = NULL;
+	const uint32 first = TEX0.TBP0 >> 5;
 
-	auto& m = m_src.m_map[TEX0.TBP0 >> 5];
+	auto& m = m_src.m_map[first];
 
-	for(auto i = m.begin(); i != m.end(); ++i)
-	{
-		Source* s = *i;
+	// The source used last with the same TEX0 usually matches, the page list is the fallback
+	// (different palettes or TEXA).
+	Source* src = m_src.m_index.Find(TEX0);
 
-		if (((TEX0.u32[0] ^ s->m_TEX0.u32[0]) | ((TEX0.u32[1] ^ s->m_TEX0.u32[1]) & 3)) != 0) // TBP0 TBW PSM TW TH
-			continue;
-
-		// Target are converted (AEM & palette) on the fly by the GPU. They don't need extra check
-		if (!s->m_target) {
-			// We request a palette texture (psm_s.pal). If the texture was
-			// converted by the CPU (!s->m_palette), we need to ensure
-			// palette content is the same.
-			if (psm_s.pal > 0 && !s->m_palette && !s->ClutMatch({ clut, psm_s.pal }))
-				continue;
-
-			// We request a 24/16 bit RGBA texture. Alpha expansion was done by
-			// the CPU.  We need to check that TEXA is identical
-			if (psm_s.pal == 0 && psm_s.fmt > 0 && s->m_TEXA.u64 != TEXA.u64)
-				continue;
-		}
+	if (src == NULL || !SourceMatch(src, TEX0, TEXA, clut)) {
+		src = NULL;
 
-		m.MoveFront(i.Index());
+		for(auto i = m.begin(); i != m.end(); ++i)
+		{
+			if (SourceMatch(*i, TEX0, TEXA, clut)) {
+				src = *i;
 
-		src = s;
+				m_src.m_index.Set(src);
 
-		break;
+				break;
+			}
+		}
 	}
 
+	if (src)
+		m.MoveFront(src->m_erase_it[first]);
+
 	Target* dst = NULL;
 	bool half_right = false;
 	int x_offset = 0;
@@ -825,6 +843,9 @@ void GSTextureCache::InvalidateVideoMem(GSOffset* off, const GSVector4i& rect, b
 
 	bool found = false;
 
+	// Only the written pages which have sources, the list is rewritten in place
+	m_src.m_pages.Intersect(pages, pages);
+
 	for(const uint32* p = pages; *p != GSOffset::EOP; p++)
 	{
 		uint32 page = *p;
@@ -2028,12 +2049,17 @@ void GSTextureCache::SourceMap::Add(Source* s, const GIFRegTEX0& TEX0, GSOffset*
 		size_t page = TEX0.TBP0 >> 5;
 
 		s->m_erase_it[page] = m_map[page].InsertFront(s);
+		m_index.Set(s);
+		m_pages.Set(page);
 
 		return;
 	}
 
+	m_index.Set(s);
+	m_pages.SetBits(s->m_pages_as_bit);
+
 	// The source pointer will be stored/duplicated in all m_map[array of pages]
-	for(size_t i = 0; i < countof(m_pages); i++)
+	for(size_t i = 0; i < MAX_PAGES / 32; i++)
 	{
 		if(uint32 p = s->m_pages_as_bit[i])
 		{
@@ -2065,6 +2091,9 @@ void GSTextureCache::SourceMap::RemoveAll()
 	{
 		m_map[i].clear();
 	}
+
+	m_index.Clear();
+	m_pages.Clear();
 }
 
 void GSTextureCache::SourceMap::RemoveAt(Source* s)
@@ -2075,14 +2104,19 @@ void GSTextureCache::SourceMap::RemoveAt(Source* s)
 				s->m_texture ? s->m_texture->GetID() : 0,
 				s->m_TEX0.TBP0);
 
+	m_index.Erase(s);
+
 	if (s->m_target)
 	{
 		const size_t page = s->m_TEX0.TBP0 >> 5;
 		m_map[page].EraseIndex(s->m_erase_it[page]);
+
+		if (m_map[page].empty())
+			m_pages.Reset(page);
 	}
 	else
 	{
-		for(size_t i = 0; i < countof(m_pages); i++)
+		for(size_t i = 0; i < MAX_PAGES / 32; i++)
 		{
 			if(uint32 p = s->m_pages_as_bit[i])
 			{
@@ -2099,6 +2133,9 @@ void GSTextureCache::SourceMap::RemoveAt(Source* s)
 					p ^= 1U << j;
 
 					m[j].EraseIndex(e[j]);
+
+					if (m[j].empty())
+						m_pages.Reset((i << 5) + j);
 				}
 			}
 		}
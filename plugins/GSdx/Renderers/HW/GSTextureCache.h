@@ -23,6 +23,7 @@
 
 #include "Renderers/Common/GSRenderer.h"
 #include "Renderers/Common/GSFastList.h"
+#include "Renderers/Common/GSTextureCacheIndex.h"
 #include "Renderers/Common/GSDirtyRect.h"
 
 class GSTextureCache
@@ -175,10 +176,11 @@ public:
 	public:
 		std::unordered_set<Source*> m_surfaces;
 		std::array<FastList<Source*>, MAX_PAGES> m_map;
-		uint32 m_pages[16]; // bitmap of all pages
+		GSTextureCacheIndex<Source> m_index;
+		GSPageBitmap m_pages; // pages with sources
 		bool m_used;
 
-		SourceMap() : m_used(false) {memset(m_pages, 0, sizeof(m_pages));}
+		SourceMap() : m_used(false) {}
 
 		void Add(Source* s, const GIFRegTEX0& TEX0, GSOffset* off);
 		void RemoveAll();
@@ -216,6 +218,8 @@ protected:
 	uint8 m_texture_inside_rt_cache_size = 255;
 	std::vector<TexInsideRtCacheEntry> m_texture_inside_rt_cache;
 
+	static bool SourceMatch(Source* s, const GIFRegTEX0& TEX0, const GIFRegTEXA& TEXA, const uint32* clut);
+
 	virtual Source* CreateSource(const GIFRegTEX0& TEX0, const GIFRegTEXA& TEXA, Target* t = NULL, bool half_right = false, int x_offset = 0, int y_offset = 0);
 	virtual Target* CreateTarget(const GIFRegTEX0& TEX0, int w, int h, int type);
 
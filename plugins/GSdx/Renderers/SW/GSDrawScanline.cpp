@@ -114,6 +114,27 @@ void GSDrawScanline::EndDraw(uint64 frame, uint64 ticks, int actual, int total)
 	m_ds_map.UpdateStats(frame, ticks, actual, total);
 }
 
+void GSDrawScanline::GetKeys(GSScanlineKeys& keys)
+{
+	m_sp_map.GetKeys(keys.sp);
+	m_ds_map.GetKeys(keys.ds);
+}
+
+void GSDrawScanline::Precompile(const GSScanlineKeys& keys, const std::atomic<bool>& stop)
+{
+	// only fills the code generator caches, the active function tables of the maps belong to the rasterizer thread
+
+	for(size_t i = 0; i < keys.sp.size() && !stop; i++)
+	{
+		m_sp_map.GetDefaultFunction(keys.sp[i]);
+	}
+
+	for(size_t i = 0; i < keys.ds.size() && !stop; i++)
+	{
+		m_ds_map.GetDefaultFunction(keys.ds[i]);
+	}
+}
+
 #ifndef ENABLE_JIT_RASTERIZER
 
 void GSDrawScanline::SetupPrim(const GSVertexSW* vertex, const uint32* index, const GSVertexSW& dscan)
@@ -2911,7 +2932,18 @@ void GSDrawScanline::DrawRectT(const int* RESTRICT row, const int* RESTRICT col,
 			FillRect<T, masked>(row, col, GSVector4i(br.z, br.y, r.z, br.w), c, m);
 		}
 
-		FillBlock<T, masked>(row, col, br, color, mask);
+		#if _M_SSE >= 0x500
+
+		if(GSUtil::HasAVX512())
+		{
+			FillBlock16<T, masked>(row, col, br, c, m);
+		}
+		else
+
+		#endif
+		{
+			FillBlock<T, masked>(row, col, br, color, mask);
+		}
 	}
 	else
 	{
@@ -2995,3 +3027,35 @@ void GSDrawScanline::FillBlock(const int* RESTRICT row, const int* RESTRICT col,
 }
 
 #endif
+
+#if _M_SSE >= 0x500
+
+template<class T, bool masked>
+void GSDrawScanline::FillBlock16(const int* RESTRICT row, const int* RESTRICT col, const GSVector4i& r, uint32 c, uint32 m)
+{
+	if(r.x >= r.z) return;
+
+	T* vm = (T*)m_global.vm;
+
+	// a block is 256 bytes, 4 stores, and c | (d & m) is a single vpternlogd
+
+	GSVector16i color((int)c);
+	GSVector16i mask((int)m);
+
+	for(int y = r.y; y < r.w; y += 8)
+	{
+		T* RESTRICT d = &vm[row[y]];
+
+		for(int x = r.x; x < r.z; x += 8 * 4 / sizeof(T))
+		{
+			GSVector16i* RESTRICT p = (GSVector16i*)&d[col[x]];
+
+			p[0] = !masked ? color : (color | (p[0] & mask));
+			p[1] = !masked ? color : (color | (p[1] & mask));
+			p[2] = !masked ? color : (color | (p[2] & mask));
+			p[3] = !masked ? color : (color | (p[3] & mask));
+		}
+	}
+}
+
+#endif
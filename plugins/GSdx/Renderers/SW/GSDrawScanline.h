@@ -61,6 +61,13 @@ protected:
 
 	#endif
 
+	#if _M_SSE >= 0x500
+
+	template<class T, bool masked>
+	AVX512_TARGET void FillBlock16(const int* RESTRICT row, const int* RESTRICT col, const GSVector4i& r, uint32 c, uint32 m);
+
+	#endif
+
 public:
 	GSDrawScanline();
 	virtual ~GSDrawScanline() = default;
@@ -87,4 +94,6 @@ public:
 #endif
 
 	void PrintStats() {m_ds_map.PrintStats();}
+	void GetKeys(GSScanlineKeys& keys);
+	void Precompile(const GSScanlineKeys& keys, const std::atomic<bool>& stop);
 };
@@ -23,6 +23,7 @@
 
 #include "stdafx.h"
 #include "GSRasterizer.h"
+#include "GSUtil.h"
 
 int GSRasterizerData::s_counter = 0;
 
@@ -57,11 +58,13 @@ GSRasterizer::GSRasterizer(IDrawScanline* ds, int id, int threads, GSPerfMon* pe
 
 	int row = 0;
 
+	// a single thread draws every scanline, whatever its id (GSRasterizerTiles clips with the scissor instead)
+
 	while(row < rows)
 	{
 		for(int i = 0; i < threads; i++, row++)
 		{
-			m_scanline[row] = i == id ? 1 : 0;
+			m_scanline[row] = threads == 1 || i == id ? 1 : 0;
 		}
 	}
 }
@@ -114,9 +117,9 @@ int GSRasterizer::FindMyNextScanline(int top) const
 	return top;
 }
 
-void GSRasterizer::Queue(const std::shared_ptr<GSRasterizerData>& data)
+void GSRasterizer::Queue(GSRasterizerData* data)
 {
-	Draw(data.get());
+	Draw(data);
 }
 
 int GSRasterizer::GetPixels(bool reset)
@@ -132,10 +135,15 @@ int GSRasterizer::GetPixels(bool reset)
 }
 
 void GSRasterizer::Draw(GSRasterizerData* data)
+{
+	Draw(data, data->scissor, data->index, data->index_count);
+}
+
+void GSRasterizer::Draw(GSRasterizerData* data, const GSVector4i& scissor, const uint32* index, int index_count)
 {
 	GSPerfMonAutoTimer pmat(m_perfmon, GSPerfMon::WorkerDraw0 + m_id);
 
-	if(data->vertex != NULL && data->vertex_count == 0 || data->index != NULL && data->index_count == 0) return;
+	if(data->vertex != NULL && data->vertex_count == 0 || index != NULL && index_count == 0) return;
 
 	m_pixels.actual = 0;
 	m_pixels.total = 0;
@@ -147,16 +155,15 @@ void GSRasterizer::Draw(GSRasterizerData* data)
 	const GSVertexSW* vertex = data->vertex;
 	const GSVertexSW* vertex_end = data->vertex + data->vertex_count;
 
-	const uint32* index = data->index;
-	const uint32* index_end = data->index + data->index_count;
+	const uint32* index_end = index + index_count;
 
 	uint32 tmp_index[] = {0, 1, 2};
 
-	bool scissor_test = !data->bbox.eq(data->bbox.rintersect(data->scissor));
+	bool scissor_test = !data->bbox.eq(data->bbox.rintersect(scissor));
 
-	m_scissor = data->scissor;
-	m_fscissor_x = GSVector4(data->scissor).xzxz();
-	m_fscissor_y = GSVector4(data->scissor).ywyw();
+	m_scissor = scissor;
+	m_fscissor_x = GSVector4(scissor).xzxz();
+	m_fscissor_y = GSVector4(scissor).ywyw();
 
 	switch(data->primclass)
 	{
@@ -164,11 +171,11 @@ void GSRasterizer::Draw(GSRasterizerData* data)
 
 		if(scissor_test)
 		{
-			DrawPoint<true>(vertex, data->vertex_count, index, data->index_count);
+			DrawPoint<true>(vertex, data->vertex_count, index, index_count);
 		}
 		else
 		{
-			DrawPoint<false>(vertex, data->vertex_count, index, data->index_count);
+			DrawPoint<false>(vertex, data->vertex_count, index, index_count);
 		}
 
 		break;
@@ -1161,7 +1168,7 @@ GSRasterizerList::~GSRasterizerList()
 	_aligned_free(m_scanline);
 }
 
-void GSRasterizerList::Queue(const std::shared_ptr<GSRasterizerData>& data)
+void GSRasterizerList::Queue(GSRasterizerData* data)
 {
 	GSVector4i r = data->bbox.rintersect(data->scissor);
 
@@ -1170,9 +1177,25 @@ void GSRasterizerList::Queue(const std::shared_ptr<GSRasterizerData>& data)
 	int top = r.top >> m_thread_height;
 	int bottom = std::min<int>((r.bottom + (1 << m_thread_height) - 1) >> m_thread_height, top + m_workers.size());
 
-	while(top < bottom)
+	if(top >= bottom)
+	{
+		return;
+	}
+
+	// one reference per worker, released by the worker once it has drawn its part
+
+	data->AddRef(bottom - top);
+
+	for(int i = top; i < bottom; i++)
 	{
-		m_workers[m_scanline[top++]]->Push(data);
+		m_workers[m_scanline[i]]->Push(data);
+	}
+
+	// wake up the workers which went to sleep, once all of them have their job
+
+	for(int i = top; i < bottom; i++)
+	{
+		m_workers[m_scanline[i]]->Flush();
 	}
 }
 
@@ -1213,3 +1236,458 @@ int GSRasterizerList::GetPixels(bool reset)
 
 	return pixels;
 }
+
+void GSRasterizerList::GetKeys(GSScanlineKeys& keys)
+{
+	for(size_t i = 0; i < m_r.size(); i++)
+	{
+		m_r[i]->GetKeys(keys);
+	}
+}
+
+void GSRasterizerList::Precompile(const GSScanlineKeys& keys, const std::atomic<bool>& stop)
+{
+	for(size_t i = 0; i < m_r.size() && !stop; i++)
+	{
+		m_r[i]->Precompile(keys, stop);
+	}
+}
+
+//
+
+GSRasterizerTiles::GSRasterizerTiles(GSPerfMon* perfmon)
+	: m_perfmon(perfmon)
+	, m_tiles(new Tile[TILE_COUNT])
+	, m_ready_words(1)
+	, m_pending(0)
+	, m_parked(0)
+	, m_waiting(false)
+	, m_exit(false)
+{
+	for(int i = 0; i < TILE_COUNT; i++)
+	{
+		m_tiles[i].busy = false;
+	}
+
+	for(int i = 0; i < TILE_WORDS; i++)
+	{
+		m_ready[i] = 0;
+	}
+
+	m_tile_count.resize(TILE_COUNT);
+}
+
+GSRasterizerTiles::~GSRasterizerTiles()
+{
+	{
+		std::lock_guard<std::mutex> l(m_lock);
+		m_exit = true;
+	}
+	m_notempty.notify_all();
+
+	for(auto& t : m_workers)
+	{
+		t.join();
+	}
+
+	for(int i = 0; i < TILE_COUNT; i++)
+	{
+		Job job;
+
+		while(m_tiles[i].queue.pop(job))
+		{
+			job.data->Release();
+		}
+	}
+}
+
+void GSRasterizerTiles::Start()
+{
+	for(size_t i = 0; i < m_r.size(); i++)
+	{
+		m_workers.push_back(std::thread(&GSRasterizerTiles::ThreadProc, this, (int)i));
+	}
+}
+
+void GSRasterizerTiles::Queue(GSRasterizerData* data)
+{
+	GSVector4i r = data->bbox.rintersect(data->scissor);
+
+	ASSERT(r.top >= 0 && r.top < 2048 && r.bottom >= 0 && r.bottom < 2048);
+
+	if(r.rempty())
+	{
+		return;
+	}
+
+	GSVector4i tr = (r + GSVector4i(0, 0, TILE_SIZE - 1, TILE_SIZE - 1)).sra32(TILE_SHIFT);
+
+	int width = tr.z - tr.x;
+	int tiles = width * (tr.w - tr.y);
+
+	int n = GSUtil::GetClassVertexCount(data->primclass);
+	int prims = data->index != NULL ? data->index_count / n : 0;
+
+	int jobs = 0;
+
+	if(tiles == 1 || prims <= 1)
+	{
+		// nothing to sort, every tile draws the whole thing
+
+		data->AddRef(tiles);
+
+		m_pending.fetch_add(tiles, std::memory_order_relaxed);
+
+		for(int y = tr.y; y < tr.w; y++)
+		{
+			for(int x = tr.x; x < tr.z; x++)
+			{
+				Push(y * TILE_ROW + x, Job {data, data->index, data->index_count});
+			}
+		}
+
+		jobs = tiles;
+	}
+	else
+	{
+		// first count the primitives of each tile, from the bounding box of the vertices (pixels are
+		// sampled at the ceiling of the coordinates, points and lines may touch the next pixel)
+
+		const GSVertexSW* vertex = data->vertex;
+		const uint32* index = data->index;
+
+		int* count = m_tile_count.data();
+
+		memset(count, 0, sizeof(int) * tiles);
+
+		m_prim_tiles.resize(prims);
+
+		for(int i = 0; i < prims; i++, index += n)
+		{
+			GSVector4 pmin = vertex[index[0]].p;
+			GSVector4 pmax = pmin;
+
+			for(int j = 1; j < n; j++)
+			{
+				pmin = pmin.min(vertex[index[j]].p);
+				pmax = pmax.max(vertex[index[j]].p);
+			}
+
+			GSVector4i b = GSVector4i(pmin.floor().xyxy(pmax.ceil()));
+
+			b = (b + GSVector4i(0, 0, TILE_SIZE, TILE_SIZE)).sra32(TILE_SHIFT).rintersect(tr) - tr.xyxy();
+
+			m_prim_tiles[i] = b;
+
+			for(int y = b.y; y < b.w; y++)
+			{
+				for(int x = b.x; x < b.z; x++)
+				{
+					count[y * width + x]++;
+				}
+			}
+		}
+
+		int total = 0;
+
+		for(int i = 0; i < tiles; i++)
+		{
+			int c = count[i];
+
+			if(c > 0)
+			{
+				jobs++;
+			}
+
+			count[i] = total;
+			total += c;
+		}
+
+		if(jobs == 0)
+		{
+			return;
+		}
+
+		// then fill the index lists, count[i] ends up at the end of the list of tile i
+
+		ASSERT(data->tile_index == NULL);
+
+		uint32* RESTRICT tile_index = (uint32*)_aligned_malloc(sizeof(uint32) * total * n, 32);
+
+		data->tile_index = tile_index;
+
+		index = data->index;
+
+		for(int i = 0; i < prims; i++, index += n)
+		{
+			GSVector4i b = m_prim_tiles[i];
+
+			for(int y = b.y; y < b.w; y++)
+			{
+				for(int x = b.x; x < b.z; x++)
+				{
+					uint32* RESTRICT dst = &tile_index[count[y * width + x]++ * n];
+
+					for(int j = 0; j < n; j++)
+					{
+						dst[j] = index[j];
+					}
+				}
+			}
+		}
+
+		data->AddRef(jobs);
+
+		m_pending.fetch_add(jobs, std::memory_order_relaxed);
+
+		int start = 0;
+
+		for(int i = 0; i < tiles; i++)
+		{
+			int end = count[i];
+
+			if(end > start)
+			{
+				Push((tr.y + i / width) * TILE_ROW + tr.x + i % width, Job {data, &tile_index[start * n], (end - start) * n});
+			}
+
+			start = end;
+		}
+	}
+
+	int words = ((tr.w - 1) * TILE_ROW + tr.z - 1) / 32 + 1;
+
+	if(words > m_ready_words.load(std::memory_order_relaxed))
+	{
+		m_ready_words.store(words, std::memory_order_relaxed);
+	}
+
+	Flush(jobs);
+}
+
+void GSRasterizerTiles::Push(int tile, const Job& job)
+{
+	while(!m_tiles[tile].queue.push(job))
+	{
+		Flush(1);
+
+		std::this_thread::yield();
+	}
+
+	m_ready[tile >> 5].fetch_or(1u << (tile & 31));
+}
+
+void GSRasterizerTiles::Flush(int jobs)
+{
+	// Pairs with the fence of ThreadProc, either we see the worker parked or it sees the tiles ready.
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	int parked = m_parked.load(std::memory_order_relaxed);
+
+	if(parked > 0)
+	{
+		{
+			std::lock_guard<std::mutex> l(m_lock);
+		}
+
+		for(int i = std::min(parked, jobs); i > 0; i--)
+		{
+			m_notempty.notify_one();
+		}
+	}
+}
+
+bool GSRasterizerTiles::HasReadyTile()
+{
+	for(int i = 0; i < TILE_WORDS; i++)
+	{
+		unsigned long bits = m_ready[i].load(std::memory_order_relaxed);
+		unsigned long j;
+
+		while(_BitScanForward(&j, bits))
+		{
+			bits ^= 1u << j;
+
+			// a busy tile will be checked again by its worker once it's done with it
+
+			if(!m_tiles[i * 32 + j].busy.load(std::memory_order_relaxed))
+			{
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+bool GSRasterizerTiles::DrawReadyTile(int id)
+{
+	// start from the worker's own part of the screen, and go round to steal from the others
+
+	int words = m_ready_words.load(std::memory_order_relaxed);
+	int start = id * words / (int)m_r.size();
+
+	for(int k = 0; k < TILE_WORDS; k++)
+	{
+		int i = (start + k) % TILE_WORDS;
+
+		unsigned long bits = m_ready[i].load(std::memory_order_relaxed);
+		unsigned long j;
+
+		while(_BitScanForward(&j, bits))
+		{
+			bits ^= 1u << j;
+
+			Tile& tile = m_tiles[i * 32 + j];
+
+			if(tile.busy.load(std::memory_order_relaxed) || tile.busy.exchange(true, std::memory_order_acquire))
+			{
+				continue;
+			}
+
+			// clear the bit before draining the queue, a job pushed meanwhile sets it again
+
+			m_ready[i].fetch_and(~(1u << j), std::memory_order_acq_rel);
+
+			GSRasterizer* r = m_r[id].get();
+
+			int x = (i * 32 + j) % TILE_ROW;
+			int y = (i * 32 + j) / TILE_ROW;
+
+			GSVector4i rect = GSVector4i(x, y, x + 1, y + 1).sll32(TILE_SHIFT);
+
+			Job job;
+
+			while(tile.queue.pop(job))
+			{
+				r->Draw(job.data, job.data->scissor.rintersect(rect), job.index, job.index_count);
+
+				job.data->Release();
+
+				if(m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				{
+					// Pairs with the fence of Sync, either it sees no pending job or we see it waiting.
+					std::atomic_thread_fence(std::memory_order_seq_cst);
+
+					if(m_waiting.load(std::memory_order_relaxed))
+					{
+						std::lock_guard<std::mutex> l(m_lock);
+						m_empty.notify_one();
+					}
+				}
+			}
+
+			tile.busy.store(false, std::memory_order_release);
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void GSRasterizerTiles::ThreadProc(int id)
+{
+	while(true)
+	{
+		if(DrawReadyTile(id))
+		{
+			continue;
+		}
+
+		bool ready = false;
+
+		for(int i = 0; i < SPIN_COUNT && !(ready = HasReadyTile()); i++)
+		{
+			_mm_pause();
+		}
+
+		if(ready)
+		{
+			continue;
+		}
+
+		std::unique_lock<std::mutex> l(m_lock);
+
+		// Pairs with the fence of Flush, either it sees us parked or we see the tiles ready.
+		m_parked.fetch_add(1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		while(!HasReadyTile())
+		{
+			if(m_exit)
+			{
+				return;
+			}
+
+			m_notempty.wait(l);
+		}
+
+		m_parked.fetch_sub(1, std::memory_order_relaxed);
+	}
+}
+
+void GSRasterizerTiles::Sync()
+{
+	if(IsSynced())
+	{
+		return;
+	}
+
+	bool synced = false;
+
+	for(int i = 0; i < SPIN_COUNT && !(synced = IsSynced()); i++)
+	{
+		_mm_pause();
+	}
+
+	if(!synced)
+	{
+		std::unique_lock<std::mutex> l(m_lock);
+
+		m_waiting.store(true, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		while(!IsSynced())
+		{
+			m_empty.wait(l);
+		}
+
+		m_waiting.store(false, std::memory_order_relaxed);
+	}
+
+	m_perfmon->Put(GSPerfMon::SyncPoint, 1);
+}
+
+bool GSRasterizerTiles::IsSynced() const
+{
+	return m_pending.load(std::memory_order_acquire) == 0;
+}
+
+int GSRasterizerTiles::GetPixels(bool reset)
+{
+	int pixels = 0;
+
+	for(size_t i = 0; i < m_r.size(); i++)
+	{
+		pixels += m_r[i]->GetPixels(reset);
+	}
+
+	return pixels;
+}
+
+void GSRasterizerTiles::GetKeys(GSScanlineKeys& keys)
+{
+	for(size_t i = 0; i < m_r.size(); i++)
+	{
+		m_r[i]->GetKeys(keys);
+	}
+}
+
+void GSRasterizerTiles::Precompile(const GSScanlineKeys& keys, const std::atomic<bool>& stop)
+{
+	for(size_t i = 0; i < m_r.size() && !stop; i++)
+	{
+		m_r[i]->Precompile(keys, stop);
+	}
+}
@@ -32,6 +32,8 @@ class alignas(32) GSRasterizerData : public GSAlignedClass<32>
 {
 	static int s_counter;
 
+	std::atomic<int> m_refs;
+
 public:
 	GSVector4i scissor;
 	GSVector4i bbox;
@@ -41,13 +43,15 @@ public:
 	int vertex_count;
 	uint32* index;
 	int index_count;
+	uint32* tile_index; // per tile index lists, see GSRasterizerTiles
 	uint64 frame;
 	uint64 start;
 	int pixels;
 	int counter;
 
 	GSRasterizerData() 
-		: scissor(GSVector4i::zero())
+		: m_refs(1)
+		, scissor(GSVector4i::zero())
 		, bbox(GSVector4i::zero())
 		, primclass(GS_INVALID_CLASS)
 		, buff(NULL)
@@ -55,6 +59,7 @@ public:
 		, vertex_count(0)
 		, index(NULL)
 		, index_count(0)
+		, tile_index(NULL)
 		, frame(0)
 		, start(0)
 		, pixels(0)
@@ -65,9 +70,35 @@ public:
 	virtual ~GSRasterizerData() 
 	{
 		if(buff != NULL) _aligned_free(buff);
+		if(tile_index != NULL) _aligned_free(tile_index);
+	}
+
+	// The creator holds the first reference, the rasterizers add one for each worker
+	// the data is queued to, and the last one to release it deletes it.
+
+	void AddRef(int count = 1)
+	{
+		m_refs.fetch_add(count, std::memory_order_relaxed);
+	}
+
+	void Release()
+	{
+		if(m_refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			delete this;
+		}
 	}
 };
 
+// Keys of the generated setup prim and scanline functions, which are saved per game and
+// generated again in advance next time (see GSRendererSW::SetGameCRC).
+
+struct GSScanlineKeys
+{
+	std::vector<uint64> sp;
+	std::vector<uint64> ds;
+};
+
 class IDrawScanline : public GSAlignedClass<32>
 {
 public:
@@ -106,6 +137,9 @@ public:
 
 	virtual void PrintStats() = 0;
 
+	virtual void GetKeys(GSScanlineKeys& keys) = 0;
+	virtual void Precompile(const GSScanlineKeys& keys, const std::atomic<bool>& stop) = 0;
+
 	__forceinline bool HasEdge() const {return m_de != NULL;}
 	__forceinline bool IsSolidRect() const {return m_dr != NULL;}
 };
@@ -115,11 +149,16 @@ class IRasterizer : public GSAlignedClass<32>
 public:
 	virtual ~IRasterizer() {}
 
-	virtual void Queue(const std::shared_ptr<GSRasterizerData>& data) = 0;
+	virtual void Queue(GSRasterizerData* data) = 0;
 	virtual void Sync() = 0;
 	virtual bool IsSynced() const = 0;
 	virtual int GetPixels(bool reset = true) = 0;
 	virtual void PrintStats() = 0;
+
+	// Appends the keys used so far, the rasterizers of a list may return the same ones. Sync first.
+	virtual void GetKeys(GSScanlineKeys& keys) = 0;
+	// Can be called from any thread, stop is checked between the functions.
+	virtual void Precompile(const GSScanlineKeys& keys, const std::atomic<bool>& stop) = 0;
 };
 
 class alignas(32) GSRasterizer : public IRasterizer
@@ -168,20 +207,23 @@ public:
 	__forceinline int FindMyNextScanline(int top) const;
 
 	void Draw(GSRasterizerData* data);
+	void Draw(GSRasterizerData* data, const GSVector4i& scissor, const uint32* index, int index_count);
 
 	// IRasterizer
 
-	void Queue(const std::shared_ptr<GSRasterizerData>& data);
+	void Queue(GSRasterizerData* data);
 	void Sync() {}
 	bool IsSynced() const {return true;}
 	int GetPixels(bool reset);
 	void PrintStats() {m_ds->PrintStats();}
+	void GetKeys(GSScanlineKeys& keys) {m_ds->GetKeys(keys);}
+	void Precompile(const GSScanlineKeys& keys, const std::atomic<bool>& stop) {m_ds->Precompile(keys, stop);}
 };
 
 class GSRasterizerList : public IRasterizer
 {
 protected:
-	using GSWorker = GSJobQueue<std::shared_ptr<GSRasterizerData>, 65536>;
+	using GSWorker = GSSpinJobQueue<GSRasterizerData*, 65536>;
 
 	GSPerfMon* m_perfmon;
 	// Worker threads depend on the rasterizers, so don't change the order.
@@ -211,17 +253,114 @@ public:
 			rl->m_r.push_back(std::unique_ptr<GSRasterizer>(new GSRasterizer(new DS(), i, threads, perfmon)));
 			auto &r = *rl->m_r[i];
 			rl->m_workers.push_back(std::unique_ptr<GSWorker>(new GSWorker(
-				[&r](std::shared_ptr<GSRasterizerData> &item) { r.Draw(item.get()); })));
+				[&r](GSRasterizerData*& item) { r.Draw(item); item->Release(); })));
+		}
+
+		return rl;
+	}
+
+	// IRasterizer
+
+	void Queue(GSRasterizerData* data);
+	void Sync();
+	bool IsSynced() const;
+	int GetPixels(bool reset);
+	void PrintStats() {}
+	void GetKeys(GSScanlineKeys& keys);
+	void Precompile(const GSScanlineKeys& keys, const std::atomic<bool>& stop);
+};
+
+// Alternative to GSRasterizerList for many threads. The screen is split into tiles, each
+// draw is binned into the tiles it covers (per primitive when it covers several of them),
+// and the workers take whole tiles: first in their own part of the screen, then stealing
+// from the others. A tile is drawn by one worker at a time and in draw order, and the
+// rasterizers clip to it with the scissor, so they don't need to interleave scanlines.
+
+class GSRasterizerTiles : public IRasterizer
+{
+protected:
+	static const int TILE_SHIFT = 6; // 64x64
+	static const int TILE_SIZE = 1 << TILE_SHIFT;
+	static const int TILE_ROW = 2048 >> TILE_SHIFT;
+	static const int TILE_COUNT = TILE_ROW * TILE_ROW;
+	static const int TILE_WORDS = TILE_COUNT / 32;
+	static const int TILE_QUEUE = 256;
+	static const int SPIN_COUNT = 1 << 9;
+
+	struct Job
+	{
+		GSRasterizerData* data;
+		const uint32* index;
+		int index_count;
+	};
+
+	struct Tile
+	{
+		ringbuffer_base<Job, TILE_QUEUE> queue; // one producer, and the worker which holds busy
+		std::atomic<bool> busy;
+	};
+
+	GSPerfMon* m_perfmon;
+	// Worker threads depend on the rasterizers, so don't change the order.
+	std::vector<std::unique_ptr<GSRasterizer>> m_r;
+	std::vector<std::thread> m_workers;
+	std::unique_ptr<Tile[]> m_tiles;
+
+	std::atomic<uint32> m_ready[TILE_WORDS]; // tiles with queued jobs
+	std::atomic<int> m_ready_words;          // words which have been used so far, to spread the workers
+	std::atomic<int> m_pending;              // jobs not drawn yet
+	std::atomic<int> m_parked;
+	std::atomic<bool> m_waiting;
+	std::atomic<bool> m_exit;
+
+	std::mutex m_lock;
+	std::condition_variable m_empty;
+	std::condition_variable m_notempty;
+
+	// binning scratch, producer only
+	std::vector<GSVector4i> m_prim_tiles;
+	std::vector<int> m_tile_count;
+
+	GSRasterizerTiles(GSPerfMon* perfmon);
+
+	void Start();
+	void ThreadProc(int id);
+	bool HasReadyTile();
+	bool DrawReadyTile(int id);
+	void Push(int tile, const Job& job);
+	void Flush(int jobs);
+
+public:
+	virtual ~GSRasterizerTiles();
+
+	template<class DS> static IRasterizer* Create(int threads, GSPerfMon* perfmon)
+	{
+		threads = std::max<int>(threads, 0);
+
+		if(threads == 0)
+		{
+			return new GSRasterizer(new DS(), 0, 1, perfmon);
 		}
 
+		GSRasterizerTiles* rl = new GSRasterizerTiles(perfmon);
+
+		for(int i = 0; i < threads; i++)
+		{
+			rl->m_r.push_back(std::unique_ptr<GSRasterizer>(new GSRasterizer(new DS(), i, 1, perfmon)));
+		}
+
+		rl->Start();
+
 		return rl;
 	}
 
 	// IRasterizer
 
-	void Queue(const std::shared_ptr<GSRasterizerData>& data);
+	void Queue(GSRasterizerData* data);
 	void Sync();
 	bool IsSynced() const;
 	int GetPixels(bool reset);
 	void PrintStats() {}
+	void GetKeys(GSScanlineKeys& keys);
+	void Precompile(const GSScanlineKeys& keys, const std::atomic<bool>& stop);
 };
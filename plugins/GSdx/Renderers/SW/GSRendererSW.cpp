@@ -24,6 +24,9 @@
 
 #define LOG 0
 
+// bump when the meaning of the scanline selector bits changes
+#define JIT_CACHE_VERSION 1
+
 static FILE* s_fp = LOG ? fopen("c:\\temp1\\_.txt", "w") : NULL;
 
 GSVector4 GSRendererSW::m_pos_scale;
@@ -42,6 +45,8 @@ void GSRendererSW::InitVectors()
 
 GSRendererSW::GSRendererSW(int threads)
 	: m_fzb(NULL)
+	, m_jit_cache_crc(0)
+	, m_precompile_stop(false)
 {
 	m_nativeres = true; // ignore ini, sw is always native
 
@@ -49,7 +54,16 @@ GSRendererSW::GSRendererSW(int threads)
 
 	memset(m_texture, 0, sizeof(m_texture));
 
-	m_rl = GSRasterizerList::Create<GSDrawScanline>(threads, &m_perfmon);
+	if(theApp.GetConfigB("extrathreads_tiles"))
+	{
+		m_rl = GSRasterizerTiles::Create<GSDrawScanline>(threads, &m_perfmon);
+	}
+	else
+	{
+		m_rl = GSRasterizerList::Create<GSDrawScanline>(threads, &m_perfmon);
+	}
+
+	m_jit_cache = !GLLoader::in_replayer && theApp.GetConfigB("jit_cache_sw");
 
 	m_output = (uint8*)_aligned_malloc(1024 * 1024 * sizeof(uint32), 32);
 
@@ -87,6 +101,13 @@ GSRendererSW::GSRendererSW(int threads)
 
 GSRendererSW::~GSRendererSW()
 {
+	StopPrecompile();
+
+	if(m_jit_cache_crc)
+	{
+		SaveScanlineKeys(m_jit_cache_crc);
+	}
+
 	delete m_tc;
 
 	for(size_t i = 0; i < countof(m_texture); i++)
@@ -99,6 +120,120 @@ GSRendererSW::~GSRendererSW()
 	_aligned_free(m_output);
 }
 
+void GSRendererSW::SetGameCRC(uint32 crc, int options)
+{
+	if(m_jit_cache && crc != m_jit_cache_crc)
+	{
+		StopPrecompile();
+
+		if(m_jit_cache_crc)
+		{
+			SaveScanlineKeys(m_jit_cache_crc);
+		}
+
+		m_jit_cache_crc = crc;
+
+		if(crc)
+		{
+			LoadScanlineKeys(crc);
+		}
+	}
+
+	GSRenderer::SetGameCRC(crc, options);
+}
+
+std::string GSRendererSW::GetScanlineKeysPath(uint32 crc)
+{
+	return theApp.GetConfigDir() + format("GSdx_jit_%08X.txt", crc);
+}
+
+// The file lists the keys of the setup prim and scanline functions, one per line. The code
+// itself isn't saved, it refers to the per thread scanline data by address, but generating
+// it again takes little time compared to the hitch of the first draw which needs it.
+
+void GSRendererSW::LoadScanlineKeys(uint32 crc)
+{
+	m_jit_cache_keys.sp.clear();
+	m_jit_cache_keys.ds.clear();
+
+	FILE* fp = fopen(GetScanlineKeysPath(crc).c_str(), "r");
+
+	if(fp == NULL)
+	{
+		return;
+	}
+
+	int version = 0;
+
+	if(fscanf(fp, "GSdx scanline keys %d\n", &version) == 1 && version == JIT_CACHE_VERSION)
+	{
+		char type[3];
+		unsigned long long key;
+
+		while(fscanf(fp, "%2s %llx\n", type, &key) == 2)
+		{
+			if(strcmp(type, "sp") == 0) m_jit_cache_keys.sp.push_back(key);
+			else if(strcmp(type, "ds") == 0) m_jit_cache_keys.ds.push_back(key);
+		}
+	}
+
+	fclose(fp);
+
+	if(!m_jit_cache_keys.sp.empty() || !m_jit_cache_keys.ds.empty())
+	{
+		m_precompile_stop = false;
+
+		m_precompile = std::thread([this]()
+		{
+			m_rl->Precompile(m_jit_cache_keys, m_precompile_stop);
+		});
+	}
+}
+
+void GSRendererSW::SaveScanlineKeys(uint32 crc)
+{
+	// keep the keys of the previous runs, not all of them are used every time
+
+	GSScanlineKeys keys = m_jit_cache_keys;
+
+	m_rl->Sync();
+	m_rl->GetKeys(keys);
+
+	for(auto* v : {&keys.sp, &keys.ds})
+	{
+		std::sort(v->begin(), v->end());
+		v->erase(std::unique(v->begin(), v->end()), v->end());
+	}
+
+	if(keys.sp.size() == m_jit_cache_keys.sp.size() && keys.ds.size() == m_jit_cache_keys.ds.size())
+	{
+		return; // nothing new
+	}
+
+	FILE* fp = fopen(GetScanlineKeysPath(crc).c_str(), "w");
+
+	if(fp == NULL)
+	{
+		return;
+	}
+
+	fprintf(fp, "GSdx scanline keys %d\n", JIT_CACHE_VERSION);
+
+	for(uint64 key : keys.sp) fprintf(fp, "sp %016llx\n", (unsigned long long)key);
+	for(uint64 key : keys.ds) fprintf(fp, "ds %016llx\n", (unsigned long long)key);
+
+	fclose(fp);
+}
+
+void GSRendererSW::StopPrecompile()
+{
+	if(m_precompile.joinable())
+	{
+		m_precompile_stop = true;
+		m_precompile.join();
+	}
+}
+
 void GSRendererSW::Reset()
 {
 	Sync(-1);
@@ -390,8 +525,6 @@ void GSRendererSW::Draw()
 
 	SharedData* sd = new SharedData(this);
 
-	std::shared_ptr<GSRasterizerData> data(sd);
-
 	sd->primclass = m_vt.m_primclass;
 	sd->buff = (uint8*)_aligned_malloc(sizeof(GSVertexSW) * ((m_vertex.next + 1) & ~1) + sizeof(uint32) * m_index.tail, 64);
 	sd->vertex = (GSVertexSW*)sd->buff;
@@ -429,6 +562,8 @@ void GSRendererSW::Draw()
 
 	if(!GetScanlineGlobalData(sd))
 	{
+		sd->Release();
+
 		return;
 	}
 
@@ -543,7 +678,7 @@ void GSRendererSW::Draw()
 			m_mem.SaveBMP(m_dump_root+s, m_context->ZBUF.Block(), m_context->FRAME.FBW, m_context->ZBUF.PSM, GetFrameRect().width(), 512);
 		}
 
-		Queue(data);
+		Queue(sd);
 
 		Sync(3);
 
@@ -573,9 +708,11 @@ void GSRendererSW::Draw()
 	}
 	else
 	{
-		Queue(data);
+		Queue(sd);
 	}
 
+	sd->Release();
+
 	/*
 	if(0)//stats.ticks > 5000000)
 	{
@@ -588,10 +725,8 @@ void GSRendererSW::Draw()
 	*/
 }
 
-void GSRendererSW::Queue(std::shared_ptr<GSRasterizerData>& item)
+void GSRendererSW::Queue(SharedData* sd)
 {
-	SharedData* sd = (SharedData*)item.get();
-
 	if(sd->m_syncpoint == SharedData::SyncSource) 
 	{
 		Sync(4);
@@ -608,7 +743,7 @@ void GSRendererSW::Queue(std::shared_ptr<GSRasterizerData>& item)
 
 	if(LOG)
 	{
-		GSScanlineGlobalData& gd = ((SharedData*)item.get())->global;
+		GSScanlineGlobalData& gd = sd->global;
 
 		fprintf(s_fp, "[%d] queue %05x %d (%d) %05x %d (%d) %05x %d %dx%d (%d %d %d) | %u %d %d\n",
 			sd->counter,
@@ -620,7 +755,7 @@ void GSRendererSW::Queue(std::shared_ptr<GSRasterizerData>& item)
 		fflush(s_fp);
 	}
 
-	m_rl->Queue(item);
+	m_rl->Queue(sd);
 
 	// invalidate new parts rendered onto
 
@@ -86,7 +86,7 @@ protected:
 	GSTexture* GetFeedbackOutput();
 
 	void Draw();
-	void Queue(std::shared_ptr<GSRasterizerData>& item);
+	void Queue(SharedData* sd);
 	void Sync(int reason);
 	void InvalidateVideoMem(const GIFRegBITBLTBUF& BITBLTBUF, const GSVector4i& r);
 	void InvalidateLocalMem(const GIFRegBITBLTBUF& BITBLTBUF, const GSVector4i& r, bool clut = false);
@@ -99,9 +99,24 @@ protected:
 
 	bool GetScanlineGlobalData(SharedData* data);
 
+	// scanline functions used by the game, generated in advance when it starts again
+
+	bool m_jit_cache;
+	uint32 m_jit_cache_crc;
+	GSScanlineKeys m_jit_cache_keys;
+	std::thread m_precompile;
+	std::atomic<bool> m_precompile_stop;
+
+	std::string GetScanlineKeysPath(uint32 crc);
+	void LoadScanlineKeys(uint32 crc);
+	void SaveScanlineKeys(uint32 crc);
+	void StopPrecompile();
+
 public:
 	static void InitVectors();
 
 	GSRendererSW(int threads);
 	virtual ~GSRendererSW();
+
+	void SetGameCRC(uint32 crc, int options);
 };
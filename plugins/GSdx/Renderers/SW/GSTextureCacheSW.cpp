@@ -32,39 +32,65 @@ GSTextureCacheSW::~GSTextureCacheSW()
 	RemoveAll();
 }
 
-GSTextureCacheSW::Texture* GSTextureCacheSW::Lookup(const GIFRegTEX0& TEX0, const GIFRegTEXA& TEXA, uint32 tw0)
+bool GSTextureCacheSW::Match(const Texture* t, const GIFRegTEX0& TEX0, const GIFRegTEXA& TEXA, uint32 tw0) const
 {
+	if(((TEX0.u32[0] ^ t->m_TEX0.u32[0]) | ((TEX0.u32[1] ^ t->m_TEX0.u32[1]) & 3)) != 0) // TBP0 TBW PSM TW TH
+	{
+		return false;
+	}
+
 	const GSLocalMemory::psm_t& psm = GSLocalMemory::m_psm[TEX0.PSM];
 
-	auto& m = m_map[TEX0.TBP0 >> 5];
+	if((psm.trbpp == 16 || psm.trbpp == 24) && TEX0.TCC && TEXA != t->m_TEXA)
+	{
+		return false;
+	}
 
-	for(auto i = m.begin(); i != m.end(); ++i)
+	if(tw0 != 0 && t->m_tw != tw0)
 	{
-		Texture* t = *i;
+		return false;
+	}
 
-		if(((TEX0.u32[0] ^ t->m_TEX0.u32[0]) | ((TEX0.u32[1] ^ t->m_TEX0.u32[1]) & 3)) != 0) // TBP0 TBW PSM TW TH
-		{
-			continue;
-		}
+	return true;
+}
 
-		if((psm.trbpp == 16 || psm.trbpp == 24) && TEX0.TCC && TEXA != t->m_TEXA)
-		{
-			continue;
-		}
+GSTextureCacheSW::Texture* GSTextureCacheSW::Lookup(const GIFRegTEX0& TEX0, const GIFRegTEXA& TEXA, uint32 tw0)
+{
+	const uint32 first = TEX0.TBP0 >> 5;
+
+	auto& m = m_map[first];
+
+	// the texture used last with the same TEX0 usually matches, the page list is the fallback
 
-		if(tw0 != 0 && t->m_tw != tw0)
+	Texture* t = m_index.Find(TEX0);
+
+	if(t == NULL || !Match(t, TEX0, TEXA, tw0))
+	{
+		t = NULL;
+
+		for(auto i = m.begin(); i != m.end(); ++i)
 		{
-			continue;
+			if(Match(*i, TEX0, TEXA, tw0))
+			{
+				t = *i;
+
+				m_index.Set(t);
+
+				break;
+			}
 		}
+	}
 
+	if(t != NULL)
+	{
 		// Lookup hit
-		m.MoveFront(i.Index());
+		m.MoveFront(t->m_erase_it[first]);
 		t->m_age = 0;
 		return t;
 	}
 
 	// Lookup miss
-	Texture* t = new Texture(m_state, tw0, TEX0, TEXA);
+	t = new Texture(m_state, tw0, TEX0, TEXA);
 
 	m_textures.insert(t);
 
@@ -74,12 +100,21 @@ GSTextureCacheSW::Texture* GSTextureCacheSW::Lookup(const GIFRegTEX0& TEX0, cons
 		t->m_erase_it[page] = m_map[page].InsertFront(t);
 	}
 
+	m_index.Set(t);
+	m_pages.SetBits(t->m_pages.bm);
+
 	return t;
 }
 
 void GSTextureCacheSW::InvalidatePages(const uint32* pages, uint32 psm)
 {
-	for(const uint32* p = pages; *p != GSOffset::EOP; p++)
+	// only the written pages which have textures
+
+	uint32 used[MAX_PAGES + 1];
+
+	m_pages.Intersect(pages, used);
+
+	for(const uint32* p = used; *p != GSOffset::EOP; p++)
 	{
 		const uint32 page = *p;
 		
@@ -107,6 +142,25 @@ void GSTextureCacheSW::InvalidatePages(const uint32* pages, uint32 psm)
 	}
 }
 
+void GSTextureCacheSW::Remove(Texture* t)
+{
+	for(const uint32* p = t->m_pages.n; *p != GSOffset::EOP; p++)
+	{
+		const uint32 page = *p;
+
+		m_map[page].EraseIndex(t->m_erase_it[page]);
+
+		if(m_map[page].empty())
+		{
+			m_pages.Reset(page);
+		}
+	}
+
+	m_index.Erase(t);
+
+	delete t;
+}
+
 void GSTextureCacheSW::RemoveAll()
 {
 	for(auto i : m_textures) delete i;
@@ -117,6 +171,9 @@ void GSTextureCacheSW::RemoveAll()
 	{
 		l.clear();
 	}
+
+	m_index.Clear();
+	m_pages.Clear();
 }
 
 void GSTextureCacheSW::IncAge()
@@ -129,13 +186,7 @@ void GSTextureCacheSW::IncAge()
 		{
 			i = m_textures.erase(i);
 
-			for(const uint32* p = t->m_pages.n; *p != GSOffset::EOP; p++)
-			{
-				const uint32 page = *p;
-				m_map[page].EraseIndex(t->m_erase_it[page]);
-			}
-
-			delete t;
+			Remove(t);
 		}
 		else
 		{
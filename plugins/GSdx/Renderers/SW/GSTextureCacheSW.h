@@ -23,6 +23,7 @@
 
 #include "Renderers/Common/GSRenderer.h"
 #include "Renderers/Common/GSFastList.h"
+#include "Renderers/Common/GSTextureCacheIndex.h"
 
 class GSTextureCacheSW
 {
@@ -60,6 +61,11 @@ protected:
 	GSState* m_state;
 	std::unordered_set<Texture*> m_textures;
 	std::array<FastList<Texture*>, MAX_PAGES> m_map;
+	GSTextureCacheIndex<Texture> m_index;
+	GSPageBitmap m_pages; // pages with textures
+
+	__forceinline bool Match(const Texture* t, const GIFRegTEX0& TEX0, const GIFRegTEXA& TEXA, uint32 tw0) const;
+	void Remove(Texture* t);
 
 public:
 	GSTextureCacheSW(GSState* state);
@@ -56,6 +56,32 @@ public:
 
 };
 
+// No window at all, the replay benchmark renders offscreen (see GSReplayHeadless).
+class GSWndHeadless : public GSWnd
+{
+	GSVector4i m_rect;
+
+public:
+	GSWndHeadless() : m_rect(0, 0, 640, 480) {}
+
+	bool Create(const std::string& title, int w, int h)
+	{
+		if(w > 0 && h > 0) m_rect = GSVector4i(0, 0, w, h);
+		return true;
+	}
+	bool Attach(void* handle, bool managed = true) {m_managed = managed; return true;}
+	void Detach() {}
+
+	void* GetDisplay() {return NULL;}
+	void* GetHandle() {return NULL;}
+	GSVector4i GetClientRect() {return m_rect;}
+	bool SetWindowText(const char* title) {return false;}
+
+	void Show() {}
+	void Hide() {}
+	void HideFrame() {}
+};
+
 class GSWndGL : public GSWnd
 {
 protected:
@@ -21,6 +21,8 @@
 #include <dlfcn.h>
 #include <cstdlib>
 #include <cstdio>
+#include <cstring>
+#include <algorithm>
 #include <string>
 
 static void* handle;
@@ -31,6 +33,10 @@ void help()
 	fprintf(stderr, "ARG1 GSdx plugin\n");
 	fprintf(stderr, "ARG2 .gs file\n");
 	fprintf(stderr, "ARG3 Ini directory\n");
+	fprintf(stderr, "Options (before the arguments):\n");
+	fprintf(stderr, "  --headless sw|null  replay without a window, the SW renderer draws offscreen\n");
+	fprintf(stderr, "  --csv FILE          per frame timings of the headless replay (default stdout)\n");
+	fprintf(stderr, "  --loops N           replays of the dump in headless mode (default 1)\n");
 	if (handle) {
 		dlclose(handle);
 	}
@@ -48,7 +54,24 @@ char* read_env(const char* var) {
 
 int main ( int argc, char *argv[] )
 {
-	if (argc < 1) help();
+	const char* headless = nullptr;
+	const char* csv = nullptr;
+	int loops = 1;
+
+	while (argc > 2 && strncmp(argv[1], "--", 2) == 0) {
+		if (strcmp(argv[1], "--headless") == 0)
+			headless = argv[2];
+		else if (strcmp(argv[1], "--csv") == 0)
+			csv = argv[2];
+		else if (strcmp(argv[1], "--loops") == 0)
+			loops = std::max(atoi(argv[2]), 1);
+		else
+			help();
+		argv += 2;
+		argc -= 2;
+	}
+
+	if (argc < 2) help();
 
 	char* plugin;
 	char* gs;
@@ -68,9 +91,11 @@ int main ( int argc, char *argv[] )
 
 	__attribute__((stdcall)) void (*GSsetSettingsDir_ptr)(const char*);
 	__attribute__((stdcall)) void (*GSReplay_ptr)(char*, int);
+	__attribute__((stdcall)) void (*GSReplayHeadless_ptr)(char*, const char*, const char*, int);
 
 	GSsetSettingsDir_ptr = reinterpret_cast<decltype(GSsetSettingsDir_ptr)>(dlsym(handle, "GSsetSettingsDir"));
 	GSReplay_ptr = reinterpret_cast<decltype(GSReplay_ptr)>(dlsym(handle, "GSReplay"));
+	GSReplayHeadless_ptr = reinterpret_cast<decltype(GSReplayHeadless_ptr)>(dlsym(handle, "GSReplayHeadless"));
 
 	if (argc == 2) {
 		char *ini = read_env("GSDUMP_CONF");
@@ -94,7 +119,15 @@ int main ( int argc, char *argv[] )
 #endif
 	}
 
-	GSReplay_ptr(gs, 12);
+	if (headless) {
+		if (!GSReplayHeadless_ptr) {
+			fprintf(stderr, "The plugin %s has no headless replay\n", plugin);
+			help();
+		}
+		GSReplayHeadless_ptr(gs, headless, csv, loops);
+	} else {
+		GSReplay_ptr(gs, 12);
+	}
 
 	if (handle) {
 		dlclose(handle);
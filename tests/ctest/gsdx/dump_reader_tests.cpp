@@ -0,0 +1,119 @@
+/*  PCSX2 - PS2 Emulator for PCs
+ *  Copyright (C) 2020 PCSX2 Dev Team
+ *
+ *  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with PCSX2.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "stdafx.h"
+#include "GSLzma.h"
+#include <gtest/gtest.h>
+#include <chrono>
+
+// A raw dump of transfers of 1MB, bigger than the ring of the reader (8 batches of 4MB),
+// so that the worker fills the ring and waits for the replay.
+static const int TransferCount = 40;
+static const uint32 TransferSize = 1024 * 1024;
+
+static std::string WriteDump()
+{
+	std::string path = testing::TempDir() + "gsdx_dump_reader_test.gs";
+	FILE* fp = fopen(path.c_str(), "wb");
+	if (!fp)
+		return std::string();
+
+	uint32 crc = 0x1234, state_size = 16;
+	std::vector<uint8> state(state_size, 1), regs(0x2000, 2), data(TransferSize);
+	fwrite(&crc, 4, 1, fp);
+	fwrite(&state_size, 4, 1, fp);
+	fwrite(state.data(), 1, state_size, fp);
+	fwrite(regs.data(), 1, regs.size(), fp);
+
+	for (int i = 0; i < TransferCount; i++) {
+		uint8 type = 0, path_index = 3;
+		memset(data.data(), i, TransferSize);
+		fwrite(&type, 1, 1, fp);
+		fwrite(&path_index, 1, 1, fp);
+		fwrite(&TransferSize, 4, 1, fp);
+		fwrite(data.data(), 1, TransferSize, fp);
+
+		uint8 vsync = 1, field = 0;
+		fwrite(&vsync, 1, 1, fp);
+		fwrite(&field, 1, 1, fp);
+	}
+
+	fclose(fp);
+	return path;
+}
+
+// Replays the whole dump, checking the order and the content of the transfers.
+static void ReadDump(GSDumpReader& reader)
+{
+	int transfers = 0, vsyncs = 0;
+
+	while (GSDumpReader::Batch* batch = reader.Next()) {
+		for (size_t offset = 0; offset < batch->data.size();) {
+			const GSDumpPacket& p = *(const GSDumpPacket*)&batch->data[offset];
+			if (p.type == 0) {
+				ASSERT_EQ(p.size, TransferSize);
+				const uint8* data = &batch->data[offset + sizeof(p)];
+				ASSERT_EQ(data[0], (uint8)transfers);
+				ASSERT_EQ(data[TransferSize - 1], (uint8)transfers);
+				transfers++;
+			} else if (p.type == 1) {
+				vsyncs++;
+			}
+			offset = p.next;
+		}
+	}
+
+	EXPECT_EQ(transfers, TransferCount);
+	EXPECT_EQ(vsyncs, TransferCount);
+}
+
+static void ReplayTwice(size_t cache_budget)
+{
+	const std::string path = WriteDump();
+	ASSERT_FALSE(path.empty());
+
+	{
+		GSDumpReader reader(path.c_str(), nullptr, cache_budget);
+		ASSERT_TRUE(reader.Open());
+		EXPECT_EQ(reader.GetCRC(), 0x1234u);
+
+		// Let the worker fill the ring before the replay starts.
+		std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+		ReadDump(reader);
+		reader.Rewind();
+		ReadDump(reader);
+	}
+
+	remove(path.c_str());
+}
+
+// The batches kept in the cache are replaced in the ring, the worker must be woken up
+// (it used to wait forever).
+TEST(GSDumpReaderTests, CachedReplay)
+{
+	ReplayTwice(1024 * 1024 * 1024);
+}
+
+TEST(GSDumpReaderTests, UncachedReplay)
+{
+	ReplayTwice(0);
+}
+
+// The cache budget is smaller than the dump, it is dropped and the dump is read again.
+TEST(GSDumpReaderTests, CacheOverBudget)
+{
+	ReplayTwice(16 * 1024 * 1024);
+}
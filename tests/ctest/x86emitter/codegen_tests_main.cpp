@@ -163,3 +163,19 @@ TEST(CodegenTests, SSETest)
 	CODEGEN_TEST_64(xBLEND.PD(xmm8, xmm9, 0xaa), "66 45 0f 3a 0d c1 aa");
 	CODEGEN_TEST_64(xEXTRACTPS(ptr32[base], xmm1, 2), "66 0f 3a 17 0d f6 ff ff ff 02");
 }
+
+TEST(CodegenTests, AVXTest)
+{
+	CODEGEN_TEST_BOTH(xVMOVDQU(ymm0, ptr[rcx]), "c5 fe 6f 01");
+	CODEGEN_TEST_BOTH(xVMOVDQU(ptr[rcx+0x20], ymm1), "c5 fe 7f 49 20");
+	CODEGEN_TEST_64(xVMOVDQU(ymm8, ptr[r8+r9]), "c4 01 7e 6f 04 08");
+	CODEGEN_TEST_BOTH(xVMOVDQA(xmm0, xmm1), "c5 f9 6f c1");
+	CODEGEN_TEST_BOTH(xVPMOVSX.WD(ymm0, ptr[rdx]), "c4 e2 7d 23 02");
+	CODEGEN_TEST_64(xVPMOVZX.WD(ymm9, ptr[rdx+0x10]), "c4 62 7d 33 4a 10");
+	CODEGEN_TEST_64(xVPMOVSX.BD(ymm0, ptr[r9]), "c4 c2 7d 21 01");
+	CODEGEN_TEST_BOTH(xVPAND(ymm0, ymm1, ptr[rax]), "c5 f5 db 00");
+	CODEGEN_TEST_64(xVPXOR(ymm8, ymm9, ymm10), "c4 41 35 ef c2");
+	CODEGEN_TEST_BOTH(xVINSERTI128(ymm0, ymm0, ptr[rdx+0xc], 1), "c4 e3 7d 38 42 0c 01");
+	CODEGEN_TEST_BOTH(xVINSERTI128(ymm1, ymm2, xmm3, 0), "c4 e3 6d 38 cb 00");
+	CODEGEN_TEST_BOTH(xVZEROUPPER(), "c5 f8 77");
+}